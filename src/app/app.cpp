@@ -13,14 +13,71 @@ namespace detail
 	static const std::string _lines_property("lines");
 	static const std::string _lines_name_property("sport");
 	static const std::string _lines_poll_property("poll");
+	static const std::string _lines_push_property("push");
+	static const std::string _lines_retention_age_property("retention_age");
+	static const std::string _lines_retention_rows_property("retention_rows");
 	static const std::string _logger_level_property("logger_level");
 	static const std::string _logger_sink_property("logger_sink");
 	static const std::string _rpc_client_mock_property("rpc_client_mock");
+	static const std::string _lines_window_property("lines_window");
+	static const std::string _lines_db_commit_rows_property("lines_db.commit_rows");
+	static const std::string _lines_db_commit_interval_property("lines_db.commit_interval");
+	static const std::string _lines_db_queue_limit_property("lines_db.queue_limit");
+	static const std::string _lines_db_journal_property("lines_db.journal");
+	static const std::string _lines_db_readers_property("lines_db.readers");
+	static const std::string _lines_db_wal_autocheckpoint_property("lines_db.wal_autocheckpoint");
+	static const std::string _lines_db_checkpoint_mode_property("lines_db.checkpoint_mode");
+	static const std::string _lines_db_checkpoint_interval_property("lines_db.checkpoint_interval");
+	static const std::string _lines_db_readers_timeout_property("lines_db.readers_timeout");
+	static const std::string _lines_db_block_rows_property("lines_db.block_rows");
+	static const std::string _lines_db_rollups_property("lines_db.rollups");
+	static const std::string _lines_db_retention_age_property("lines_db.retention_age");
+	static const std::string _lines_db_retention_rows_property("lines_db.retention_rows");
+	static const std::string _lines_db_maintenance_interval_property("lines_db.maintenance_interval");
+	static const std::string _lines_db_maintenance_budget_property("lines_db.maintenance_budget");
+	static const std::string _lines_db_retention_batch_property("lines_db.retention_batch");
+	static const std::string _lines_db_vacuum_pages_property("lines_db.vacuum_pages");
+	static const std::string _lines_db_vacuum_on_start_property("lines_db.vacuum_on_start");
+	static const std::string _lines_db_async_threads_property("lines_db.async_threads");
+	static const std::string _lines_db_shards_property("lines_db.shards");
+	static const std::string _lines_storage_property("lines_storage");
+	static const std::string _lines_snapshot_property("lines_snapshot.enabled");
+	static const std::string _lines_snapshot_interval_property("lines_snapshot.interval");
+	static const std::string _lines_snapshot_max_age_property("lines_snapshot.max_age");
+	static const std::string _lines_pipeline_publish_queue_property("lines_pipeline.publish_queue");
+	static const std::string _lines_pipeline_publish_overload_property("lines_pipeline.publish_overload");
+	static const std::string _lines_pipeline_persist_queue_property("lines_pipeline.persist_queue");
+	static const std::string _lines_pipeline_persist_overload_property("lines_pipeline.persist_overload");
+	static const std::string _lines_poller_workers_property("lines_poller.workers");
+	static const std::string _lines_poller_sessions_property("lines_poller.sessions");
+	static const std::string _lines_poller_timeout_property("lines_poller.timeout");
+	static const std::string _lines_poller_hedge_property("lines_poller.hedge");
+	static const std::string _lines_poller_hedge_percentile_property("lines_poller.hedge_percentile");
+	static const std::string _lines_poller_hedge_min_delay_property("lines_poller.hedge_min_delay");
+	static const std::string _lines_poller_hedge_threads_property("lines_poller.hedge_threads");
+	static const std::string _lines_poller_breaker_failures_property("lines_poller.breaker_failures");
+	static const std::string _lines_poller_breaker_backoff_property("lines_poller.breaker_backoff");
+	static const std::string _lines_poller_breaker_max_backoff_property("lines_poller.breaker_max_backoff");
+	static const std::string _lines_poller_batch_property("lines_poller.batch");
+	static const std::string _lines_poller_batch_api_property("lines_poller.batch_api");
+	static const std::string _lines_poller_jitter_property("lines_poller.jitter");
+	static const std::string _lines_poller_overrun_property("lines_poller.overrun");
+	static const std::string _lines_poller_adaptive_property("lines_poller.adaptive");
+	static const std::string _lines_poller_min_period_property("lines_poller.min_period");
+	static const std::string _lines_poller_max_period_property("lines_poller.max_period");
+	static const std::string _lines_poller_conditional_property("lines_poller.conditional");
+	static const std::string _lines_log_segment_records_property("lines_log.segment_records");
+	static const std::string _lines_log_retain_segments_property("lines_log.retain_segments");
+	static const std::string _lines_log_sync_records_property("lines_log.sync_records");
+	static const std::string _lines_log_index_stride_property("lines_log.index_stride");
 	
 	using line_sport_property = struct
 	{
 		std::string _name_property;
 		std::string _poll_property;
+		std::string _push_property;
+		std::string _retention_age_property;
+		std::string _retention_rows_property;
 	};
 		
 	line_sport_property create_line_sport_property(std::int32_t count)
@@ -40,10 +97,117 @@ namespace detail
 		
 		_lines_sport_property._poll_property += ".";
 		_lines_sport_property._poll_property += _lines_poll_property;
+
+		_lines_sport_property._push_property = lines_property + "." + _lines_push_property;
+		_lines_sport_property._retention_age_property = lines_property + "." + _lines_retention_age_property;
+		_lines_sport_property._retention_rows_property = lines_property + "." + _lines_retention_rows_property;
 		
 		return _lines_sport_property;
 	}
 			
+	static const std::uint32_t _history_page = 1000;
+	static const std::uint32_t _history_page_max = 10000;
+	static const std::string _ndjson_content_type("application/x-ndjson");
+
+	bool get_param(const rvision::http::params& params, const std::string& name, std::int64_t deflt, std::int64_t& value)
+	{
+		auto _value = params.get(name, "");
+		if (_value.empty())
+		{
+			value = deflt;
+
+			return true;
+		}
+
+		auto _res = std::from_chars(_value.data(), _value.data() + _value.size(), value);
+
+		return _res.ec == std::errc() && _res.ptr == _value.data() + _value.size();
+	}
+
+	//page token: <ts> or <ts>:<skip>, skip samples of ts were on the previous page
+	bool get_token(const rvision::http::params& params, std::int64_t& from, std::uint32_t& skip)
+	{
+		auto _value = params.get("token", "");
+		if (_value.empty())
+		{
+			return true;
+		}
+
+		auto _end = _value.data() + _value.size();
+		auto _res = std::from_chars(_value.data(), _end, from);
+
+		if (_res.ec != std::errc())
+		{
+			return false;
+		}
+
+		if (_res.ptr != _end && *_res.ptr == ':')
+		{
+			_res = std::from_chars(_res.ptr + 1, _end, skip);
+		}
+
+		return _res.ec == std::errc() && _res.ptr == _end;
+	}
+
+	rvision::overload_policy get_overload(const std::string& overload, rvision::overload_policy policy)
+	{
+		if (overload == "block")
+		{
+			return rvision::overload_policy::block;
+		}
+
+		if (overload == "drop_oldest")
+		{
+			return rvision::overload_policy::drop_oldest;
+		}
+
+		if (overload == "coalesce")
+		{
+			return rvision::overload_policy::coalesce;
+		}
+
+		return policy;
+	}
+
+	std::vector<std::int64_t> get_levels(const std::string& levels)
+	{
+		std::vector<std::string> _parts;
+		boost::split(_parts, levels, boost::is_any_of(","), boost::token_compress_on);
+
+		std::vector<std::int64_t> _levels;
+
+		for (const auto& p : _parts)
+		{
+			std::int64_t _level = 0;
+
+			auto _part = boost::trim_copy(p);
+			auto _res = std::from_chars(_part.data(), _part.data() + _part.size(), _level);
+
+			if (_res.ec == std::errc() && _level > 0)
+			{
+				_levels.emplace_back(_level);
+			}
+		}
+
+		return _levels;
+	}
+
+	void write_rollup(std::ostream& stream, const rvision::score_rollup& rollup)
+	{
+		stream << fmt::format("{{\"bucket\":{},\"first\":{},\"last\":{},\"min\":{},\"max\":{},\"avg\":{},\"count\":{}}}",
+			rollup.bucket, rollup.first, rollup.last, rollup.min, rollup.max, rollup.avg(), rollup.count);
+	}
+
+	void write_samples(std::ostream& stream, std::span<const rvision::score_sample> samples, bool& first)
+	{
+		for (const auto& s : samples)
+		{
+			stream << (first ? "[" : ",[") << s.ts << "," << fmt::format("{}", s.score) << "]";
+
+			first = false;
+		}
+	}
+
 	std::shared_ptr<rvision::http::server> create_http_server(const std::string& addrr, std::shared_ptr<rvision::core::logger> logger)
 	{
 		return std::make_shared<rvision::http::server>(addrr, logger);
@@ -55,9 +219,9 @@ namespace detail
 	}
 	
 	std::shared_ptr<rvision::lines_provider> create_lines_provider(const std::unordered_map<std::string, std::uint32_t>& pollers, const std::string& host, const std::string& api,
-		const std::string& folder, std::shared_ptr<rvision::core::logger> logger)
+		const std::string& folder, std::shared_ptr<rvision::core::logger> logger, const rvision::lines_provider_config& config)
 	{
-		return std::make_shared<rvision::lines_provider>(pollers, host, api, folder, logger);
+		return std::make_shared<rvision::lines_provider>(pollers, host, api, folder, logger, config);
 	}
 }
 
@@ -89,11 +253,79 @@ namespace rvision
 			auto line_property = detail::create_line_sport_property(lines_count);
 			
 			auto sport = config().getString(line_property._name_property, "");
-			auto poll = config().getInt(line_property._poll_property, 1);
+			//a push line gets its samples from POST ingest and has no poller
+			auto poll = config().getBool(line_property._push_property, false) ? 0 : config().getInt(line_property._poll_property, 1);
 			
 			m_config._lines_pollers[sport] = poll;
+
+			//a line without its own limits follows lines_db.retention_*
+			if (config().has(line_property._retention_age_property) || config().has(line_property._retention_rows_property))
+			{
+				auto& _policy = m_config._lines._db._line_retention[sport];
+
+				_policy._age = std::chrono::milliseconds(config().getInt64(line_property._retention_age_property, 0));
+				_policy._rows = config().getInt(line_property._retention_rows_property, 0);
+			}
 		}
 		
+		m_config._lines._window = config().getInt(detail::_lines_window_property, m_config._lines._window);
+		m_config._lines._db._commit_rows = config().getInt(detail::_lines_db_commit_rows_property, m_config._lines._db._commit_rows);
+		m_config._lines._db._commit_interval = std::chrono::milliseconds(config().getInt(detail::_lines_db_commit_interval_property, m_config._lines._db._commit_interval.count()));
+		m_config._lines._db._queue_limit = config().getInt(detail::_lines_db_queue_limit_property, m_config._lines._db._queue_limit);
+		m_config._lines._db._journal = config().getString(detail::_lines_db_journal_property, m_config._lines._db._journal);
+		m_config._lines._db._readers = config().getInt(detail::_lines_db_readers_property, m_config._lines._db._readers);
+		m_config._lines._db._wal_autocheckpoint = config().getInt(detail::_lines_db_wal_autocheckpoint_property, m_config._lines._db._wal_autocheckpoint);
+		m_config._lines._db._checkpoint_mode = config().getString(detail::_lines_db_checkpoint_mode_property, m_config._lines._db._checkpoint_mode);
+		m_config._lines._db._checkpoint_interval = std::chrono::milliseconds(config().getInt(detail::_lines_db_checkpoint_interval_property, m_config._lines._db._checkpoint_interval.count()));
+		m_config._lines._db._readers_timeout = std::chrono::milliseconds(config().getInt(detail::_lines_db_readers_timeout_property, m_config._lines._db._readers_timeout.count()));
+		m_config._lines._db._block_rows = config().getInt(detail::_lines_db_block_rows_property, m_config._lines._db._block_rows);
+
+		if (config().has(detail::_lines_db_rollups_property))
+		{
+			m_config._lines._db._rollups = detail::get_levels(config().getString(detail::_lines_db_rollups_property, ""));
+		}
+
+		m_config._lines._db._retention._age = std::chrono::milliseconds(config().getInt64(detail::_lines_db_retention_age_property, m_config._lines._db._retention._age.count()));
+		m_config._lines._db._retention._rows = config().getInt(detail::_lines_db_retention_rows_property, m_config._lines._db._retention._rows);
+		m_config._lines._db._maintenance_interval = std::chrono::milliseconds(config().getInt(detail::_lines_db_maintenance_interval_property, m_config._lines._db._maintenance_interval.count()));
+		m_config._lines._db._maintenance_budget = std::chrono::milliseconds(config().getInt(detail::_lines_db_maintenance_budget_property, m_config._lines._db._maintenance_budget.count()));
+		m_config._lines._db._retention_batch = config().getInt(detail::_lines_db_retention_batch_property, m_config._lines._db._retention_batch);
+		m_config._lines._db._vacuum_pages = config().getInt(detail::_lines_db_vacuum_pages_property, m_config._lines._db._vacuum_pages);
+		m_config._lines._db._vacuum_on_start = config().getBool(detail::_lines_db_vacuum_on_start_property, m_config._lines._db._vacuum_on_start);
+		m_config._lines._db._async_threads = config().getInt(detail::_lines_db_async_threads_property, m_config._lines._db._async_threads);
+		m_config._lines._db._shards = config().getInt(detail::_lines_db_shards_property, m_config._lines._db._shards);
+
+		m_config._lines._storage = config().getString(detail::_lines_storage_property, m_config._lines._storage);
+		m_config._lines._snapshot = config().getBool(detail::_lines_snapshot_property, m_config._lines._snapshot);
+		m_config._lines._snapshot_interval = std::chrono::milliseconds(config().getInt(detail::_lines_snapshot_interval_property, m_config._lines._snapshot_interval.count()));
+		m_config._lines._snapshot_max_age = std::chrono::milliseconds(config().getInt(detail::_lines_snapshot_max_age_property, m_config._lines._snapshot_max_age.count()));
+		m_config._lines._pipeline._publish_queue = config().getInt(detail::_lines_pipeline_publish_queue_property, m_config._lines._pipeline._publish_queue);
+		m_config._lines._pipeline._publish_overload = detail::get_overload(config().getString(detail::_lines_pipeline_publish_overload_property, ""), m_config._lines._pipeline._publish_overload);
+		m_config._lines._pipeline._persist_queue = config().getInt(detail::_lines_pipeline_persist_queue_property, m_config._lines._pipeline._persist_queue);
+		m_config._lines._pipeline._persist_overload = detail::get_overload(config().getString(detail::_lines_pipeline_persist_overload_property, ""), m_config._lines._pipeline._persist_overload);
+		m_config._lines._poll_workers = config().getInt(detail::_lines_poller_workers_property, m_config._lines._poll_workers);
+		m_config._lines._upstream._sessions = config().getInt(detail::_lines_poller_sessions_property, m_config._lines._upstream._sessions);
+		m_config._lines._upstream._timeout = std::chrono::milliseconds(config().getInt(detail::_lines_poller_timeout_property, m_config._lines._upstream._timeout.count()));
+		m_config._lines._upstream._hedge = config().getBool(detail::_lines_poller_hedge_property, m_config._lines._upstream._hedge);
+		m_config._lines._upstream._hedge_percentile = config().getDouble(detail::_lines_poller_hedge_percentile_property, m_config._lines._upstream._hedge_percentile);
+		m_config._lines._upstream._hedge_min_delay = std::chrono::milliseconds(config().getInt(detail::_lines_poller_hedge_min_delay_property, m_config._lines._upstream._hedge_min_delay.count()));
+		m_config._lines._upstream._hedge_threads = config().getInt(detail::_lines_poller_hedge_threads_property, m_config._lines._upstream._hedge_threads);
+		m_config._lines._upstream._breaker_failures = config().getInt(detail::_lines_poller_breaker_failures_property, m_config._lines._upstream._breaker_failures);
+		m_config._lines._upstream._breaker_backoff = std::chrono::milliseconds(config().getInt(detail::_lines_poller_breaker_backoff_property, m_config._lines._upstream._breaker_backoff.count()));
+		m_config._lines._upstream._breaker_max_backoff = std::chrono::milliseconds(config().getInt(detail::_lines_poller_breaker_max_backoff_property, m_config._lines._upstream._breaker_max_backoff.count()));
+		m_config._lines._poll_batch = config().getInt(detail::_lines_poller_batch_property, m_config._lines._poll_batch);
+		m_config._lines._poll_batch_api = config().getString(detail::_lines_poller_batch_api_property, m_config._lines._poll_batch_api);
+		m_config._lines._poll_jitter = config().getDouble(detail::_lines_poller_jitter_property, m_config._lines._poll_jitter);
+		m_config._lines._poll_overrun = config().getString(detail::_lines_poller_overrun_property, "skip") == "catch_up" ? rvision::overrun_policy::catch_up : rvision::overrun_policy::skip;
+		m_config._lines._poller._adaptive = config().getBool(detail::_lines_poller_adaptive_property, m_config._lines._poller._adaptive);
+		m_config._lines._poller._min_period = std::chrono::milliseconds(config().getInt(detail::_lines_poller_min_period_property, m_config._lines._poller._min_period.count()));
+		m_config._lines._poller._max_period = std::chrono::milliseconds(config().getInt(detail::_lines_poller_max_period_property, m_config._lines._poller._max_period.count()));
+		m_config._lines._poller._conditional = config().getBool(detail::_lines_poller_conditional_property, m_config._lines._poller._conditional);
+		m_config._lines._log._segment_records = config().getInt(detail::_lines_log_segment_records_property, m_config._lines._log._segment_records);
+		m_config._lines._log._retain_segments = config().getInt(detail::_lines_log_retain_segments_property, m_config._lines._log._retain_segments);
+		m_config._lines._log._sync_records = config().getInt(detail::_lines_log_sync_records_property, m_config._lines._log._sync_records);
+		m_config._lines._log._index_stride = config().getInt(detail::_lines_log_index_stride_property, m_config._lines._log._index_stride);
+		
 		std::string _logger_path(m_config._data_folder);
 		_logger_path += "\\";
 		_logger_path += detail::_logger_file;
@@ -199,11 +431,15 @@ namespace rvision
 			auto _res = std::filesystem::create_directories(m_config._data_folder);
 		}
 
-		m_lines_provider = detail::create_lines_provider(m_config._lines_pollers, m_config._lines_srv_host,  m_config._lines_srv_api,  m_config._data_folder, m_logger);
+		m_lines_provider = detail::create_lines_provider(m_config._lines_pollers, m_config._lines_srv_host,  m_config._lines_srv_api,  m_config._data_folder, m_logger, m_config._lines);
 
 		m_http_server = detail::create_http_server(m_config._http_srv_addrr, m_logger);
 						
 		m_http_server->handle("GET", "ready", std::bind(&app::http_ready_callback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));		
+		m_http_server->handle("GET", "metrics", std::bind(&app::http_metrics_callback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+		m_http_server->handle("GET", "rollup/:line", std::bind(&app::http_rollup_callback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+		m_http_server->handle("GET", "history/:line", std::bind(&app::http_history_callback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+		m_http_server->handle("POST", "ingest", std::bind(&app::http_ingest_callback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 		m_http_server->start();
 
 		//m_rpc_server = detail::create_grpc_server(m_config._rpc_srv_addrr, m_logger, std::bind(&app::rpc_get_score, this, std::placeholders::_1, std::placeholders::_2));
@@ -248,4 +484,216 @@ namespace rvision
 		
 		return rvision::core::errc::not_implement;
 	}
+	
+	rvision::core::errc app::http_metrics_callback(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params)
+	{
+		boost::property_tree::ptree _ptree;
+		
+		m_lines_provider->metrics(_ptree);
+		
+		response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+		response.setContentType("application/json");
+
+		std::ostream& stream = response.send();
+		boost::property_tree::write_json(stream, _ptree);
+		
+		return rvision::core::errc::success;
+	}
+	
+	rvision::core::errc app::http_history_callback(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params)
+	{
+		auto _line = params.get("line", "");
+
+		std::int64_t _from = 0;
+		std::uint32_t _skip = 0;
+		std::int64_t _to = 0;
+		std::int64_t _page = 0;
+
+		//token is the keyset continuation of a previous page and takes the place of from
+		bool _valid = detail::get_param(params, "from", 0, _from) && detail::get_param(params, "to", std::numeric_limits<std::int64_t>::max(), _to)
+			&& detail::get_param(params, "page", detail::_history_page, _page) && detail::get_token(params, _from, _skip);
+
+		if (!_valid || _line.empty() || _page <= 0 || _from > _to)
+		{
+			response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+			response.send();
+
+			return rvision::core::errc::invalid_argument;
+		}
+
+		auto _page_size = static_cast<std::uint32_t>(std::min<std::int64_t>(_page, detail::_history_page_max));
+
+		m_logger->debug("app::http_history_callback => line: {} range: [{}, {}] page: {}", _line, _from, _to, _page_size);
+
+		response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+		response.setContentType("application/json");
+
+		bool _first = true;
+
+		rvision::score_page _result;
+		std::ostringstream _samples;
+
+		auto errc = m_lines_provider->fetch(_line, _from, _skip, _to, _page_size, [&_samples, &_first](std::span<const rvision::score_sample> samples)
+		{
+			detail::write_samples(_samples, samples, _first);
+
+			return true;
+		}, _result);
+
+		if (errc != rvision::core::errc::success)
+		{
+			response.setStatus(errc == rvision::core::errc::not_found ? Poco::Net::HTTPResponse::HTTP_NOT_FOUND : Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+			response.send();
+
+			return errc;
+		}
+
+		if (params.get("stream", "0") == "1")
+		{
+			//whole range page by page, each page is written out before the next one is read
+			response.setChunkedTransferEncoding(true);
+
+			std::ostream& stream = response.send();
+			stream << "{\"line\":\"" << _line << "\",\"samples\":[" << _samples.str();
+
+			if (_result.more)
+			{
+				errc = m_lines_provider->stream(_line, _result.next, _result.skip, _to, _page_size, [&stream, &_first](std::span<const rvision::score_sample> samples)
+				{
+					detail::write_samples(stream, samples, _first);
+
+					return stream.good();
+				});
+			}
+
+			stream << "]}";
+
+			return errc;
+		}
+
+		std::ostream& stream = response.send();
+		stream << "{\"line\":\"" << _line << "\",\"samples\":[" << _samples.str() << "]";
+
+		if (_result.more)
+		{
+			stream << ",\"next\":\"" << _result.next;
+
+			if (_result.skip != 0)
+			{
+				stream << ":" << _result.skip;
+			}
+
+			stream << "\"";
+		}
+
+		stream << "}";
+
+		return rvision::core::errc::success;
+	}
+
+	rvision::core::errc app::http_rollup_callback(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params)
+	{
+		auto _line = params.get("line", "");
+
+		std::int64_t _from = 0;
+		std::int64_t _to = 0;
+		std::int64_t _resolution = 0;
+
+		//without resolution the whole range is one aggregate
+		bool _valid = detail::get_param(params, "from", 0, _from) && detail::get_param(params, "to", std::numeric_limits<std::int64_t>::max(), _to)
+			&& detail::get_param(params, "resolution", 0, _resolution);
+
+		if (!_valid || _line.empty() || _resolution < 0 || _from > _to)
+		{
+			response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+			response.send();
+
+			return rvision::core::errc::invalid_argument;
+		}
+
+		std::ostringstream _body;
+		rvision::core::errc errc = rvision::core::errc::success;
+
+		if (_resolution == 0)
+		{
+			rvision::score_rollup _aggregate;
+
+			errc = m_lines_provider->aggregate(_line, _from, _to, _aggregate);
+
+			_body << "{\"line\":\"" << _line << "\",\"aggregate\":";
+			detail::write_rollup(_body, _aggregate);
+			_body << "}";
+		}
+		else
+		{
+			std::vector<rvision::score_rollup> _rollups;
+			std::int64_t _level = 0;
+
+			errc = m_lines_provider->fetch_rollups(_line, _from, _to, _resolution, _rollups, _level);
+
+			_body << "{\"line\":\"" << _line << "\",\"level\":" << _level << ",\"buckets\":[";
+
+			for (std::size_t i = 0; i < _rollups.size(); ++i)
+			{
+				_body << (i ? "," : "");
+				detail::write_rollup(_body, _rollups[i]);
+			}
+
+			_body << "]}";
+		}
+
+		if (errc != rvision::core::errc::success)
+		{
+			response.setStatus(errc == rvision::core::errc::not_found ? Poco::Net::HTTPResponse::HTTP_NOT_FOUND
+				: errc == rvision::core::errc::not_implement ? Poco::Net::HTTPResponse::HTTP_NOT_IMPLEMENTED : Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+			response.send();
+
+			return errc;
+		}
+
+		response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+		response.setContentType("application/json");
+
+		std::ostream& stream = response.send();
+		stream << _body.str();
+
+		return rvision::core::errc::success;
+	}
+	
+	rvision::core::errc app::http_ingest_callback(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params)
+	{
+		//the body is consumed here, the dispatcher hands every handler a const request
+		std::istream& _body = const_cast<Poco::Net::HTTPServerRequest&>(request).stream();
+
+		rvision::lines_ingest_result _result;
+
+		auto errc = rvision::lines_ingest::read(_body, request.getContentType() == detail::_ndjson_content_type, [this](const std::string& sport, const rvision::score_sample& sample)
+		{
+			return m_lines_provider->ingest(sport, sample);
+		}, _result);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("app::http_ingest_callback => malformed body");
+
+			response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+			response.send();
+
+			return errc;
+		}
+
+		m_logger->debug("app::http_ingest_callback => accepted: {}, rejected: {}", _result.accepted, _result.rejected);
+
+		boost::property_tree::ptree _ptree;
+		_ptree.put("accepted", _result.accepted);
+		_ptree.put("rejected", _result.rejected);
+
+		response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+		response.setContentType("application/json");
+
+		std::ostream& stream = response.send();
+		boost::property_tree::write_json(stream, _ptree);
+
+		return rvision::core::errc::success;
+	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <core/logger.hpp>
 #include <http/server/server.hpp>
 #include <lines/provider/lines_provider.hpp>
+#include <lines/provider/lines_ingest.hpp>
 #include <rpc/server/server.hpp>
 
 namespace rvision
@@ -17,6 +18,7 @@ namespace rvision
 			std::string _data_folder;
 			
 			std::unordered_map<std::string, std::uint32_t> _lines_pollers;
+			rvision::lines_provider_config _lines;
 		};
 		
 	public:
@@ -39,6 +41,10 @@ namespace rvision
 	private:
 	std::unordered_map<std::string, std::double_t> rpc_get_score(const std::vector<std::string>& lines, bool changed);
 	rvision::core::errc http_ready_callback(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params);
+	rvision::core::errc http_metrics_callback(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params);
+	rvision::core::errc http_rollup_callback(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params);
+	rvision::core::errc http_history_callback(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params);
+	rvision::core::errc http_ingest_callback(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params);
 
 	private:
 		app_config m_config;
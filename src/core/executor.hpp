@@ -0,0 +1,130 @@
+#pragma once
+#include <core/headers.hpp>
+#include <core/histogram.hpp>
+
+namespace rvision::core
+{
+	//fixed pool of worker threads draining one fifo of tasks, tasks queued before destruction still run,
+	//a task submitted while the pool stops runs on the caller, its future is never left without a result
+	class executor
+	{
+		struct task
+		{
+			std::function<void()> run;
+			std::chrono::steady_clock::time_point queued;
+		};
+
+	public:
+		explicit executor(std::uint32_t threads)
+			: m_stopped(false), m_depth(0), m_executed(0)
+		{
+			threads = std::max<std::uint32_t>(threads, 1);
+
+			while (threads--)
+			{
+				m_threads.emplace_back([this](std::stop_token stoken)
+				{
+					run(stoken);
+				});
+			}
+		}
+
+		~executor()
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_lock);
+
+				m_stopped = true;
+			}
+
+			for (auto& t : m_threads)
+			{
+				t.request_stop();
+			}
+
+			m_threads.clear();
+		}
+
+		executor(const executor&) = delete;
+		executor& operator=(const executor&) = delete;
+
+		template<typename F>
+		auto submit(F&& f) -> std::future<std::invoke_result_t<F>>
+		{
+			using result_t = std::invoke_result_t<F>;
+
+			//std::function needs a copyable callable, the task is shared with it
+			auto _task = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(f));
+			auto _future = _task->get_future();
+
+			{
+				std::unique_lock<std::mutex> lock(m_lock);
+
+				if (m_stopped)
+				{
+					lock.unlock();
+
+					(*_task)();
+
+					return _future;
+				}
+
+				m_tasks.emplace_back(task{[_task] { (*_task)(); }, std::chrono::steady_clock::now()});
+
+				m_depth.store(m_tasks.size(), std::memory_order_relaxed);
+			}
+
+			m_wait.notify_one();
+
+			return _future;
+		}
+
+		void metrics(boost::property_tree::ptree& tree, const std::string& path) const
+		{
+			tree.put(path + ".threads", m_threads.size());
+			tree.put(path + ".queue_depth", m_depth.load(std::memory_order_relaxed));
+			tree.put(path + ".executed", m_executed.load(std::memory_order_relaxed));
+
+			put_histogram(tree, path + ".queue_wait_us", m_queue_wait);
+		}
+
+	private:
+		void run(std::stop_token stoken)
+		{
+			while (true)
+			{
+				task _task;
+
+				{
+					std::unique_lock<std::mutex> lock(m_lock);
+
+					if (!m_wait.wait(lock, stoken, [this] { return !m_tasks.empty(); }))
+					{
+						return;
+					}
+
+					_task = std::move(m_tasks.front());
+					m_tasks.pop_front();
+
+					m_depth.store(m_tasks.size(), std::memory_order_relaxed);
+				}
+
+				m_queue_wait.record(std::chrono::steady_clock::now() - _task.queued);
+
+				_task.run();
+
+				m_executed.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		std::mutex m_lock;
+		bool m_stopped;
+		std::condition_variable_any m_wait;
+		std::deque<task> m_tasks;
+		std::atomic<std::uint64_t> m_depth;
+		std::atomic<std::uint64_t> m_executed;
+		histogram m_queue_wait;
+		std::vector<std::jthread> m_threads;
+	};
+}
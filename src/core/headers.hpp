@@ -7,6 +7,7 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <set>
 #include <atomic>
@@ -17,6 +18,16 @@
 #include <shared_mutex>
 #include <filesystem>
 #include <queue>
+#include <list>
+#include <bit>
+#include <span>
+#include <deque>
+#include <fstream>
+#include <cstring>
+#include <charconv>
+#include <sstream>
+#include <future>
+#include <random>
 //#include <format>
 
 #define BOOST_SPIRIT_THREADSAFE
@@ -32,6 +43,8 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/detail/rapidxml.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 #include <Poco/Util/AbstractConfiguration.h>
 #include <Poco/Util/JSONConfiguration.h>
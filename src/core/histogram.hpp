@@ -0,0 +1,148 @@
+#pragma once
+#include <core/headers.hpp>
+#include <array>
+#include <bit>
+#include <cmath>
+
+namespace rvision::core
+{
+	//lock-free log-linear histogram: 4 sub-buckets per power of two, ~25% relative error
+	class histogram
+	{
+	public:
+		static constexpr std::size_t buckets = 252;
+
+		struct summary
+		{
+			std::uint64_t count = 0;
+			std::uint64_t avg = 0;
+			std::uint64_t p50 = 0;
+			std::uint64_t p95 = 0;
+			std::uint64_t p99 = 0;
+			std::uint64_t max = 0;
+		};
+
+		histogram() = default;
+
+		histogram(const histogram&) = delete;
+		histogram& operator=(const histogram&) = delete;
+
+		void record(std::uint64_t value)
+		{
+			m_buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+			m_count.fetch_add(1, std::memory_order_relaxed);
+			m_sum.fetch_add(value, std::memory_order_relaxed);
+
+			auto _max = m_max.load(std::memory_order_relaxed);
+			while (_max < value && !m_max.compare_exchange_weak(_max, value, std::memory_order_relaxed))
+			{
+				;
+			}
+		}
+
+		template<typename Rep, typename Period>
+		void record(const std::chrono::duration<Rep, Period>& value)
+		{
+			auto _us = std::chrono::duration_cast<std::chrono::microseconds>(value).count();
+
+			record(static_cast<std::uint64_t>(_us > 0 ? _us : 0));
+		}
+
+		std::uint64_t count() const
+		{
+			return m_count.load(std::memory_order_relaxed);
+		}
+
+		std::uint64_t percentile(std::double_t p) const
+		{
+			auto _count = count();
+			if (_count == 0)
+			{
+				return 0;
+			}
+
+			auto _rank = static_cast<std::uint64_t>(std::ceil(p * static_cast<std::double_t>(_count)));
+			if (_rank == 0)
+			{
+				_rank = 1;
+			}
+
+			std::uint64_t _seen = 0;
+			for (std::size_t i = 0; i < buckets; ++i)
+			{
+				_seen += m_buckets[i].load(std::memory_order_relaxed);
+
+				if (_seen >= _rank)
+				{
+					return std::min(upper_bound(i), m_max.load(std::memory_order_relaxed));
+				}
+			}
+
+			return m_max.load(std::memory_order_relaxed);
+		}
+
+		summary summarize() const
+		{
+			summary _summary;
+
+			_summary.count = count();
+			_summary.avg = _summary.count ? m_sum.load(std::memory_order_relaxed) / _summary.count : 0;
+			_summary.p50 = percentile(0.50);
+			_summary.p95 = percentile(0.95);
+			_summary.p99 = percentile(0.99);
+			_summary.max = m_max.load(std::memory_order_relaxed);
+
+			return _summary;
+		}
+
+	private:
+		static std::size_t index(std::uint64_t value)
+		{
+			if (value < 4)
+			{
+				return static_cast<std::size_t>(value);
+			}
+
+			auto _msb = static_cast<std::size_t>(std::bit_width(value) - 1);
+			auto _sub = static_cast<std::size_t>((value >> (_msb - 2)) & 3);
+
+			return 4 * (_msb - 1) + _sub;
+		}
+
+		static std::uint64_t upper_bound(std::size_t index)
+		{
+			if (index < 4)
+			{
+				return index;
+			}
+
+			auto _msb = index / 4 + 1;
+			auto _sub = index % 4;
+
+			if (_msb >= 63)
+			{
+				return std::numeric_limits<std::uint64_t>::max();
+			}
+
+			return ((4 + _sub + 1) << (_msb - 2)) - 1;
+		}
+
+	private:
+		std::array<std::atomic<std::uint64_t>, buckets> m_buckets{};
+		std::atomic<std::uint64_t> m_count{0};
+		std::atomic<std::uint64_t> m_sum{0};
+		std::atomic<std::uint64_t> m_max{0};
+	};
+
+	inline void put_histogram(boost::property_tree::ptree& tree, const std::string& path, const histogram& h)
+	{
+		auto _summary = h.summarize();
+
+		tree.put(path + ".count", _summary.count);
+		tree.put(path + ".avg", _summary.avg);
+		tree.put(path + ".p50", _summary.p50);
+		tree.put(path + ".p95", _summary.p95);
+		tree.put(path + ".p99", _summary.p99);
+		tree.put(path + ".max", _summary.max);
+	}
+}
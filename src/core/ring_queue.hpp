@@ -0,0 +1,111 @@
+#pragma once
+#include <core/headers.hpp>
+
+namespace rvision::core
+{
+	//bounded lock-free multi-producer multi-consumer ring, every cell carries the sequence number of the turn it is ready for,
+	//the capacity is rounded up to a power of two
+	template<typename T>
+	class ring_queue
+	{
+		struct cell
+		{
+			std::atomic<std::size_t> seq{0};
+			T value{};
+		};
+
+	public:
+		explicit ring_queue(std::size_t capacity)
+			: m_mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1), m_cells(std::make_unique<cell[]>(m_mask + 1)), m_tail(0), m_head(0)
+		{
+			for (std::size_t i = 0; i <= m_mask; ++i)
+			{
+				m_cells[i].seq.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		ring_queue(const ring_queue&) = delete;
+		ring_queue& operator=(const ring_queue&) = delete;
+
+		//value is moved from only when it is queued
+		bool try_push(T& value)
+		{
+			auto _pos = m_tail.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				auto& _cell = m_cells[_pos & m_mask];
+				auto _diff = static_cast<std::intptr_t>(_cell.seq.load(std::memory_order_acquire)) - static_cast<std::intptr_t>(_pos);
+
+				if (_diff == 0)
+				{
+					if (m_tail.compare_exchange_weak(_pos, _pos + 1, std::memory_order_relaxed))
+					{
+						_cell.value = std::move(value);
+						_cell.seq.store(_pos + 1, std::memory_order_release);
+
+						return true;
+					}
+				}
+				else if (_diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					_pos = m_tail.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		bool try_pop(T& value)
+		{
+			auto _pos = m_head.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				auto& _cell = m_cells[_pos & m_mask];
+				auto _diff = static_cast<std::intptr_t>(_cell.seq.load(std::memory_order_acquire)) - static_cast<std::intptr_t>(_pos + 1);
+
+				if (_diff == 0)
+				{
+					if (m_head.compare_exchange_weak(_pos, _pos + 1, std::memory_order_relaxed))
+					{
+						value = std::move(_cell.value);
+						_cell.seq.store(_pos + m_mask + 1, std::memory_order_release);
+
+						return true;
+					}
+				}
+				else if (_diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					_pos = m_head.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		//approximate while producers and consumers run
+		std::size_t size() const
+		{
+			auto _head = m_head.load(std::memory_order_relaxed);
+			auto _tail = m_tail.load(std::memory_order_relaxed);
+
+			return _tail > _head ? std::min(_tail - _head, m_mask + 1) : 0;
+		}
+
+		std::size_t capacity() const
+		{
+			return m_mask + 1;
+		}
+
+	private:
+		std::size_t m_mask;
+		std::unique_ptr<cell[]> m_cells;
+		alignas(64) std::atomic<std::size_t> m_tail;
+		alignas(64) std::atomic<std::size_t> m_head;
+	};
+}
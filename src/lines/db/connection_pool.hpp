@@ -0,0 +1,214 @@
+#pragma once
+#include <core/headers.hpp>
+#include <core/logger.hpp>
+#include <core/histogram.hpp>
+
+namespace rvision
+{
+	//fixed set of connections, an accessor blocks up to its timeout for one and a returned connection is handed over
+	//directly to the oldest waiting accessor
+	template<typename connection_t>
+	class connection_pool
+	{
+	public:
+		struct no_resource : public std::exception
+		{
+
+		};
+
+		struct draining : public std::exception
+		{
+
+		};
+
+		struct accessor
+		{
+			accessor(std::shared_ptr<rvision::core::logger> logger, connection_pool& pool, const std::chrono::milliseconds& timeout)
+			: m_logger(logger), m_pool(pool)
+			{
+				try
+				{
+					m_connection = m_pool.pop(std::chrono::steady_clock::now() + timeout);
+				}
+				catch (const draining&)
+				{
+					m_logger->debug("connection_pool::accessor::accessor => drainig");
+				}
+
+				if (!m_connection)
+				{
+					throw no_resource();
+				}
+			}
+
+			~accessor()
+			{
+				if (m_connection)
+				{
+					m_pool.push(std::move(m_connection));
+				}
+			}
+
+			connection_t* operator->() const noexcept
+			{
+				return m_connection.get();
+			}
+
+			connection_t& operator*() const noexcept
+			{
+				return *m_connection;
+			}
+
+		private:
+			std::unique_ptr<connection_t> m_connection;
+			std::shared_ptr<rvision::core::logger> m_logger;
+			connection_pool& m_pool;
+		};
+
+		using pool_connection_t = std::unique_ptr<connection_t>;
+		using pool_connection_factory_t = std::function< pool_connection_t () >;
+
+		connection_pool(std::uint32_t size, const pool_connection_factory_t& factory, std::shared_ptr<rvision::core::logger> logger)
+			:m_max(size), m_drainig(false), m_factory(factory), m_in_use(0), m_exhausted(0), m_timeouts(0), m_logger(logger)
+		{
+			while (size--)
+			{
+				m_pool.emplace_back(m_factory());
+			}
+		}
+
+		//waits for every connection handed out to come back
+		~connection_pool()
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			m_logger->info("connection_pool::~connection_pool => before pool_max_size: {}, pool_size: {}", m_max, m_pool.size());
+
+			m_drainig = true;
+
+			for (auto w : m_waiters)
+			{
+				w->wait.notify_one();
+			}
+
+			m_drained.wait(lock, [this] { return m_pool.size() == m_max && m_waiters.empty(); });
+
+			m_logger->info("connection_pool::~connection_pool => after pool_max_size: {}, pool_size: {}", m_max, m_pool.size());
+		}
+
+		void metrics(boost::property_tree::ptree& tree, const std::string& path) const
+		{
+			tree.put(path + ".size", m_max);
+			tree.put(path + ".in_use", m_in_use.load(std::memory_order_relaxed));
+			tree.put(path + ".exhausted", m_exhausted.load(std::memory_order_relaxed));
+			tree.put(path + ".timeouts", m_timeouts.load(std::memory_order_relaxed));
+
+			rvision::core::put_histogram(tree, path + ".wait_us", m_wait_time);
+		}
+
+		friend accessor;
+
+	private:
+		//parked accessor, a returned connection is handed over directly in arrival order
+		struct waiter
+		{
+			std::condition_variable wait;
+			pool_connection_t connection;
+		};
+
+		pool_connection_t pop(const std::chrono::steady_clock::time_point& deadline)
+		{
+			auto _start = std::chrono::steady_clock::now();
+
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			if (m_drainig)
+			{
+				throw draining();
+			}
+
+			if (!m_pool.empty() && m_waiters.empty())
+			{
+				auto conn = std::move(m_pool.front());
+
+				m_pool.pop_front();
+
+				m_in_use.fetch_add(1, std::memory_order_relaxed);
+				m_wait_time.record(0);
+
+				return conn;
+			}
+
+			m_exhausted.fetch_add(1, std::memory_order_relaxed);
+
+			waiter _waiter;
+			auto _position = m_waiters.insert(m_waiters.end(), &_waiter);
+
+			_waiter.wait.wait_until(lock, deadline, [this, &_waiter] { return _waiter.connection || m_drainig; });
+
+			m_wait_time.record(std::chrono::steady_clock::now() - _start);
+
+			if (_waiter.connection)
+			{
+				m_in_use.fetch_add(1, std::memory_order_relaxed);
+
+				return std::move(_waiter.connection);
+			}
+
+			m_waiters.erase(_position);
+
+			if (m_drainig)
+			{
+				m_drained.notify_all();
+
+				throw draining();
+			}
+
+			m_timeouts.fetch_add(1, std::memory_order_relaxed);
+
+			m_logger->error("connection_pool::pop => no connection within deadline, waiters: {}", m_waiters.size());
+
+			return nullptr;
+		}
+
+		void push(pool_connection_t&& conn)
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			m_in_use.fetch_sub(1, std::memory_order_relaxed);
+
+			if (!m_waiters.empty() && !m_drainig)
+			{
+				auto _waiter = m_waiters.front();
+
+				m_waiters.pop_front();
+
+				_waiter->connection = std::move(conn);
+				_waiter->wait.notify_one();
+
+				return;
+			}
+
+			m_pool.emplace_back(std::move(conn));
+
+			if (m_drainig)
+			{
+				m_drained.notify_all();
+			}
+		}
+
+	private:
+		std::uint32_t m_max;
+		bool m_drainig;
+		std::mutex m_lock;
+		std::condition_variable m_drained;
+		pool_connection_factory_t m_factory;
+		std::deque<pool_connection_t> m_pool;
+		std::list<waiter*> m_waiters;
+		std::atomic<std::uint32_t> m_in_use;
+		std::atomic<std::uint64_t> m_exhausted;
+		std::atomic<std::uint64_t> m_timeouts;
+		rvision::core::histogram m_wait_time;
+		std::shared_ptr<rvision::core::logger> m_logger;
+	};
+}
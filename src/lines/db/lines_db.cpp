@@ -2,49 +2,27 @@
 
 namespace rvision
 {	
-	static const std::string db_name("rvision.db");
-	
-	lines_db::connection_pool::accessor::accessor(std::shared_ptr<rvision::core::logger> logger, lines_db::connection_pool& pool, std::uint32_t attemps, const std::chrono::seconds& wait)
-	: m_pool(pool), m_logger(logger)
+	namespace detail
 	{
-		try
+		static int get_checkpoint_mode(const std::string& mode)
 		{
-			while (attemps--)
+			static const std::map<std::string, int> _checkpoint_modes =
 			{
-				m_connection = m_pool.pop();
-				if (m_connection)
-				{
-					break;
-				}
-				if (!m_connection)
-				{
-					std::this_thread::sleep_for(wait);
-				}
-			}
-			if (!m_connection)
+				{"passive", SQLITE_CHECKPOINT_PASSIVE},
+				{"full", SQLITE_CHECKPOINT_FULL},
+				{"restart", SQLITE_CHECKPOINT_RESTART},
+				{"truncate", SQLITE_CHECKPOINT_TRUNCATE}
+			};
+
+			if (const auto& p = _checkpoint_modes.find(mode); p != _checkpoint_modes.end())
 			{
-				throw no_resource();
+				return p->second;
 			}
-		}
-		catch (const draining&)
-		{
-			m_logger->debug("connection_pool::accessor::accessor => drainig on connection: {}, with total count: {}", static_cast<void*>(m_connection.get()), m_pool.count());
-		}
-	}
 
-	lines_db::connection_pool::accessor::~accessor()
-	{
-		if (m_connection)
-		{
-			m_pool.push(std::move(m_connection));
+			return SQLITE_CHECKPOINT_PASSIVE;
 		}
 	}
-
-	lines_db::connection* lines_db::connection_pool::accessor::operator->() const noexcept
-	{
-		return m_connection.get();
-	}
-
+	
 	lines_db::connection::connection(const std::string& path, std::int32_t flags, std::shared_ptr<rvision::core::logger> logger)
 	:m_logger(logger)
 	{
@@ -71,7 +49,8 @@ namespace rvision
 
 	int lines_db::connection::busy_handler(void* ud, int count)
 	{
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		//back off 1, 2, 4, 8 ms before settling on 10 ms so short locks are retried quickly
+		std::this_thread::sleep_for(std::chrono::milliseconds(count < 4 ? (1 << count) : 10));
 
 		return 1;
 	}
@@ -120,304 +99,2651 @@ namespace rvision
 		return errc;
 	}
 
-	rvision::core::errc lines_db::connection::add_line(const std::string& line)
+	sqlite3_stmt* lines_db::connection::prepare(statements kind)
 	{
-		std::string _sql = std::string("CREATE TABLE IF NOT EXISTS ");
-		_sql += line;
-		_sql += " (id int AUTO_INCREMENT, score REAL, PRIMARY KEY (id)); CREATE INDEX IF NOT EXISTS score_index ON ";
-		_sql += line;
-		_sql += " (score ASC);";
-	
-		auto errc = execute(_sql);
-		if (errc != rvision::core::errc::success)
+		if (auto p = m_statements.find(kind); p != m_statements.end())
 		{
-			m_logger->error("connection::add_line => create table: {} error: {}", line, errc);
+			return p->second.get();
 		}
 
-		return errc;
+		const char* _sql = nullptr;
+
+		switch (kind)
+		{
+		case statements::add_line:
+			_sql = "INSERT OR IGNORE INTO lines (name) VALUES (?1);";
+			break;
+		case statements::line_id:
+			_sql = "SELECT line_id FROM lines WHERE name = ?1;";
+			break;
+		case statements::rem_line:
+			_sql = "DELETE FROM lines WHERE line_id = ?1;";
+			break;
+		case statements::rem_scores:
+			_sql = "DELETE FROM scores WHERE line_id = ?1;";
+			break;
+		case statements::update_line:
+			_sql = "INSERT INTO scores (line_id, ts, seq, score) VALUES (?1, ?2, (SELECT IFNULL(MAX(seq) + 1, 0) FROM scores WHERE line_id = ?1 AND ts = ?2), ?3);";
+			break;
+		case statements::last_score:
+			_sql = "SELECT ts, score FROM scores WHERE line_id = ?1 ORDER BY ts DESC, seq DESC LIMIT 1;";
+			break;
+		case statements::fetch_score:
+			_sql = "SELECT score FROM (SELECT ts, seq, score FROM scores WHERE line_id = ?1 ORDER BY ts DESC, seq DESC LIMIT ?2) ORDER BY ts, seq;";
+			break;
+		case statements::fetch_range:
+			_sql = "SELECT ts, score FROM scores WHERE line_id = ?1 AND ts >= ?2 AND ts <= ?3 ORDER BY ts, seq;";
+			break;
+		case statements::fetch_page:
+			_sql = "SELECT ts, score FROM scores WHERE line_id = ?1 AND ts >= ?2 AND ts <= ?3 ORDER BY ts, seq LIMIT ?4;";
+			break;
+		case statements::update_rollup:
+			_sql = "INSERT INTO rollups (line_id, level, bucket, first_ts, first_score, last_ts, last_score, min_score, max_score, sum_score, samples) "
+				"VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11) ON CONFLICT (line_id, level, bucket) DO UPDATE SET "
+				"first_score = CASE WHEN excluded.first_ts < first_ts THEN excluded.first_score ELSE first_score END, first_ts = MIN(first_ts, excluded.first_ts), "
+				"last_score = CASE WHEN excluded.last_ts >= last_ts THEN excluded.last_score ELSE last_score END, last_ts = MAX(last_ts, excluded.last_ts), "
+				"min_score = MIN(min_score, excluded.min_score), max_score = MAX(max_score, excluded.max_score), "
+				"sum_score = sum_score + excluded.sum_score, samples = samples + excluded.samples;";
+			break;
+		case statements::fetch_rollups:
+			_sql = "SELECT bucket, first_ts, first_score, last_ts, last_score, min_score, max_score, sum_score, samples FROM rollups "
+				"WHERE line_id = ?1 AND level = ?2 AND bucket >= ?3 AND bucket <= ?4 ORDER BY bucket;";
+			break;
+		case statements::rem_rollups:
+			_sql = "DELETE FROM rollups WHERE line_id = ?1;";
+			break;
+		case statements::retain_scores:
+			_sql = "DELETE FROM scores WHERE line_id = ?1 AND (ts, seq) IN (SELECT ts, seq FROM scores WHERE line_id = ?1 AND ts < ?2 ORDER BY ts, seq LIMIT ?3);";
+			break;
+		case statements::retain_blocks:
+			_sql = "DELETE FROM score_blocks WHERE block_id IN (SELECT block_id FROM score_blocks WHERE line_id = ?1 AND ts_to < ?2 ORDER BY ts_from, block_id LIMIT ?3);";
+			break;
+		case statements::retain_rollups:
+			_sql = "DELETE FROM rollups WHERE line_id = ?1 AND (level, bucket) IN (SELECT level, bucket FROM rollups WHERE line_id = ?1 AND bucket + level <= ?2 LIMIT ?3);";
+			break;
+		case statements::cutoff_scores:
+			_sql = "SELECT ts FROM scores WHERE line_id = ?1 ORDER BY ts DESC LIMIT 1 OFFSET ?2;";
+			break;
+		case statements::cutoff_rows:
+			_sql = "SELECT ts FROM scores WHERE line_id = ?1 ORDER BY ts DESC, seq DESC;";
+			break;
+		case statements::last_scores:
+			_sql = "SELECT s.line_id, s.ts, s.score FROM json_each(?1) AS j JOIN scores AS s ON s.line_id = j.value AND (s.ts, s.seq) = "
+				"(SELECT ts, seq FROM scores WHERE line_id = j.value ORDER BY ts DESC, seq DESC LIMIT 1);";
+			break;
+		case statements::cutoff_blocks:
+			_sql = "SELECT ts_from, ts_to, rows FROM score_blocks WHERE line_id = ?1 ORDER BY ts_to DESC, block_id DESC;";
+			break;
+		case statements::rem_blocks:
+			_sql = "DELETE FROM score_blocks WHERE line_id = ?1;";
+			break;
+		case statements::seal_rows:
+			_sql = "SELECT ts, seq, score FROM scores WHERE line_id = ?1 ORDER BY ts, seq LIMIT ?2;";
+			break;
+		case statements::seal_block:
+			_sql = "INSERT INTO score_blocks (line_id, ts_from, ts_to, rows, data) VALUES (?1, ?2, ?3, ?4, ?5);";
+			break;
+		case statements::seal_delete:
+			_sql = "DELETE FROM scores WHERE line_id = ?1 AND (ts, seq) <= (?2, ?3);";
+			break;
+		case statements::tail_blocks:
+			_sql = "SELECT data FROM score_blocks WHERE line_id = ?1 ORDER BY ts_from DESC, block_id DESC;";
+			break;
+		case statements::range_blocks:
+			_sql = "SELECT data FROM score_blocks WHERE line_id = ?1 AND ts_from <= ?3 AND ts_to >= ?2 ORDER BY ts_from, block_id;";
+			break;
+		case statements::last_block:
+			_sql = "SELECT data FROM score_blocks WHERE line_id = ?1 ORDER BY ts_from DESC, block_id DESC LIMIT 1;";
+			break;
+		default:
+			m_logger->error("connection::prepare => unsupported statement: {}", static_cast<int>(kind));
+			return nullptr;
+		}
+
+		m_logger->debug("connection::prepare => sql: {}", _sql);
+
+		sqlite3_stmt* stmt = nullptr;
+		auto result = sqlite3_prepare_v3(m_connection.get(), _sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+
+		if (result != SQLITE_OK)
+		{
+			m_logger->error("connection::prepare => sql: {} error: {}", _sql, sqlite3_errmsg(m_connection.get()));
+
+			sqlite3_finalize(stmt);
+
+			return nullptr;
+		}
+
+		m_statements.emplace(kind, statement_ptr(stmt));
+
+		return stmt;
 	}
-	
-	rvision::core::errc lines_db::connection::rem_line(const std::string& line)
+
+	void lines_db::connection::finalize(statements kind)
 	{
-		std::string _sql = std::string("DROP TABLE ");
-		_sql += line;
-		_sql += ";";
-	
-		auto errc = execute(_sql);
+		m_statements.erase(kind);
+	}
+
+	rvision::core::errc lines_db::connection::decode_block(sqlite3_stmt* stmt, int column, std::vector<score_sample>& samples)
+	{
+		auto _data = static_cast<const std::uint8_t*>(sqlite3_column_blob(stmt, column));
+		auto _size = static_cast<std::size_t>(sqlite3_column_bytes(stmt, column));
+
+		auto errc = score_codec::decode(_data, _size, samples);
 		if (errc != rvision::core::errc::success)
 		{
-			m_logger->error("connection::rem_line => remove table: {} error: {}", line, errc);
+			m_logger->error("connection::decode_block => corrupt block of {} bytes", _size);
 		}
 
 		return errc;
 	}
-	
-	rvision::core::errc lines_db::connection::update_line(const std::string& line, std::double_t score)
+
+	rvision::core::errc lines_db::connection::retrieve_error(sqlite3_stmt* stmt, int sres)
+	{
+		if (sres == SQLITE_OK || sres == SQLITE_DONE || sres == SQLITE_ROW)
+		{
+			return rvision::core::errc::success;
+		}
+
+		m_logger->error("connection::step => sql: {} failed! Error: {}", sqlite3_sql(stmt), sqlite3_errmsg(m_connection.get()));
+
+		return rvision::core::errc::fail;
+	}
+
+	rvision::core::errc lines_db::connection::checkpoint(int mode, int& wal_frames, int& checkpointed)
 	{
-		std::string _sql = std::string("INSERT INTO ");
-		_sql += line;
-		_sql += " (score) values (";
-		_sql += std::to_string(score);
-		_sql += ");";
+		auto result = sqlite3_wal_checkpoint_v2(m_connection.get(), nullptr, mode, &wal_frames, &checkpointed);
 
-		auto errc = execute(_sql);
-		if (errc != rvision::core::errc::success)
+		if (result != SQLITE_OK && result != SQLITE_BUSY)
 		{
-			m_logger->error("connection::update_line => update table: {} error: {}", line, errc);
+			m_logger->error("connection::checkpoint => mode: {} error: {}", mode, sqlite3_errmsg(m_connection.get()));
+
+			return rvision::core::errc::fail;
 		}
 
-		return errc;
+		return rvision::core::errc::success;
 	}
-	
-	rvision::core::errc lines_db::connection::last_score(const std::string& line, std::double_t& score)
+
+	rvision::core::errc lines_db::connection::pragma(const std::string& name, std::int64_t& value)
 	{
-		std::string _sql = std::string("SELECT * FROM ");
-		_sql += line;
-		_sql += " ORDERED BY rowid DESC LIMIT 1;";
-	
-		char* error_str = nullptr;
-		auto result = sqlite3_exec(m_connection.get(), _sql.c_str(), [](void *data, int argc, char **argv, char **column)
-		{ 
-			std::double_t* _score = (std::double_t*)data;
+		std::string _sql("PRAGMA ");
+		_sql += name;
+		_sql += ";";
 
-			return 1;
-		},
-		(void*)(&score), &error_str);
+		sqlite3_stmt* stmt = nullptr;
+		auto result = sqlite3_prepare_v2(m_connection.get(), _sql.c_str(), -1, &stmt, nullptr);
 
-		auto errc = retrieve_error(_sql, result, error_str);
-		if (errc != rvision::core::errc::success)
+		if (result != SQLITE_OK)
 		{
-			m_logger->error("connection::last_score => fetch table: {} error: {}", line, errc);
+			m_logger->error("connection::pragma => sql: {} error: {}", _sql, sqlite3_errmsg(m_connection.get()));
+
+			sqlite3_finalize(stmt);
+
+			return rvision::core::errc::fail;
+		}
+
+		result = sqlite3_step(stmt);
+
+		if (result == SQLITE_ROW)
+		{
+			value = sqlite3_column_int64(stmt, 0);
 		}
 
+		auto errc = retrieve_error(stmt, result);
+
+		sqlite3_finalize(stmt);
+
 		return errc;
 	}
-	
-	rvision::core::errc lines_db::connection::fetch_score(const std::string& line, std::vector<std::double_t>& score)
+
+	bool lines_db::connection::has_column(const std::string& table, const std::string& column)
 	{
-		int _portion = 100;
+		sqlite3_stmt* stmt = nullptr;
+		sqlite3_prepare_v2(m_connection.get(), "SELECT 1 FROM pragma_table_info(?1) WHERE name = ?2;", -1, &stmt, nullptr);
 
-		std::string _sql = std::string("SELECT * FROM");
-		_sql += line;
-		_sql += "ORDERED BY id LIMIT ";
-		_sql += _portion;
-		_sql += ";";
-	
-		char* error_str = nullptr;
-		auto result = sqlite3_exec(m_connection.get(), _sql.c_str(), [](void *data, int argc, char **argv, char **column)
-		{ 
-			std::vector<std::double_t>* _score = (std::vector<std::double_t>*)data;
+		sqlite3_bind_text(stmt, 1, table.c_str(), static_cast<int>(table.size()), SQLITE_TRANSIENT);
+		sqlite3_bind_text(stmt, 2, column.c_str(), static_cast<int>(column.size()), SQLITE_TRANSIENT);
+
+		auto _found = sqlite3_step(stmt) == SQLITE_ROW;
+
+		sqlite3_finalize(stmt);
+
+		return _found;
+	}
 
-			return 1;
-		},
-		(void*)(&score), &error_str);
+	rvision::core::errc lines_db::connection::migrate()
+	{
+		//one table per line with a useless score index -> lines dictionary + one scores table clustered on (line_id, ts, seq),
+		//seq keeps the samples that share a millisecond
+		auto errc = execute("CREATE TABLE IF NOT EXISTS lines (line_id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL UNIQUE);"
+			"CREATE TABLE IF NOT EXISTS scores (line_id INTEGER NOT NULL, ts INTEGER NOT NULL, seq INTEGER NOT NULL, score REAL, PRIMARY KEY (line_id, ts, seq)) WITHOUT ROWID;"
+			"CREATE TABLE IF NOT EXISTS score_blocks (block_id INTEGER PRIMARY KEY, line_id INTEGER NOT NULL, ts_from INTEGER NOT NULL, ts_to INTEGER NOT NULL, rows INTEGER NOT NULL, data BLOB NOT NULL);"
+			"CREATE INDEX IF NOT EXISTS score_blocks_line ON score_blocks (line_id, ts_from);"
+			"CREATE TABLE IF NOT EXISTS rollups (line_id INTEGER NOT NULL, level INTEGER NOT NULL, bucket INTEGER NOT NULL, first_ts INTEGER NOT NULL, first_score REAL, "
+			"last_ts INTEGER NOT NULL, last_score REAL, min_score REAL, max_score REAL, sum_score REAL, samples INTEGER NOT NULL, PRIMARY KEY (line_id, level, bucket)) WITHOUT ROWID;");
 
-		auto errc = retrieve_error(_sql, result, error_str);
 		if (errc != rvision::core::errc::success)
 		{
-			m_logger->error("connection::fetch_score => fetch table: {} error: {}", line, errc);
+			return errc;
 		}
 
-		return errc;
-	}
-		
-	lines_db::connection_pool::connection_pool(std::uint32_t size, const pool_connection_factory_t& factory)
-		:m_factory(factory), m_drainig(false), m_max(size), m_curr(0)
-	{
-		while (size--)
+		std::int64_t _version = 0;
+
+		errc = pragma("user_version", _version);
+		if (errc != rvision::core::errc::success || _version >= schema_version)
 		{
-			push(m_factory());
+			return errc;
 		}
-	}
 
-	lines_db::connection_pool::~connection_pool()
-	{
-		m_logger->info("connection_pool::~connection_pool => before pool_max_size: {}, pool_size: {}", m_max.load(), m_curr.load());
+		errc = execute("BEGIN IMMEDIATE;");
+		if (errc != rvision::core::errc::success)
+		{
+			return errc;
+		}
+
+		//the version is stamped only once every legacy table is copied, a skipped one is retried on the next start
+		bool _complete = true;
+
+		errc = migrate_tables(_complete);
+
+		if (errc == rvision::core::errc::success && _complete)
+		{
+			errc = execute("PRAGMA user_version = " + std::to_string(schema_version) + ";");
+		}
 
-		m_drainig.store(true);
+		if (errc == rvision::core::errc::success)
+		{
+			errc = execute("COMMIT;");
+		}
 
-		while (m_max != m_curr)
+		if (errc != rvision::core::errc::success)
 		{
-			;
+			execute("ROLLBACK;");
 		}
 
-		m_logger->info("connection_pool::~connection_pool => after pool_max_size: {}, pool_size: {}", m_max.load(), m_curr.load());
+		m_statements.clear();
+
+		return errc;
 	}
 
-	lines_db::connection_pool::pool_connection_t lines_db::connection_pool::pop()
+	rvision::core::errc lines_db::connection::migrate_tables(bool& complete)
 	{
-		if (m_drainig)
+		std::vector<std::string> _tables;
+
+		sqlite3_stmt* stmt = nullptr;
+		sqlite3_prepare_v2(m_connection.get(), "SELECT name FROM sqlite_master WHERE type = 'table' AND name NOT IN ('lines', 'scores', 'score_blocks', 'rollups') AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\';", -1, &stmt, nullptr);
+
+		while (sqlite3_step(stmt) == SQLITE_ROW)
 		{
-			throw draining();
+			_tables.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
 		}
 
-		std::unique_lock<std::mutex> lock(m_lock);
+		sqlite3_finalize(stmt);
+
+		m_logger->info("connection::migrate_tables => migrate {} per-line tables to scores", _tables.size());
 
-		if (!m_pool.empty())
+		//a table without a time column gets the migration time for its newest row and one millisecond less for each older row
+		auto _now = score_now();
+
+		for (const auto& t : _tables)
 		{
-			auto conn = std::move(m_pool.front());
+			auto _table = boost::replace_all_copy(t, "\"", "\"\"");
+
+			std::string _ts;
+
+			for (auto column : {"ts", "timestamp"})
+			{
+				if (has_column(t, column))
+				{
+					_ts = std::string("\"") + column + "\"";
+
+					break;
+				}
+			}
+
+			if (_ts.empty())
+			{
+				m_logger->warn("connection::migrate_tables => table: {} has no time column, rows are timed back from {} in insertion order", t, _now);
+
+				_ts = std::to_string(_now) + " - (SELECT MAX(rowid) FROM \"" + _table + "\") + rowid";
+			}
+
+			auto errc = execute("SAVEPOINT migrate_table;");
+
+			line_id_t _id = 0;
+
+			if (errc == rvision::core::errc::success)
+			{
+				errc = add_line(t, _id);
+			}
+
+			if (errc == rvision::core::errc::success)
+			{
+				std::string _sql("INSERT INTO scores (line_id, ts, seq, score) SELECT ");
+				_sql += std::to_string(_id);
+				_sql += ", t.ts, ROW_NUMBER() OVER (PARTITION BY t.ts ORDER BY t.rowid) - 1 + IFNULL((SELECT MAX(seq) + 1 FROM scores WHERE line_id = ";
+				_sql += std::to_string(_id);
+				_sql += " AND ts = t.ts), 0), t.score FROM (SELECT rowid, ";
+				_sql += _ts;
+				_sql += " AS ts, score FROM \"";
+				_sql += _table;
+				_sql += "\") AS t; DROP TABLE \"";
+				_sql += _table;
+				_sql += "\";";
+
+				errc = execute(_sql);
+			}
+
+			if (errc == rvision::core::errc::success)
+			{
+				errc = execute("RELEASE migrate_table;");
+			}
 
-			m_pool.pop_front();
+			if (errc != rvision::core::errc::success)
+			{
+				m_logger->error("connection::migrate_tables => table: {} is skipped", t);
 
-			--m_curr;
+				execute("ROLLBACK TO migrate_table; RELEASE migrate_table;");
 
-			return std::move(conn);
+				complete = false;
+			}
 		}
 
-		return nullptr;
+		return rvision::core::errc::success;
 	}
 
-	void lines_db::connection_pool::push(pool_connection_t&& conn)
+	rvision::core::errc lines_db::connection::lines(std::unordered_map<std::string, line_id_t>& lines)
 	{
-		std::unique_lock<std::mutex> lock(m_lock);
+		sqlite3_stmt* stmt = nullptr;
+		sqlite3_prepare_v2(m_connection.get(), "SELECT line_id, name FROM lines;", -1, &stmt, nullptr);
 
-		m_pool.emplace_back(std::move(conn));
+		auto result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW)
+		{
+			lines[reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1))] = sqlite3_column_int64(stmt, 0);
 
-		++m_curr;
-	}
+			result = sqlite3_step(stmt);
+		}
 
-	std::uint32_t lines_db::connection_pool::count() const
-	{
-		return m_curr.load();
+		auto errc = retrieve_error(stmt, result);
+
+		sqlite3_finalize(stmt);
+
+		return errc;
 	}
 
-	std::uint32_t lines_db::connection_pool::add()
+	rvision::core::errc lines_db::connection::add_line(const std::string& line, line_id_t& id)
 	{
-		std::unique_lock<std::mutex> lock(m_lock);
+		auto stmt = prepare(statements::add_line);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
 
-		m_pool.emplace_back(m_factory());
+		sqlite3_bind_text(stmt, 1, line.c_str(), static_cast<int>(line.size()), SQLITE_TRANSIENT);
 
-		return m_curr;
-	}
+		auto errc = retrieve_error(stmt, sqlite3_step(stmt));
 
-	lines_db::lines_db(const std::string& path, std::shared_ptr<rvision::core::logger> logger)
-		: m_logger(logger), m_db_path(path)
-	{
-		m_db_path += db_name;
+		sqlite3_reset(stmt);
+
+		if (errc == rvision::core::errc::success)
+		{
+			stmt = prepare(statements::line_id);
+			if (!stmt)
+			{
+				return rvision::core::errc::fail;
+			}
 
-		std::uint32_t pool_size = 2 * std::thread::hardware_concurrency();
+			sqlite3_bind_text(stmt, 1, line.c_str(), static_cast<int>(line.size()), SQLITE_TRANSIENT);
 
-		m_logger->info("lines_db::lines_db => path : {} db_path : {}, connection pool size : {}",path, m_db_path, pool_size);
-		
-		init();
-				
-		m_pool = std::make_unique<connection_pool>(pool_size, [&]()
+			auto result = sqlite3_step(stmt);
+			if (result == SQLITE_ROW)
+			{
+				id = sqlite3_column_int64(stmt, 0);
+			}
+
+			errc = retrieve_error(stmt, result);
+
+			sqlite3_reset(stmt);
+		}
+
+		if (errc != rvision::core::errc::success)
 		{
-			std::int32_t _flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX;
+			m_logger->error("connection::add_line => add line: {} error: {}", line, errc);
+		}
 
-			auto _connection = std::make_unique<connection>(m_db_path, _flags, logger);
-				
-			return _connection;
-		});
+		return errc;
 	}
-
-	lines_db::~lines_db()
+	
+	rvision::core::errc lines_db::connection::rem_line(line_id_t line)
 	{
-		m_logger->debug("lines_db::~lines_db().");
-	}	
+		auto errc = rvision::core::errc::success;
 
-	void lines_db::init()
-	{		
-		std::int32_t flags = std::filesystem::exists(m_db_path) ? SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX
-			: SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX;
+		for (auto kind : {statements::rem_scores, statements::rem_blocks, statements::rem_rollups, statements::rem_line})
+		{
+			auto stmt = prepare(kind);
+			if (!stmt)
+			{
+				return rvision::core::errc::fail;
+			}
 
-		auto init_connection = std::make_unique<connection>(m_db_path, flags, m_logger);
+			sqlite3_bind_int64(stmt, 1, line);
 
-		init_connection->execute("PRAGMA auto_vacuum = 2;");
-		init_connection->execute("PRAGMA incremental_vacuum(10000);");
+			errc = retrieve_error(stmt, sqlite3_step(stmt));
+
+			sqlite3_reset(stmt);
+
+			if (errc != rvision::core::errc::success)
+			{
+				m_logger->error("connection::rem_line => remove line: {} error: {}", line, errc);
+				break;
+			}
+		}
 
-		init_connection->execute("VACUUM;");		
+		return errc;
 	}
 	
-	rvision::core::errc lines_db::add_line(const std::string& line)
+	rvision::core::errc lines_db::connection::update_line(line_id_t line, const score_sample& sample)
 	{
-		try
+		auto stmt = prepare(statements::update_line);
+		if (!stmt)
 		{
-			m_logger->debug("lines_db::add_line => try to add line: {}", line);
+			return rvision::core::errc::fail;
+		}
 
-			connection_pool::accessor accessor(m_logger, *m_pool, 100, std::chrono::seconds(1));
+		sqlite3_bind_int64(stmt, 1, line);
+		sqlite3_bind_int64(stmt, 2, sample.ts);
+		sqlite3_bind_double(stmt, 3, sample.score);
 
-			return accessor->add_line(line);
-		}
-		catch (const connection_pool::no_resource& )
+		auto errc = retrieve_error(stmt, sqlite3_step(stmt));
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
 		{
-			m_logger->error("lines_db::add_line: connection_pool::no_resource for line: {}", line);
-			
-			return rvision::core::errc::insufficient_resources;
+			m_logger->error("connection::update_line => update line: {} error: {}", line, errc);
 		}
 
-		return rvision::core::errc::fail;
+		return errc;
 	}
-		
-	rvision::core::errc lines_db::rem_line(const std::string& line)
+
+	rvision::core::errc lines_db::connection::update_lines(const std::vector<score_update>& scores, const std::vector<rollup_update>& rollups)
 	{
-		try
+		auto errc = execute("BEGIN IMMEDIATE;");
+		if (errc != rvision::core::errc::success)
 		{
-			m_logger->debug("lines_db::rem_line => try to rem line: {}", line);
+			m_logger->error("connection::update_lines => begin transaction for {} scores error: {}", scores.size(), errc);
 
-			connection_pool::accessor accessor(m_logger, *m_pool, 100, std::chrono::seconds(1));
+			return errc;
+		}
 
-			return accessor->rem_line(line);
+		//the batch is all or nothing, a row that fails rolls back the rest so the caller never counts it as written
+		for (const auto& s : scores)
+		{
+			if (errc = update_line(s.line, s.sample); errc != rvision::core::errc::success)
+			{
+				break;
+			}
 		}
-		catch (const connection_pool::no_resource& )
+
+		for (const auto& r : rollups)
 		{
-			m_logger->error("lines_db::rem_line: connection_pool::no_resource for line: {}", line);
-			
-			return rvision::core::errc::insufficient_resources;
+			if (errc != rvision::core::errc::success)
+			{
+				break;
+			}
+
+			errc = update_rollup(r);
 		}
 
-		return rvision::core::errc::fail;
+		if (errc == rvision::core::errc::success)
+		{
+			errc = execute("COMMIT;");
+		}
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::update_lines => {} scores, {} rollups rolled back, error: {}", scores.size(), rollups.size(), errc);
+
+			execute("ROLLBACK;");
+		}
+
+		return errc;
 	}
-	
-	rvision::core::errc lines_db::update_line(const std::string& line, std::double_t score)
+
+	rvision::core::errc lines_db::connection::update_rollup(const rollup_update& rollup)
 	{
-		try
+		auto stmt = prepare(statements::update_rollup);
+		if (!stmt)
 		{
-			m_logger->debug("lines_db::update_line => try to updt line: {}", line);
+			return rvision::core::errc::fail;
+		}
 
-			connection_pool::accessor accessor(m_logger, *m_pool, 100, std::chrono::seconds(1));
+		const auto& _r = rollup.rollup;
 
-			return accessor->add_line(line);
-		}
-		catch (const connection_pool::no_resource& )
+		sqlite3_bind_int64(stmt, 1, rollup.line);
+		sqlite3_bind_int64(stmt, 2, rollup.level);
+		sqlite3_bind_int64(stmt, 3, _r.bucket);
+		sqlite3_bind_int64(stmt, 4, _r.first_ts);
+		sqlite3_bind_double(stmt, 5, _r.first);
+		sqlite3_bind_int64(stmt, 6, _r.last_ts);
+		sqlite3_bind_double(stmt, 7, _r.last);
+		sqlite3_bind_double(stmt, 8, _r.min);
+		sqlite3_bind_double(stmt, 9, _r.max);
+		sqlite3_bind_double(stmt, 10, _r.sum);
+		sqlite3_bind_int64(stmt, 11, static_cast<std::int64_t>(_r.count));
+
+		auto errc = retrieve_error(stmt, sqlite3_step(stmt));
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
 		{
-			m_logger->error("lines_db::update_line: connection_pool::no_resource for line: {}", line);
-			
-			return rvision::core::errc::insufficient_resources;
+			m_logger->error("connection::update_rollup => update line: {} level: {} bucket: {} error: {}", rollup.line, rollup.level, _r.bucket, errc);
 		}
 
-		return rvision::core::errc::fail;
+		return errc;
 	}
-	
-	rvision::core::errc lines_db::last_score(const std::string& line, std::double_t& score)
+
+	rvision::core::errc lines_db::connection::fetch_rollups(line_id_t line, std::int64_t level, std::int64_t from, std::int64_t to, std::vector<score_rollup>& rollups)
 	{
-		try
+		auto stmt = prepare(statements::fetch_rollups);
+		if (!stmt)
 		{
-			m_logger->debug("lines_db::last_score => try to get last score for line: {}", line);
-			
-			connection_pool::accessor accessor(m_logger, *m_pool, 100, std::chrono::seconds(1));
+			return rvision::core::errc::fail;
+		}
 
-			return accessor->last_score(line, score);
+		sqlite3_bind_int64(stmt, 1, line);
+		sqlite3_bind_int64(stmt, 2, level);
+		sqlite3_bind_int64(stmt, 3, from);
+		sqlite3_bind_int64(stmt, 4, to);
+
+		auto result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW)
+		{
+			score_rollup _r;
+			_r.bucket = sqlite3_column_int64(stmt, 0);
+			_r.first_ts = sqlite3_column_int64(stmt, 1);
+			_r.first = sqlite3_column_double(stmt, 2);
+			_r.last_ts = sqlite3_column_int64(stmt, 3);
+			_r.last = sqlite3_column_double(stmt, 4);
+			_r.min = sqlite3_column_double(stmt, 5);
+			_r.max = sqlite3_column_double(stmt, 6);
+			_r.sum = sqlite3_column_double(stmt, 7);
+			_r.count = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 8));
+
+			rollups.emplace_back(_r);
+
+			result = sqlite3_step(stmt);
 		}
-		catch (const connection_pool::no_resource& )
+
+		auto errc = retrieve_error(stmt, result);
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
 		{
-			m_logger->error("lines_db::last_score: connection_pool::no_resource for line: {}", line);
-			
-			return rvision::core::errc::insufficient_resources;
+			m_logger->error("connection::fetch_rollups => fetch line: {} level: {} range: [{}, {}] error: {}", line, level, from, to, errc);
+
+			finalize(statements::fetch_rollups);
 		}
 
-		return rvision::core::errc::fail;
+		return errc;
 	}
-	
-	rvision::core::errc lines_db::fetch_score(const std::string& line, std::vector<std::double_t>& score)
+
+	rvision::core::errc lines_db::connection::last_score(line_id_t line, score_sample& sample)
 	{
+		auto stmt = prepare(statements::last_score);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+
+		auto result = sqlite3_step(stmt);
+		if (result == SQLITE_ROW)
+		{
+			sample.ts = sqlite3_column_int64(stmt, 0);
+			sample.score = sqlite3_column_double(stmt, 1);
+		}
+
+		auto errc = retrieve_error(stmt, result);
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::last_score => fetch line: {} error: {}", line, errc);
+
+			finalize(statements::last_score);
+		}
+		else if (result == SQLITE_DONE)
+		{
+			errc = last_block(line, sample);
+		}
+
+		return errc;
+	}
+
+	rvision::core::errc lines_db::connection::last_scores(const std::string& lines, std::unordered_map<line_id_t, score_sample>& samples)
+	{
+		//lines is a json array of line ids, every id is one primary key probe
+		auto stmt = prepare(statements::last_scores);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_text(stmt, 1, lines.c_str(), static_cast<int>(lines.size()), SQLITE_STATIC);
+
+		auto result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW)
+		{
+			samples[sqlite3_column_int64(stmt, 0)] = score_sample{sqlite3_column_int64(stmt, 1), sqlite3_column_double(stmt, 2)};
+
+			result = sqlite3_step(stmt);
+		}
+
+		auto errc = retrieve_error(stmt, result);
+
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::last_scores => lines: {} error: {}", lines, errc);
+
+			finalize(statements::last_scores);
+		}
+
+		return errc;
+	}
+
+	rvision::core::errc lines_db::connection::last_block(line_id_t line, score_sample& sample)
+	{
+		auto stmt = prepare(statements::last_block);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+
+		std::vector<score_sample> _samples;
+
+		auto result = sqlite3_step(stmt);
+		auto errc = result == SQLITE_ROW ? decode_block(stmt, 0, _samples) : retrieve_error(stmt, result);
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::last_block => fetch line: {} error: {}", line, errc);
+
+			finalize(statements::last_block);
+		}
+		else if (_samples.empty())
+		{
+			errc = rvision::core::errc::not_found;
+		}
+		else
+		{
+			sample = _samples.back();
+		}
+
+		return errc;
+	}
+	
+	rvision::core::errc lines_db::connection::fetch_score(line_id_t line, std::vector<std::double_t>& score)
+	{
+		std::size_t _portion = fetch_portion;
+
+		//raw rows hold the newest samples, sealed blocks are only read when there are too few of them
+		auto stmt = prepare(statements::fetch_score);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+		sqlite3_bind_int(stmt, 2, static_cast<int>(_portion));
+
+		std::vector<std::double_t> _raw;
+		_raw.reserve(_portion);
+
+		auto result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW)
+		{
+			_raw.emplace_back(sqlite3_column_double(stmt, 0));
+
+			result = sqlite3_step(stmt);
+		}
+
+		auto errc = retrieve_error(stmt, result);
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::fetch_score => fetch line: {} error: {}", line, errc);
+
+			finalize(statements::fetch_score);
+
+			return errc;
+		}
+
+		//newest block first, each decoded block goes in front of the samples taken so far
+		std::vector<score_sample> _samples;
+
+		if (_raw.size() < _portion)
+		{
+			stmt = prepare(statements::tail_blocks);
+			if (!stmt)
+			{
+				return rvision::core::errc::fail;
+			}
+
+			sqlite3_bind_int64(stmt, 1, line);
+
+			std::vector<score_sample> _block;
+
+			result = sqlite3_step(stmt);
+			while (result == SQLITE_ROW && errc == rvision::core::errc::success && _raw.size() + _samples.size() < _portion)
+			{
+				_block.clear();
+
+				errc = decode_block(stmt, 0, _block);
+
+				_samples.insert(_samples.begin(), _block.begin(), _block.end());
+
+				result = sqlite3_step(stmt);
+			}
+
+			if (errc == rvision::core::errc::success)
+			{
+				errc = retrieve_error(stmt, result);
+			}
+
+			sqlite3_reset(stmt);
+
+			if (errc != rvision::core::errc::success)
+			{
+				m_logger->error("connection::fetch_score => fetch blocks of line: {} error: {}", line, errc);
+
+				finalize(statements::tail_blocks);
+
+				return errc;
+			}
+		}
+
+		auto _taken = std::min(_samples.size(), _portion - _raw.size());
+
+		score.reserve(score.size() + _taken + _raw.size());
+
+		for (auto i = _samples.size() - _taken; i < _samples.size(); ++i)
+		{
+			score.emplace_back(_samples[i].score);
+		}
+
+		score.insert(score.end(), _raw.begin(), _raw.end());
+
+		return errc;
+	}
+
+	rvision::core::errc lines_db::connection::fetch_score(line_id_t line, std::int64_t from, std::int64_t to, std::vector<score_sample>& samples)
+	{
+		auto _first = samples.size();
+
+		auto stmt = prepare(statements::range_blocks);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+		sqlite3_bind_int64(stmt, 2, from);
+		sqlite3_bind_int64(stmt, 3, to);
+
+		std::vector<score_sample> _block;
+		auto errc = rvision::core::errc::success;
+
+		auto result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW && errc == rvision::core::errc::success)
+		{
+			_block.clear();
+
+			errc = decode_block(stmt, 0, _block);
+
+			std::copy_if(_block.begin(), _block.end(), std::back_inserter(samples), [from, to](const score_sample& s) { return s.ts >= from && s.ts <= to; });
+
+			result = sqlite3_step(stmt);
+		}
+
+		if (errc == rvision::core::errc::success)
+		{
+			errc = retrieve_error(stmt, result);
+		}
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::fetch_score => fetch blocks of line: {} range: [{}, {}] error: {}", line, from, to, errc);
+
+			finalize(statements::range_blocks);
+
+			return errc;
+		}
+
+		stmt = prepare(statements::fetch_range);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+		sqlite3_bind_int64(stmt, 2, from);
+		sqlite3_bind_int64(stmt, 3, to);
+
+		result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW)
+		{
+			samples.emplace_back(score_sample{sqlite3_column_int64(stmt, 0), sqlite3_column_double(stmt, 1)});
+
+			result = sqlite3_step(stmt);
+		}
+
+		errc = retrieve_error(stmt, result);
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::fetch_score => fetch line: {} range: [{}, {}] error: {}", line, from, to, errc);
+
+			finalize(statements::fetch_range);
+		}
+
+		//late samples may land behind a sealed block
+		auto _cmp = [](const score_sample& l, const score_sample& r) { return l.ts < r.ts; };
+
+		if (!std::is_sorted(samples.begin() + _first, samples.end(), _cmp))
+		{
+			std::stable_sort(samples.begin() + _first, samples.end(), _cmp);
+		}
+
+		return errc;
+	}
+
+	rvision::core::errc lines_db::connection::fetch_page(line_id_t line, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, std::vector<score_sample>& samples)
+	{
+		samples.clear();
+
+		//the skipped samples of ts from are read too, blocks and raw rows are only ordered once merged
+		std::size_t _wanted = static_cast<std::size_t>(page) + skip;
+
+		auto stmt = prepare(statements::range_blocks);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+		sqlite3_bind_int64(stmt, 2, from);
+		sqlite3_bind_int64(stmt, 3, to);
+
+		std::vector<score_sample> _block;
+		auto errc = rvision::core::errc::success;
+
+		//blocks are decoded one at a time and only until the page is full
+		auto result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW && errc == rvision::core::errc::success && samples.size() < _wanted)
+		{
+			_block.clear();
+
+			errc = decode_block(stmt, 0, _block);
+
+			std::copy_if(_block.begin(), _block.end(), std::back_inserter(samples), [from, to](const score_sample& s) { return s.ts >= from && s.ts <= to; });
+
+			result = sqlite3_step(stmt);
+		}
+
+		if (errc == rvision::core::errc::success)
+		{
+			errc = retrieve_error(stmt, result);
+		}
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::fetch_page => fetch blocks of line: {} from: {} error: {}", line, from, errc);
+
+			finalize(statements::range_blocks);
+
+			return errc;
+		}
+
+		stmt = prepare(statements::fetch_page);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+		sqlite3_bind_int64(stmt, 2, from);
+		sqlite3_bind_int64(stmt, 3, to);
+		sqlite3_bind_int64(stmt, 4, static_cast<std::int64_t>(_wanted));
+
+		auto _cmp = [](const score_sample& l, const score_sample& r) { return l.ts < r.ts; };
+
+		if (!std::is_sorted(samples.begin(), samples.end(), _cmp))
+		{
+			std::stable_sort(samples.begin(), samples.end(), _cmp);
+		}
+
+		auto _raw = samples.size();
+
+		result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW)
+		{
+			samples.emplace_back(score_sample{sqlite3_column_int64(stmt, 0), sqlite3_column_double(stmt, 1)});
+
+			result = sqlite3_step(stmt);
+		}
+
+		errc = retrieve_error(stmt, result);
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::fetch_page => fetch line: {} from: {} error: {}", line, from, errc);
+
+			finalize(statements::fetch_page);
+
+			return errc;
+		}
+
+		std::inplace_merge(samples.begin(), samples.begin() + _raw, samples.end(), _cmp);
+
+		auto _skipped = std::find_if(samples.begin(), samples.begin() + std::min<std::size_t>(skip, samples.size()), [from](const score_sample& s) { return s.ts != from; });
+
+		samples.erase(samples.begin(), _skipped);
+
+		if (samples.size() > page)
+		{
+			samples.resize(page);
+		}
+
+		return errc;
+	}
+
+	rvision::core::errc lines_db::connection::raw_rows(std::unordered_map<line_id_t, std::uint32_t>& rows)
+	{
+		sqlite3_stmt* stmt = nullptr;
+		sqlite3_prepare_v2(m_connection.get(), "SELECT line_id, COUNT(*) FROM scores GROUP BY line_id;", -1, &stmt, nullptr);
+
+		auto result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW)
+		{
+			rows[sqlite3_column_int64(stmt, 0)] = static_cast<std::uint32_t>(sqlite3_column_int64(stmt, 1));
+
+			result = sqlite3_step(stmt);
+		}
+
+		auto errc = retrieve_error(stmt, result);
+
+		sqlite3_finalize(stmt);
+
+		return errc;
+	}
+
+	rvision::core::errc lines_db::connection::seal(line_id_t line, std::uint32_t rows, std::uint32_t& sealed, std::size_t& bytes)
+	{
+		sealed = 0;
+		bytes = 0;
+
+		auto stmt = prepare(statements::seal_rows);
+		if (!stmt)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+		sqlite3_bind_int(stmt, 2, static_cast<int>(rows));
+
+		std::vector<score_sample> _samples;
+		_samples.reserve(rows);
+
+		//rows sharing the last ts past the block stay raw, the delete goes up to the last (ts, seq)
+		std::int64_t _last_seq = 0;
+
+		auto result = sqlite3_step(stmt);
+		while (result == SQLITE_ROW)
+		{
+			_samples.emplace_back(score_sample{sqlite3_column_int64(stmt, 0), sqlite3_column_double(stmt, 2)});
+			_last_seq = sqlite3_column_int64(stmt, 1);
+
+			result = sqlite3_step(stmt);
+		}
+
+		auto errc = retrieve_error(stmt, result);
+
+		sqlite3_reset(stmt);
+
+		if (errc != rvision::core::errc::success || _samples.empty())
+		{
+			return errc;
+		}
+
+		std::vector<std::uint8_t> _block;
+		score_codec::encode(_samples.data(), _samples.size(), _block);
+
+		errc = execute("BEGIN IMMEDIATE;");
+		if (errc != rvision::core::errc::success)
+		{
+			return errc;
+		}
+
+		stmt = prepare(statements::seal_block);
+		if (!stmt)
+		{
+			execute("ROLLBACK;");
+
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+		sqlite3_bind_int64(stmt, 2, _samples.front().ts);
+		sqlite3_bind_int64(stmt, 3, _samples.back().ts);
+		sqlite3_bind_int64(stmt, 4, static_cast<std::int64_t>(_samples.size()));
+		sqlite3_bind_blob(stmt, 5, _block.data(), static_cast<int>(_block.size()), SQLITE_STATIC);
+
+		errc = retrieve_error(stmt, sqlite3_step(stmt));
+
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+
+		if (errc == rvision::core::errc::success)
+		{
+			stmt = prepare(statements::seal_delete);
+			if (!stmt)
+			{
+				execute("ROLLBACK;");
+
+				return rvision::core::errc::fail;
+			}
+
+			sqlite3_bind_int64(stmt, 1, line);
+			sqlite3_bind_int64(stmt, 2, _samples.back().ts);
+			sqlite3_bind_int64(stmt, 3, _last_seq);
+
+			errc = retrieve_error(stmt, sqlite3_step(stmt));
+
+			sqlite3_reset(stmt);
+		}
+
+		if (errc == rvision::core::errc::success)
+		{
+			errc = execute("COMMIT;");
+		}
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::seal => seal {} rows of line: {} error: {}", _samples.size(), line, errc);
+
+			execute("ROLLBACK;");
+
+			return errc;
+		}
+
+		sealed = static_cast<std::uint32_t>(_samples.size());
+		bytes = _block.size();
+
+		return errc;
+	}
+		
+	rvision::core::errc lines_db::connection::retention_cutoff(line_id_t line, std::uint32_t rows, std::int64_t& cutoff)
+	{
+		auto blocks = prepare(statements::cutoff_blocks);
+		if (!blocks)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(blocks, 1, line);
+
+		auto _blocks_result = sqlite3_step(blocks);
+
+		if (_blocks_result != SQLITE_ROW)
+		{
+			auto errc = retrieve_error(blocks, _blocks_result);
+
+			sqlite3_reset(blocks);
+
+			if (errc != rvision::core::errc::success)
+			{
+				return errc;
+			}
+
+			//no blocks, the rows-th newest raw sample
+			auto stmt = prepare(statements::cutoff_scores);
+			if (!stmt)
+			{
+				return rvision::core::errc::fail;
+			}
+
+			sqlite3_bind_int64(stmt, 1, line);
+			sqlite3_bind_int64(stmt, 2, static_cast<std::int64_t>(rows) - 1);
+
+			auto result = sqlite3_step(stmt);
+
+			if (result == SQLITE_ROW)
+			{
+				cutoff = sqlite3_column_int64(stmt, 0);
+			}
+
+			errc = retrieve_error(stmt, result);
+
+			sqlite3_reset(stmt);
+
+			return errc;
+		}
+
+		//a back-filled sample lands in the raw rows older than sealed blocks, so both are walked newest first together,
+		//a block is kept or deleted as a whole and keeps everything from its first sample on
+		auto stmt = prepare(statements::cutoff_rows);
+		if (!stmt)
+		{
+			sqlite3_reset(blocks);
+
+			return rvision::core::errc::fail;
+		}
+
+		sqlite3_bind_int64(stmt, 1, line);
+
+		auto result = sqlite3_step(stmt);
+
+		std::uint64_t _rows = 0;
+		auto _cutoff = std::numeric_limits<std::int64_t>::max();
+
+		while (_rows < rows && (result == SQLITE_ROW || _blocks_result == SQLITE_ROW))
+		{
+			if (result == SQLITE_ROW && (_blocks_result != SQLITE_ROW || sqlite3_column_int64(stmt, 0) > sqlite3_column_int64(blocks, 1)))
+			{
+				_cutoff = std::min<std::int64_t>(_cutoff, sqlite3_column_int64(stmt, 0));
+				_rows += 1;
+
+				result = sqlite3_step(stmt);
+			}
+			else
+			{
+				_cutoff = std::min<std::int64_t>(_cutoff, sqlite3_column_int64(blocks, 0));
+				_rows += static_cast<std::uint64_t>(sqlite3_column_int64(blocks, 2));
+
+				_blocks_result = sqlite3_step(blocks);
+			}
+		}
+
+		if (_rows >= rows)
+		{
+			cutoff = _cutoff;
+		}
+
+		auto errc = retrieve_error(stmt, result);
+
+		if (errc == rvision::core::errc::success)
+		{
+			errc = retrieve_error(blocks, _blocks_result);
+		}
+
+		sqlite3_reset(stmt);
+		sqlite3_reset(blocks);
+
+		return errc;
+	}
+
+	rvision::core::errc lines_db::connection::retain(line_id_t line, std::int64_t cutoff, std::uint32_t batch, std::uint32_t& rows, std::uint32_t& blocks, std::uint32_t& rollups)
+	{
+		rows = 0;
+		blocks = 0;
+		rollups = 0;
+
+		auto errc = execute("BEGIN IMMEDIATE;");
+		if (errc != rvision::core::errc::success)
+		{
+			return errc;
+		}
+
+		for (auto [kind, changes] : {std::pair{statements::retain_scores, &rows}, std::pair{statements::retain_blocks, &blocks}, std::pair{statements::retain_rollups, &rollups}})
+		{
+			auto stmt = prepare(kind);
+			if (!stmt)
+			{
+				errc = rvision::core::errc::fail;
+				break;
+			}
+
+			sqlite3_bind_int64(stmt, 1, line);
+			sqlite3_bind_int64(stmt, 2, cutoff);
+			sqlite3_bind_int64(stmt, 3, batch);
+
+			errc = retrieve_error(stmt, sqlite3_step(stmt));
+
+			sqlite3_reset(stmt);
+
+			if (errc != rvision::core::errc::success)
+			{
+				break;
+			}
+
+			*changes = static_cast<std::uint32_t>(sqlite3_changes(m_connection.get()));
+		}
+
+		if (errc == rvision::core::errc::success)
+		{
+			errc = execute("COMMIT;");
+		}
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("connection::retain => line: {} cutoff: {} error: {}", line, cutoff, errc);
+
+			execute("ROLLBACK;");
+
+			rows = blocks = rollups = 0;
+		}
+
+		return errc;
+	}
+		
+	lines_db::lines_db(const std::string& path, std::shared_ptr<rvision::core::logger> logger, const lines_db_config& config)
+		: m_logger(logger), m_db_path(path), m_config(config), m_wal(config._journal == "wal"), m_enqueued(0), m_stopped(false), m_queue_depth(0), m_commits(0), m_committed(0), m_dropped(0), m_failed(0),
+		m_sealed_blocks(0), m_sealed_rows(0), m_sealed_bytes(0), m_rollup_generation(0), m_rollups_flushed(0), m_wal_frames(0), m_checkpoints(0),
+		m_retention_batch(std::max<std::uint32_t>(config._retention_batch, 1)), m_maintenance_runs(0), m_retained_rows(0), m_retained_blocks(0), m_retained_rollups(0),
+		m_vacuumed_pages(0), m_freelist_pages(0), m_budget_overruns(0)
+	{
+		m_db_path += m_config._file;
+
+		//finest level first, aggregate() walks them from the coarsest down
+		std::erase_if(m_config._rollups, [](std::int64_t level) { return level <= 0; });
+		std::sort(m_config._rollups.begin(), m_config._rollups.end());
+		m_config._rollups.erase(std::unique(m_config._rollups.begin(), m_config._rollups.end()), m_config._rollups.end());
+
+		std::uint32_t pool_size = m_config._readers ? m_config._readers : 2 * std::thread::hardware_concurrency();
+
+		m_logger->info("lines_db::lines_db => path : {} db_path : {}, journal : {}, readers pool size : {}",path, m_db_path, m_config._journal, pool_size);
+		m_logger->info("lines_db::lines_db => commit rows : {}, commit interval : {} ms, block rows : {}", m_config._commit_rows, m_config._commit_interval.count(), m_config._block_rows);
+		
+		init();
+
+		m_writer = std::make_unique<connection>(m_db_path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, m_logger);
+
+		if (m_wal)
+		{
+			m_writer->execute("PRAGMA synchronous = NORMAL;");
+			m_writer->execute("PRAGMA wal_autocheckpoint = " + std::to_string(m_config._wal_autocheckpoint) + ";");
+		}
+				
+		m_pool = std::make_unique<connection_pool>(pool_size, [this]()
+		{
+			std::int32_t _flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+
+			auto _connection = std::make_unique<connection>(m_db_path, _flags, m_logger);
+				
+			return _connection;
+		}, m_logger);
+
+		m_queue.reserve(m_config._commit_rows);
+
+		//reads beyond the pool size would only wait for a connection
+		m_executor = std::make_unique<rvision::core::executor>(m_config._async_threads ? m_config._async_threads : pool_size);
+
+		m_write_thread = std::jthread([this](std::stop_token stoken)
+		{
+			write(stoken);
+		});
+
+		if (m_wal)
+		{
+			m_logger->info("lines_db::lines_db => wal autocheckpoint : {} pages, checkpoint mode : {}, checkpoint interval : {} ms",
+				m_config._wal_autocheckpoint, m_config._checkpoint_mode, m_config._checkpoint_interval.count());
+
+			m_checkpointer = std::make_unique<connection>(m_db_path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, m_logger);
+			m_checkpointer->execute("PRAGMA journal_mode = WAL;");
+
+			m_checkpoint_thread = std::jthread([this](std::stop_token stoken)
+			{
+				checkpoint(stoken);
+			});
+		}
+
+		if (m_config._maintenance_interval.count() > 0)
+		{
+			m_logger->info("lines_db::lines_db => maintenance interval : {} ms, budget : {} ms, retention age : {} ms, retention rows : {}, line policies : {}",
+				m_config._maintenance_interval.count(), m_config._maintenance_budget.count(), m_config._retention._age.count(), m_config._retention._rows, m_config._line_retention.size());
+
+			m_maintenance_thread = std::jthread([this](std::stop_token stoken)
+			{
+				maintain(stoken);
+			});
+		}
+	}
+
+	lines_db::~lines_db()
+	{
+		m_maintenance_thread.request_stop();
+		if (m_maintenance_thread.joinable())
+		{
+			m_maintenance_thread.join();
+		}
+
+
+		m_checkpoint_thread.request_stop();
+		if (m_checkpoint_thread.joinable())
+		{
+			m_checkpoint_thread.join();
+		}
+
+		//queued async calls still run against the pool and the writer
+		m_executor.reset();
+
+		m_write_thread.request_stop();
+		m_write_thread.join();
+
+		m_logger->debug("lines_db::~lines_db().");
+	}	
+
+	void lines_db::write(std::stop_token stoken)
+	{
+		std::vector<score_update> _scores;
+		_scores.reserve(m_config._commit_rows);
+
+		std::uint64_t _seq = 0;
+
+		while (!stoken.stop_requested())
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_queue_lock);
+
+				if (!m_queue_wait.wait(lock, stoken, [this] { return !m_queue.empty(); }))
+				{
+					break;
+				}
+
+				auto _deadline = std::chrono::steady_clock::now() + m_config._commit_interval;
+
+				m_queue_wait.wait_until(lock, stoken, _deadline, [this] { return m_queue.size() >= m_config._commit_rows; });
+
+				_scores.swap(m_queue);
+				_seq = m_enqueued;
+
+				m_queue_depth.store(0, std::memory_order_relaxed);
+			}
+
+			committed(_seq, commit(_scores));
+
+			_scores.clear();
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(m_queue_lock);
+
+			_scores.swap(m_queue);
+			_seq = m_enqueued;
+
+			//a later score would wait for a commit that never comes
+			m_stopped = true;
+
+			m_queue_depth.store(0, std::memory_order_relaxed);
+		}
+
+		m_logger->info("lines_db::write => flush {} scores and open rollups on stop", _scores.size());
+
+		committed(_seq, commit(_scores, true));
+	}
+
+	void lines_db::committed(std::uint64_t seq, rvision::core::errc errc)
+	{
+		std::vector<commit_waiter> _waiters;
+
+		{
+			std::unique_lock<std::mutex> lock(m_queue_lock);
+
+			while (!m_commit_waiters.empty() && m_commit_waiters.front().seq <= seq)
+			{
+				_waiters.emplace_back(std::move(m_commit_waiters.front()));
+				m_commit_waiters.pop_front();
+			}
+		}
+
+		for (auto& w : _waiters)
+		{
+			w.promise.set_value(errc);
+		}
+	}
+
+	rvision::core::errc lines_db::commit(std::vector<score_update>& scores, bool close)
+	{
+		std::vector<rollup_update> _rollups;
+		rollup_snapshot _snapshot;
+
+		std::unique_lock<std::mutex> lock(m_writer_lock);
+
+		if (!m_removed_lines.empty())
+		{
+			std::erase_if(scores, [this](const score_update& s) { return m_removed_lines.contains(s.line); });
+
+			m_removed_lines.clear();
+		}
+
+		roll(scores, _rollups, close, _snapshot);
+
+		if (scores.empty() && _rollups.empty())
+		{
+			return rvision::core::errc::success;
+		}
+
+		auto _start = std::chrono::steady_clock::now();
+
+		auto errc = m_writer->update_lines(scores, _rollups);
+
+		if (errc == rvision::core::errc::success && !_rollups.empty())
+		{
+			std::unique_lock<std::mutex> rollup_lock(m_rollup_lock);
+
+			//only this thread adds pending rollups, everything pending went into this commit
+			m_flushing_rollups.clear();
+
+			++m_rollup_generation;
+
+			m_rollups_flushed.fetch_add(_rollups.size(), std::memory_order_relaxed);
+		}
+
+		if (errc != rvision::core::errc::success && !m_config._rollups.empty())
+		{
+			restore(_snapshot);
+		}
+
+		m_commit_latency.record(std::chrono::steady_clock::now() - _start);
+		m_commit_rows.record(scores.size());
+
+		if (errc == rvision::core::errc::success && m_config._block_rows != 0)
+		{
+			seal(scores);
+		}
+
+		lock.unlock();
+
+		if (errc != rvision::core::errc::success)
+		{
+			//the waiters of the batch get errc, the rollups are back to their state before the batch
+			m_failed.fetch_add(scores.size(), std::memory_order_relaxed);
+
+			m_logger->error("lines_db::commit => {} scores are lost, error: {}", scores.size(), errc);
+
+			return errc;
+		}
+
+		m_commits.fetch_add(1, std::memory_order_relaxed);
+		m_committed.fetch_add(scores.size(), std::memory_order_relaxed);
+
+		return errc;
+	}
+
+	void lines_db::seal(const std::vector<score_update>& scores)
+	{
+		//a line keeps at least _block_rows raw rows, the older _block_rows are packed into one block
+		std::vector<line_id_t> _lines;
+
+		for (const auto& s : scores)
+		{
+			if (++m_raw_rows[s.line] >= 2 * m_config._block_rows && std::find(_lines.begin(), _lines.end(), s.line) == _lines.end())
+			{
+				_lines.emplace_back(s.line);
+			}
+		}
+
+		for (auto l : _lines)
+		{
+			auto& _rows = m_raw_rows[l];
+
+			while (_rows >= 2 * m_config._block_rows)
+			{
+				std::uint32_t _sealed = 0;
+				std::size_t _bytes = 0;
+
+				auto _start = std::chrono::steady_clock::now();
+
+				if (m_writer->seal(l, m_config._block_rows, _sealed, _bytes) != rvision::core::errc::success || _sealed == 0)
+				{
+					break;
+				}
+
+				m_seal_latency.record(std::chrono::steady_clock::now() - _start);
+
+				_rows = _rows > _sealed ? _rows - _sealed : 0;
+
+				m_sealed_blocks.fetch_add(1, std::memory_order_relaxed);
+				m_sealed_rows.fetch_add(_sealed, std::memory_order_relaxed);
+				m_sealed_bytes.fetch_add(_bytes, std::memory_order_relaxed);
+
+				m_logger->debug("lines_db::seal => line: {} rows: {} block bytes: {}", l, _sealed, _bytes);
+			}
+		}
+	}
+
+	void lines_db::roll(const std::vector<score_update>& scores, std::vector<rollup_update>& flush, bool close, rollup_snapshot& snapshot)
+	{
+		const auto& _levels = m_config._rollups;
+
+		if (_levels.empty())
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(m_rollup_lock);
+
+		snapshot.flushing = m_flushing_rollups;
+
+		if (close)
+		{
+			snapshot.open = m_open_rollups;
+		}
+
+		for (const auto& s : scores)
+		{
+			if (!snapshot.open.contains(s.line))
+			{
+				auto _open = m_open_rollups.find(s.line);
+
+				snapshot.open.emplace(s.line, _open != m_open_rollups.end() ? _open->second : std::vector<score_rollup>{});
+			}
+		}
+
+		for (const auto& s : scores)
+		{
+			auto& _open = m_open_rollups[s.line];
+			_open.resize(_levels.size());
+
+			for (std::size_t l = 0; l < _levels.size(); ++l)
+			{
+				auto _bucket = rollup_bucket(s.sample.ts, _levels[l]);
+				auto& _rollup = _open[l];
+
+				if (_rollup.count != 0 && _bucket < _rollup.bucket)
+				{
+					//late sample, merged into its stored bucket
+					auto& _late = m_flushing_rollups[rollup_key{s.line, _levels[l], _bucket}];
+					_late.bucket = _bucket;
+					_late.put(s.sample);
+
+					continue;
+				}
+
+				if (_rollup.count != 0 && _bucket > _rollup.bucket)
+				{
+					m_flushing_rollups[rollup_key{s.line, _levels[l], _rollup.bucket}].merge(_rollup);
+
+					_rollup = {};
+				}
+
+				if (_rollup.count == 0)
+				{
+					_rollup.bucket = _bucket;
+				}
+
+				_rollup.put(s.sample);
+			}
+		}
+
+		if (close)
+		{
+			for (const auto& o : m_open_rollups)
+			{
+				for (std::size_t l = 0; l < o.second.size(); ++l)
+				{
+					if (o.second[l].count != 0)
+					{
+						m_flushing_rollups[rollup_key{o.first, _levels[l], o.second[l].bucket}].merge(o.second[l]);
+					}
+				}
+			}
+
+			m_open_rollups.clear();
+		}
+
+		flush.reserve(m_flushing_rollups.size());
+
+		for (const auto& [key, rollup] : m_flushing_rollups)
+		{
+			flush.emplace_back(rollup_update{std::get<0>(key), std::get<1>(key), rollup});
+		}
+	}
+
+	void lines_db::restore(rollup_snapshot& snapshot)
+	{
+		std::unique_lock<std::mutex> lock(m_rollup_lock);
+
+		for (auto& [line, open] : snapshot.open)
+		{
+			if (open.empty())
+			{
+				m_open_rollups.erase(line);
+			}
+			else
+			{
+				m_open_rollups[line] = std::move(open);
+			}
+		}
+
+		m_flushing_rollups = std::move(snapshot.flushing);
+
+		//readers that saw the rolled state retry
+		++m_rollup_generation;
+	}
+
+	std::uint64_t lines_db::pending_rollups(line_id_t line, std::int64_t level, std::int64_t from, std::int64_t to, std::vector<score_rollup>& rollups) const
+	{
+		std::unique_lock<std::mutex> lock(m_rollup_lock);
+
+		if (auto p = m_open_rollups.find(line); p != m_open_rollups.end())
+		{
+			auto _level = std::distance(m_config._rollups.begin(), std::find(m_config._rollups.begin(), m_config._rollups.end(), level));
+
+			if (_level < static_cast<std::ptrdiff_t>(p->second.size()))
+			{
+				const auto& _rollup = p->second[_level];
+
+				if (_rollup.count != 0 && _rollup.bucket >= from && _rollup.bucket <= to)
+				{
+					rollups.emplace_back(_rollup);
+				}
+			}
+		}
+
+		auto _end = m_flushing_rollups.upper_bound(rollup_key{line, level, to});
+
+		for (auto p = m_flushing_rollups.lower_bound(rollup_key{line, level, from}); p != _end; ++p)
+		{
+			rollups.emplace_back(p->second);
+		}
+
+		return m_rollup_generation;
+	}
+
+	rvision::core::errc lines_db::read_rollups(connection& conn, line_id_t line, std::int64_t level, std::int64_t from, std::int64_t to, std::vector<score_rollup>& rollups) const
+	{
+		std::vector<score_rollup> _pending;
+		std::vector<score_rollup> _stored;
+
+		//a flush committed between the two reads would count its buckets twice or not at all, read again then
+		bool _consistent = false;
+
+		for (std::uint32_t attempt = 0; attempt < 3 && !_consistent; ++attempt)
+		{
+			_pending.clear();
+			_stored.clear();
+
+			auto _generation = pending_rollups(line, level, from, to, _pending);
+
+			auto errc = conn.fetch_rollups(line, level, from, to, _stored);
+			if (errc != rvision::core::errc::success)
+			{
+				return errc;
+			}
+
+			std::unique_lock<std::mutex> lock(m_rollup_lock);
+
+			_consistent = _generation == m_rollup_generation;
+		}
+
+		if (!_consistent)
+		{
+			m_logger->error("lines_db::read_rollups => line: {} level: {} kept changing under the read", line, level);
+
+			return rvision::core::errc::fail;
+		}
+
+		auto _cmp = [](const score_rollup& r, std::int64_t bucket) { return r.bucket < bucket; };
+
+		for (const auto& p : _pending)
+		{
+			auto _position = std::lower_bound(_stored.begin(), _stored.end(), p.bucket, _cmp);
+
+			if (_position != _stored.end() && _position->bucket == p.bucket)
+			{
+				_position->merge(p);
+			}
+			else
+			{
+				_stored.insert(_position, p);
+			}
+		}
+
+		rollups.insert(rollups.end(), _stored.begin(), _stored.end());
+
+		return rvision::core::errc::success;
+	}
+
+	rvision::core::errc lines_db::aggregate(connection& conn, line_id_t line, std::int64_t from, std::int64_t to, std::size_t level, score_rollup& result) const
+	{
+		if (from > to)
+		{
+			return rvision::core::errc::success;
+		}
+
+		if (level == 0)
+		{
+			std::vector<score_sample> _samples;
+
+			auto errc = conn.fetch_score(line, from, to, _samples);
+
+			for (const auto& s : _samples)
+			{
+				result.put(s);
+			}
+
+			return errc;
+		}
+
+		//whole buckets of this level inside [from, to], the edges go one level down
+		auto _width = m_config._rollups[level - 1];
+
+		auto _first = rollup_bucket(from, _width);
+		if (_first < from)
+		{
+			_first += _width;
+		}
+
+		auto _last = rollup_bucket(to - _width + 1, _width);
+
+		if (_first > _last)
+		{
+			return aggregate(conn, line, from, to, level - 1, result);
+		}
+
+		std::vector<score_rollup> _rollups;
+
+		auto errc = read_rollups(conn, line, _width, _first, _last, _rollups);
+		if (errc != rvision::core::errc::success)
+		{
+			return errc;
+		}
+
+		for (const auto& r : _rollups)
+		{
+			result.merge(r);
+		}
+
+		errc = aggregate(conn, line, from, _first - 1, level - 1, result);
+		if (errc != rvision::core::errc::success || _last > to - _width)
+		{
+			return errc;
+		}
+
+		return aggregate(conn, line, _last + _width, to, level - 1, result);
+	}
+
+	void lines_db::checkpoint(std::stop_token stoken)
+	{
+		auto _mode = detail::get_checkpoint_mode(m_config._checkpoint_mode);
+
+		while (!stoken.stop_requested())
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_checkpoint_lock);
+
+				if (m_checkpoint_wait.wait_for(lock, stoken, m_config._checkpoint_interval, [] { return false; }) || stoken.stop_requested())
+				{
+					break;
+				}
+			}
+
+			int _wal_frames = 0;
+			int _checkpointed = 0;
+
+			auto _start = std::chrono::steady_clock::now();
+
+			auto errc = m_checkpointer->checkpoint(_mode, _wal_frames, _checkpointed);
+
+			m_checkpoint_latency.record(std::chrono::steady_clock::now() - _start);
+
+			if (errc == rvision::core::errc::success)
+			{
+				m_checkpoints.fetch_add(1, std::memory_order_relaxed);
+				m_wal_frames.store(_wal_frames, std::memory_order_relaxed);
+
+				m_logger->debug("lines_db::checkpoint => wal frames: {}, checkpointed: {}", _wal_frames, _checkpointed);
+			}
+		}
+	}
+
+	void lines_db::maintain(std::stop_token stoken)
+	{
+		while (!stoken.stop_requested())
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_maintenance_lock);
+
+				if (m_maintenance_wait.wait_for(lock, stoken, m_config._maintenance_interval, [] { return false; }) || stoken.stop_requested())
+				{
+					break;
+				}
+			}
+
+			std::vector<std::pair<line_id_t, retention_policy>> _lines;
+
+			{
+				std::shared_lock<std::shared_mutex> lock(m_lines_lock);
+
+				for (const auto& [name, id] : m_lines)
+				{
+					auto p = m_config._line_retention.find(name);
+					const auto& _policy = p != m_config._line_retention.end() ? p->second : m_config._retention;
+
+					if (_policy._age.count() > 0 || _policy._rows != 0)
+					{
+						_lines.emplace_back(id, _policy);
+					}
+				}
+			}
+
+			for (const auto& [line, policy] : _lines)
+			{
+				if (stoken.stop_requested())
+				{
+					break;
+				}
+
+				retain(line, policy, stoken);
+			}
+
+			vacuum(stoken);
+
+			m_maintenance_runs.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void lines_db::retain(line_id_t line, const retention_policy& policy, std::stop_token stoken)
+	{
+		auto _cutoff = std::numeric_limits<std::int64_t>::min();
+
+		if (policy._age.count() > 0)
+		{
+			_cutoff = score_now() - policy._age.count();
+		}
+
+		if (policy._rows != 0)
+		{
+			auto _rows_cutoff = std::numeric_limits<std::int64_t>::min();
+
+			//a read only scan, it runs on a reader and leaves the writer to ingest
+			try
+			{
+				connection_pool::accessor accessor(m_logger, *m_pool, m_config._readers_timeout);
+
+				if (accessor->retention_cutoff(line, policy._rows, _rows_cutoff) != rvision::core::errc::success)
+				{
+					return;
+				}
+			}
+			catch (const connection_pool::no_resource& )
+			{
+				m_logger->error("lines_db::retain: connection_pool::no_resource for line: {}", line);
+
+				return;
+			}
+
+			_cutoff = std::max(_cutoff, _rows_cutoff);
+		}
+
+		if (_cutoff == std::numeric_limits<std::int64_t>::min())
+		{
+			return;
+		}
+
+		//the writer is shared with ingest, it is held for at most one budget and given back between slices
+		bool _more = true;
+
+		while (_more && !stoken.stop_requested())
+		{
+			std::unique_lock<std::mutex> lock(m_writer_lock);
+
+			auto _start = std::chrono::steady_clock::now();
+			auto _deadline = _start + m_config._maintenance_budget;
+
+			do
+			{
+				std::uint32_t _rows = 0;
+				std::uint32_t _blocks = 0;
+				std::uint32_t _rollups = 0;
+
+				auto _batch_start = std::chrono::steady_clock::now();
+
+				auto _size = m_retention_batch.load(std::memory_order_relaxed);
+
+				if (m_writer->retain(line, _cutoff, _size, _rows, _blocks, _rollups) != rvision::core::errc::success)
+				{
+					_more = false;
+					break;
+				}
+
+				auto _batch = std::chrono::steady_clock::now() - _batch_start;
+
+				//one batch over the budget is halved, a cheap one grows back to the configured size
+				if (_batch > m_config._maintenance_budget)
+				{
+					m_retention_batch.store(std::max<std::uint32_t>(_size / 2, 1), std::memory_order_relaxed);
+				}
+				else if (_batch < m_config._maintenance_budget / 4 && _size < m_config._retention_batch)
+				{
+					m_retention_batch.store(std::min<std::uint32_t>(_size * 2, m_config._retention_batch), std::memory_order_relaxed);
+				}
+
+				if (auto p = m_raw_rows.find(line); p != m_raw_rows.end())
+				{
+					p->second = p->second > _rows ? p->second - _rows : 0;
+				}
+
+				m_retained_rows.fetch_add(_rows, std::memory_order_relaxed);
+				m_retained_blocks.fetch_add(_blocks, std::memory_order_relaxed);
+				m_retained_rollups.fetch_add(_rollups, std::memory_order_relaxed);
+
+				_more = _rows != 0 || _blocks != 0 || _rollups != 0;
+			}
+			while (_more && std::chrono::steady_clock::now() < _deadline);
+
+			auto _held = std::chrono::steady_clock::now() - _start;
+
+			m_maintenance_slice.record(_held);
+
+			if (_held > m_config._maintenance_budget)
+			{
+				m_budget_overruns.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			lock.unlock();
+
+			std::this_thread::yield();
+		}
+	}
+
+	void lines_db::vacuum(std::stop_token stoken)
+	{
+		if (m_config._vacuum_pages == 0)
+		{
+			return;
+		}
+
+		const std::string _sql("PRAGMA incremental_vacuum(" + std::to_string(m_config._vacuum_pages) + ");");
+
+		std::int64_t _free = 1;
+
+		while (_free > 0 && !stoken.stop_requested())
+		{
+			std::unique_lock<std::mutex> lock(m_writer_lock);
+
+			auto _start = std::chrono::steady_clock::now();
+			auto _deadline = _start + m_config._maintenance_budget;
+
+			do
+			{
+				if (m_writer->pragma("freelist_count", _free) != rvision::core::errc::success || _free <= 0)
+				{
+					_free = 0;
+					break;
+				}
+
+				if (m_writer->execute(_sql) != rvision::core::errc::success)
+				{
+					_free = 0;
+					break;
+				}
+
+				auto _pages = std::min<std::int64_t>(_free, m_config._vacuum_pages);
+
+				_free -= _pages;
+
+				m_vacuumed_pages.fetch_add(static_cast<std::uint64_t>(_pages), std::memory_order_relaxed);
+			}
+			while (_free > 0 && std::chrono::steady_clock::now() < _deadline);
+
+			auto _held = std::chrono::steady_clock::now() - _start;
+
+			m_maintenance_slice.record(_held);
+
+			if (_held > m_config._maintenance_budget)
+			{
+				m_budget_overruns.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			lock.unlock();
+
+			std::this_thread::yield();
+		}
+
+		m_freelist_pages.store(_free, std::memory_order_relaxed);
+	}
+
+	void lines_db::metrics(boost::property_tree::ptree& tree) const
+	{
+		tree.put("db.queue_depth", m_queue_depth.load(std::memory_order_relaxed));
+		tree.put("db.queue_limit", m_config._queue_limit);
+		tree.put("db.commits", m_commits.load(std::memory_order_relaxed));
+		tree.put("db.committed", m_committed.load(std::memory_order_relaxed));
+		tree.put("db.dropped", m_dropped.load(std::memory_order_relaxed));
+		tree.put("db.failed", m_failed.load(std::memory_order_relaxed));
+
+		rvision::core::put_histogram(tree, "db.commit_latency_us", m_commit_latency);
+		rvision::core::put_histogram(tree, "db.commit_rows", m_commit_rows);
+
+		m_pool->metrics(tree, "db.readers");
+		m_executor->metrics(tree, "db.async");
+
+		if (!m_config._rollups.empty())
+		{
+			std::string _levels;
+
+			for (auto l : m_config._rollups)
+			{
+				_levels += _levels.empty() ? std::to_string(l) : "," + std::to_string(l);
+			}
+
+			std::unique_lock<std::mutex> lock(m_rollup_lock);
+
+			tree.put("db.rollups.levels", _levels);
+			tree.put("db.rollups.open_lines", m_open_rollups.size());
+			tree.put("db.rollups.pending", m_flushing_rollups.size());
+			tree.put("db.rollups.flushed", m_rollups_flushed.load(std::memory_order_relaxed));
+
+			rvision::core::put_histogram(tree, "db.rollups.query_latency_us", m_rollup_latency);
+		}
+
+		if (m_config._block_rows != 0)
+		{
+			tree.put("db.blocks.block_rows", m_config._block_rows);
+			tree.put("db.blocks.sealed", m_sealed_blocks.load(std::memory_order_relaxed));
+			tree.put("db.blocks.rows", m_sealed_rows.load(std::memory_order_relaxed));
+			tree.put("db.blocks.bytes", m_sealed_bytes.load(std::memory_order_relaxed));
+
+			rvision::core::put_histogram(tree, "db.blocks.seal_latency_us", m_seal_latency);
+		}
+
+		if (m_config._maintenance_interval.count() > 0)
+		{
+			tree.put("db.maintenance.runs", m_maintenance_runs.load(std::memory_order_relaxed));
+			tree.put("db.maintenance.retention_batch", m_retention_batch.load(std::memory_order_relaxed));
+			tree.put("db.maintenance.deleted_rows", m_retained_rows.load(std::memory_order_relaxed));
+			tree.put("db.maintenance.deleted_blocks", m_retained_blocks.load(std::memory_order_relaxed));
+			tree.put("db.maintenance.deleted_rollups", m_retained_rollups.load(std::memory_order_relaxed));
+			tree.put("db.maintenance.vacuumed_pages", m_vacuumed_pages.load(std::memory_order_relaxed));
+			tree.put("db.maintenance.freelist_pages", m_freelist_pages.load(std::memory_order_relaxed));
+			tree.put("db.maintenance.budget_overruns", m_budget_overruns.load(std::memory_order_relaxed));
+
+			rvision::core::put_histogram(tree, "db.maintenance.slice_us", m_maintenance_slice);
+		}
+
+		if (m_wal)
+		{
+			tree.put("db.wal_frames", m_wal_frames.load(std::memory_order_relaxed));
+			tree.put("db.checkpoints", m_checkpoints.load(std::memory_order_relaxed));
+
+			rvision::core::put_histogram(tree, "db.checkpoint_latency_us", m_checkpoint_latency);
+		}
+	}
+
+	void lines_db::init()
+	{		
+		std::int32_t flags = std::filesystem::exists(m_db_path) ? SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX
+			: SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX;
+
+		auto init_connection = std::make_unique<connection>(m_db_path, flags, m_logger);
+
+		init_connection->execute("PRAGMA auto_vacuum = 2;");
+
+		//incremental auto vacuum takes effect on a new file at once, an older file needs one full VACUUM to switch
+		std::int64_t _auto_vacuum = 0;
+		init_connection->pragma("auto_vacuum", _auto_vacuum);
+
+		if (m_config._vacuum_on_start || _auto_vacuum != 2)
+		{
+			m_logger->info("lines_db::init => full vacuum, auto vacuum : {}", _auto_vacuum);
+
+			init_connection->execute("VACUUM;");
+		}
+
+		init_connection->execute(m_wal ? "PRAGMA journal_mode = WAL;" : "PRAGMA journal_mode = DELETE;");
+
+		if (init_connection->migrate() != rvision::core::errc::success)
+		{
+			throw rvision::core::exception("lines_db::init => schema migration failed !!!", rvision::core::errc::fail);
+		}
+
+		std::unique_lock<std::shared_mutex> lock(m_lines_lock);
+
+		init_connection->lines(m_lines);
+
+		init_connection->raw_rows(m_raw_rows);
+
+		m_logger->info("lines_db::init => known lines : {}", m_lines.size());
+	}
+
+	void lines_db::lines(std::vector<std::string>& lines) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_lines_lock);
+
+		lines.reserve(lines.size() + m_lines.size());
+
+		for (const auto& l : m_lines)
+		{
+			lines.emplace_back(l.first);
+		}
+	}
+
+	bool lines_db::line_id(const std::string& line, line_id_t& id) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_lines_lock);
+
+		if (auto p = m_lines.find(line); p != m_lines.end())
+		{
+			id = p->second;
+
+			return true;
+		}
+
+		m_logger->error("lines_db::line_id => unknown line: {}", line);
+
+		return false;
+	}
+	
+	rvision::core::errc lines_db::add_line(const std::string& line)
+	{
+		m_logger->debug("lines_db::add_line => try to add line: {}", line);
+
+		{
+			std::shared_lock<std::shared_mutex> lines_lock(m_lines_lock);
+
+			if (m_lines.contains(line))
+			{
+				return rvision::core::errc::success;
+			}
+		}
+
+		line_id_t _id = 0;
+
+		std::unique_lock<std::mutex> lock(m_writer_lock);
+
+		auto errc = m_writer->add_line(line, _id);
+		if (errc == rvision::core::errc::success)
+		{
+			std::unique_lock<std::shared_mutex> lines_lock(m_lines_lock);
+
+			m_lines[line] = _id;
+		}
+
+		return errc;
+	}
+		
+	rvision::core::errc lines_db::rem_line(const std::string& line)
+	{
+		m_logger->debug("lines_db::rem_line => try to rem line: {}", line);
+
+		line_id_t _id = 0;
+		if (!line_id(line, _id))
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		{
+			std::unique_lock<std::shared_mutex> lines_lock(m_lines_lock);
+
+			m_lines.erase(line);
+		}
+
+		{
+			std::unique_lock<std::mutex> queue_lock(m_queue_lock);
+
+			std::erase_if(m_queue, [_id](const score_update& s) { return s.line == _id; });
+
+			m_queue_depth.store(m_queue.size(), std::memory_order_relaxed);
+		}
+
+		std::unique_lock<std::mutex> lock(m_writer_lock);
+
+		{
+			//under the writer lock, a failed commit can not put the line's rollups back
+			std::unique_lock<std::mutex> rollup_lock(m_rollup_lock);
+
+			m_open_rollups.erase(_id);
+
+			std::erase_if(m_flushing_rollups, [_id](const auto& f) { return std::get<0>(f.first) == _id; });
+		}
+
+		m_raw_rows.erase(_id);
+		m_removed_lines.insert(_id);
+
+		return m_writer->rem_line(_id);
+	}
+	
+	rvision::core::errc lines_db::update_line(const std::string& line, std::double_t score)
+	{
+		return update_line(line, score_sample{score_now(), score});
+	}
+
+	rvision::core::errc lines_db::update_line(const std::string& line, const score_sample& sample)
+	{
+		return enqueue(line, sample, nullptr);
+	}
+
+	rvision::core::errc lines_db::enqueue(const std::string& line, const score_sample& sample, std::promise<rvision::core::errc>* committed)
+	{
+		m_logger->debug("lines_db::enqueue => try to updt line: {}", line);
+
+		line_id_t _id = 0;
+		if (!line_id(line, _id))
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		std::size_t _depth = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_queue_lock);
+
+			if (m_stopped)
+			{
+				m_logger->error("lines_db::enqueue: writer is stopped, drop score for line: {}", line);
+
+				return rvision::core::errc::fail;
+			}
+
+			if (m_queue.size() >= m_config._queue_limit)
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+
+				m_logger->error("lines_db::enqueue: queue limit {} is reached, drop score for line: {}", m_config._queue_limit, line);
+
+				return rvision::core::errc::insufficient_resources;
+			}
+
+			m_queue.emplace_back(score_update{_id, sample});
+
+			++m_enqueued;
+
+			if (committed)
+			{
+				m_commit_waiters.emplace_back(commit_waiter{m_enqueued, std::move(*committed)});
+			}
+
+			_depth = m_queue.size();
+
+			m_queue_depth.store(_depth, std::memory_order_relaxed);
+		}
+
+		if (_depth == 1 || _depth >= m_config._commit_rows)
+		{
+			m_queue_wait.notify_one();
+		}
+
+		return rvision::core::errc::success;
+	}
+	
+	std::future<rvision::core::errc> lines_db::add_line_async(const std::string& line)
+	{
+		return m_executor->submit([this, line]()
+		{
+			return add_line(line);
+		});
+	}
+
+	std::future<rvision::core::errc> lines_db::update_line_async(const std::string& line, const score_sample& sample)
+	{
+		//completes once the group commit holding the score is done, not when it is queued
+		std::promise<rvision::core::errc> _promise;
+		auto _future = _promise.get_future();
+
+		auto errc = enqueue(line, sample, &_promise);
+
+		if (errc != rvision::core::errc::success)
+		{
+			_promise.set_value(errc);
+		}
+
+		return _future;
+	}
+
+	std::future<async_result<score_sample>> lines_db::last_score_async(const std::string& line)
+	{
+		return m_executor->submit([this, line]()
+		{
+			async_result<score_sample> _result;
+			_result.errc = last_score(line, _result.value);
+
+			return _result;
+		});
+	}
+
+	std::future<async_result<score_samples_t>> lines_db::last_scores_async(const std::vector<std::string>& lines)
+	{
+		return m_executor->submit([this, lines]()
+		{
+			async_result<score_samples_t> _result;
+			_result.errc = last_scores(lines, _result.value);
+
+			return _result;
+		});
+	}
+
+	std::future<async_result<std::vector<std::double_t>>> lines_db::fetch_score_async(const std::string& line)
+	{
+		return m_executor->submit([this, line]()
+		{
+			async_result<std::vector<std::double_t>> _result;
+			_result.errc = fetch_score(line, _result.value);
+
+			return _result;
+		});
+	}
+
+	std::future<async_result<std::vector<score_sample>>> lines_db::fetch_score_async(const std::string& line, std::int64_t from, std::int64_t to)
+	{
+		return m_executor->submit([this, line, from, to]()
+		{
+			async_result<std::vector<score_sample>> _result;
+			_result.errc = fetch_score(line, from, to, _result.value);
+
+			return _result;
+		});
+	}
+
+	rvision::core::errc lines_db::last_score(const std::string& line, std::double_t& score)
+	{
+		score_sample _sample;
+
+		auto errc = last_score(line, _sample);
+		if (errc == rvision::core::errc::success)
+		{
+			score = _sample.score;
+		}
+
+		return errc;
+	}
+
+	rvision::core::errc lines_db::last_score(const std::string& line, score_sample& sample)
+	{
+		line_id_t _id = 0;
+		if (!line_id(line, _id))
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		try
+		{
+			m_logger->debug("lines_db::last_score => try to get last score for line: {}", line);
+			
+			connection_pool::accessor accessor(m_logger, *m_pool, m_config._readers_timeout);
+
+			return accessor->last_score(_id, sample);
+		}
+		catch (const connection_pool::no_resource& )
+		{
+			m_logger->error("lines_db::last_score: connection_pool::no_resource for line: {}", line);
+			
+			return rvision::core::errc::insufficient_resources;
+		}
+
+		return rvision::core::errc::fail;
+	}
+	
+	rvision::core::errc lines_db::last_scores(const std::vector<std::string>& lines, score_samples_t& samples)
+	{
+		std::vector<std::pair<const std::string*, line_id_t>> _ids;
+		_ids.reserve(lines.size());
+
+		std::string _json("[");
+
+		{
+			std::shared_lock<std::shared_mutex> lock(m_lines_lock);
+
+			for (const auto& l : lines)
+			{
+				if (auto p = m_lines.find(l); p != m_lines.end())
+				{
+					_json += _ids.empty() ? "" : ",";
+					_json += std::to_string(p->second);
+
+					_ids.emplace_back(&l, p->second);
+				}
+			}
+		}
+
+		_json += "]";
+
+		if (_ids.empty())
+		{
+			return rvision::core::errc::success;
+		}
+
+		try
+		{
+			connection_pool::accessor accessor(m_logger, *m_pool, m_config._readers_timeout);
+
+			std::unordered_map<line_id_t, score_sample> _samples;
+			_samples.reserve(_ids.size());
+
+			auto errc = accessor->last_scores(_json, _samples);
+			if (errc != rvision::core::errc::success)
+			{
+				return errc;
+			}
+
+			samples.reserve(samples.size() + _ids.size());
+
+			for (const auto& [line, id] : _ids)
+			{
+				if (auto p = _samples.find(id); p != _samples.end())
+				{
+					samples.emplace(*line, p->second);
+
+					continue;
+				}
+
+				//no raw rows left, the history ends in a sealed block
+				score_sample _sample;
+
+				if (accessor->last_block(id, _sample) == rvision::core::errc::success)
+				{
+					samples.emplace(*line, _sample);
+				}
+			}
+
+			return rvision::core::errc::success;
+		}
+		catch (const connection_pool::no_resource& )
+		{
+			m_logger->error("lines_db::last_scores: connection_pool::no_resource for {} lines", _ids.size());
+
+			return rvision::core::errc::insufficient_resources;
+		}
+
+		return rvision::core::errc::fail;
+	}
+
+	rvision::core::errc lines_db::fetch_score(const std::string& line, std::vector<std::double_t>& score)
+	{
+		line_id_t _id = 0;
+		if (!line_id(line, _id))
+		{
+			return rvision::core::errc::not_found;
+		}
+
 		try
 		{
 			m_logger->debug("lines_db::fetch_score => try to get score for line: {}", line);
 			
-			connection_pool::accessor accessor(m_logger, *m_pool, 100, std::chrono::seconds(1));
+			connection_pool::accessor accessor(m_logger, *m_pool, m_config._readers_timeout);
+
+			return accessor->fetch_score(_id, score);
+		}
+		catch (const connection_pool::no_resource& )
+		{
+			m_logger->error("lines_db::fetch_score: connection_pool::no_resource for line: {}", line);
+			
+			return rvision::core::errc::insufficient_resources;
+		}
+
+		return rvision::core::errc::fail;
+	}
+
+	rvision::core::errc lines_db::fetch_page(const std::string& line, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink, score_page& result)
+	{
+		result = {};
+		result.next = from;
+		result.skip = skip;
+
+		line_id_t _id = 0;
+		if (!line_id(line, _id))
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		if (page == 0 || from > to)
+		{
+			return rvision::core::errc::invalid_argument;
+		}
+
+		std::vector<score_sample> _samples;
+		_samples.reserve(page);
+
+		try
+		{
+			m_logger->debug("lines_db::fetch_page => try to get page of {} for line: {} range: [{}, {}]", page, line, from, to);
+
+			//the connection goes back to the pool before the sink sees the page
+			connection_pool::accessor accessor(m_logger, *m_pool, m_config._readers_timeout);
+
+			auto errc = accessor->fetch_page(_id, from, skip, to, page, _samples);
+			if (errc != rvision::core::errc::success)
+			{
+				return errc;
+			}
+		}
+		catch (const connection_pool::no_resource& )
+		{
+			m_logger->error("lines_db::fetch_page: connection_pool::no_resource for line: {}", line);
+
+			return rvision::core::errc::insufficient_resources;
+		}
+
+		result.advance(_samples);
+		result.more = _samples.size() == page;
+
+		if (!_samples.empty() && !sink(std::span<const score_sample>(_samples)))
+		{
+			result.more = false;
+		}
+
+		return rvision::core::errc::success;
+	}
+
+	rvision::core::errc lines_db::fetch_rollups(const std::string& line, std::int64_t from, std::int64_t to, std::int64_t resolution, std::vector<score_rollup>& rollups, std::int64_t& level)
+	{
+		line_id_t _id = 0;
+		if (!line_id(line, _id))
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		if (m_config._rollups.empty())
+		{
+			return rvision::core::errc::not_implement;
+		}
+
+		level = m_config._rollups.front();
+
+		for (auto l : m_config._rollups)
+		{
+			if (l <= resolution)
+			{
+				level = l;
+			}
+		}
+
+		try
+		{
+			m_logger->debug("lines_db::fetch_rollups => try to get rollups for line: {} range: [{}, {}] level: {}", line, from, to, level);
+
+			auto _start = std::chrono::steady_clock::now();
+
+			connection_pool::accessor accessor(m_logger, *m_pool, m_config._readers_timeout);
+
+			auto errc = read_rollups(*accessor, _id, level, rollup_bucket(from, level), to, rollups);
+
+			m_rollup_latency.record(std::chrono::steady_clock::now() - _start);
+
+			return errc;
+		}
+		catch (const connection_pool::no_resource& )
+		{
+			m_logger->error("lines_db::fetch_rollups: connection_pool::no_resource for line: {}", line);
+
+			return rvision::core::errc::insufficient_resources;
+		}
+
+		return rvision::core::errc::fail;
+	}
+
+	rvision::core::errc lines_db::aggregate(const std::string& line, std::int64_t from, std::int64_t to, score_rollup& result)
+	{
+		result = {};
+
+		line_id_t _id = 0;
+		if (!line_id(line, _id))
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		try
+		{
+			m_logger->debug("lines_db::aggregate => try to aggregate line: {} range: [{}, {}]", line, from, to);
+
+			auto _start = std::chrono::steady_clock::now();
+
+			connection_pool::accessor accessor(m_logger, *m_pool, m_config._readers_timeout);
+
+			auto errc = aggregate(*accessor, _id, from, to, m_config._rollups.size(), result);
+
+			m_rollup_latency.record(std::chrono::steady_clock::now() - _start);
+
+			return errc;
+		}
+		catch (const connection_pool::no_resource& )
+		{
+			m_logger->error("lines_db::aggregate: connection_pool::no_resource for line: {}", line);
+
+			return rvision::core::errc::insufficient_resources;
+		}
+
+		return rvision::core::errc::fail;
+	}
+
+	rvision::core::errc lines_db::fetch_score(const std::string& line, std::int64_t from, std::int64_t to, std::vector<score_sample>& samples)
+	{
+		line_id_t _id = 0;
+		if (!line_id(line, _id))
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		try
+		{
+			m_logger->debug("lines_db::fetch_score => try to get score for line: {} range: [{}, {}]", line, from, to);
+			
+			connection_pool::accessor accessor(m_logger, *m_pool, m_config._readers_timeout);
 
-			return accessor->fetch_score(line, score);
+			return accessor->fetch_score(_id, from, to, samples);
 		}
 		catch (const connection_pool::no_resource& )
 		{
@@ -1,21 +1,113 @@
 #pragma once
 #include <core/headers.hpp>
 #include <core/logger.hpp>
+#include <core/histogram.hpp>
+#include <core/executor.hpp>
+#include <lines/utils/score_sample.hpp>
+#include <lines/db/score_codec.hpp>
+#include <lines/db/lines_storage.hpp>
+#include <lines/db/connection_pool.hpp>
 #include <sqlite3.h>
 
 namespace rvision
 {	
-	class lines_db
+	//history older than _age or beyond the newest _rows samples is deleted, 0 - no limit
+	struct retention_policy
 	{
+		std::chrono::milliseconds _age = std::chrono::milliseconds(0);
+		std::uint32_t _rows = 0;
+	};
+
+	struct lines_db_config
+	{
+		std::string _file = "rvision.db";
+		std::uint32_t _shards = 1;
+		std::uint32_t _commit_rows = 256;
+		std::chrono::milliseconds _commit_interval = std::chrono::milliseconds(100);
+		std::uint32_t _queue_limit = 65536;
+		std::string _journal = "delete";
+		std::uint32_t _readers = 0;
+		std::uint32_t _wal_autocheckpoint = 1000;
+		std::string _checkpoint_mode = "passive";
+		std::chrono::milliseconds _checkpoint_interval = std::chrono::milliseconds(1000);
+		std::chrono::milliseconds _readers_timeout = std::chrono::milliseconds(5000);
+		std::uint32_t _block_rows = 1024;
+		std::vector<std::int64_t> _rollups = {1000, 60000, 3600000};
+		retention_policy _retention;
+		std::unordered_map<std::string, retention_policy> _line_retention;
+		std::chrono::milliseconds _maintenance_interval = std::chrono::milliseconds(0);
+		std::chrono::milliseconds _maintenance_budget = std::chrono::milliseconds(5);
+		std::uint32_t _retention_batch = 1000;
+		std::uint32_t _vacuum_pages = 128;
+		bool _vacuum_on_start = false;
+		std::uint32_t _async_threads = 0;
+	};
+
+	class lines_db : public lines_storage
+	{
+		using line_id_t = std::int64_t;
+
+		struct score_update
+		{
+			line_id_t line = 0;
+			score_sample sample;
+		};
+
+		//update_line_async caller waiting for the group commit of its seq-th queued score
+		struct commit_waiter
+		{
+			std::uint64_t seq = 0;
+			std::promise<rvision::core::errc> promise;
+		};
+
+		struct rollup_update
+		{
+			line_id_t line = 0;
+			std::int64_t level = 0;
+			score_rollup rollup;
+		};
+
+		//line, level, bucket
+		using rollup_key = std::tuple<line_id_t, std::int64_t, std::int64_t>;
+
+		//rollup state of the lines of a batch before roll(), put back when its commit fails
+		struct rollup_snapshot
+		{
+			//an empty vector stands for a line without open buckets
+			std::unordered_map<line_id_t, std::vector<score_rollup>> open;
+			std::map<rollup_key, score_rollup> flushing;
+		};
+
 		struct connection
 		{
 			enum class statements
 			{
 				add_line,
+				line_id,
 				rem_line,
+				rem_scores,
 				update_line,
 				last_score,
-				fetch_score
+				fetch_score,
+				fetch_range,
+				fetch_page,
+				rem_blocks,
+				seal_rows,
+				seal_block,
+				seal_delete,
+				tail_blocks,
+				range_blocks,
+				last_block,
+				update_rollup,
+				fetch_rollups,
+				rem_rollups,
+				retain_scores,
+				retain_blocks,
+				retain_rollups,
+				cutoff_scores,
+				cutoff_rows,
+				last_scores,
+				cutoff_blocks
 			};
 
 			struct connection_cleanup
@@ -45,6 +137,7 @@ namespace rvision
 			};
 
 			using exec_callback_t = std::function<int(void *data, int argc, char **argv, char **azColName)>;
+			using statement_ptr = std::unique_ptr<sqlite3_stmt, statements_cleanup>;
 
 
 			connection(const std::string& path, std::int32_t flags, std::shared_ptr<rvision::core::logger> logger);
@@ -56,92 +149,162 @@ namespace rvision
 			using connection_ptr = std::unique_ptr < sqlite3, connection_cleanup >;
 			
 			rvision::core::errc execute(const std::string& sql);
+			rvision::core::errc checkpoint(int mode, int& wal_frames, int& checkpointed);
+			rvision::core::errc pragma(const std::string& name, std::int64_t& value);
+
+			rvision::core::errc migrate();
+			rvision::core::errc lines(std::unordered_map<std::string, line_id_t>& lines);
 
-			rvision::core::errc add_line(const std::string& line);
-			rvision::core::errc rem_line(const std::string& line);
-			rvision::core::errc update_line(const std::string& line, std::double_t score);
-			rvision::core::errc last_score(const std::string& line, std::double_t& score);
-			rvision::core::errc fetch_score(const std::string& line, std::vector<std::double_t>& score);
+			rvision::core::errc add_line(const std::string& line, line_id_t& id);
+			rvision::core::errc rem_line(line_id_t line);
+			rvision::core::errc update_line(line_id_t line, const score_sample& sample);
+			rvision::core::errc update_lines(const std::vector<score_update>& scores, const std::vector<rollup_update>& rollups);
+			rvision::core::errc update_rollup(const rollup_update& rollup);
+			rvision::core::errc fetch_rollups(line_id_t line, std::int64_t level, std::int64_t from, std::int64_t to, std::vector<score_rollup>& rollups);
+			rvision::core::errc last_score(line_id_t line, score_sample& sample);
+			rvision::core::errc last_block(line_id_t line, score_sample& sample);
+			rvision::core::errc last_scores(const std::string& lines, std::unordered_map<line_id_t, score_sample>& samples);
+			rvision::core::errc fetch_score(line_id_t line, std::vector<std::double_t>& score);
+			rvision::core::errc fetch_score(line_id_t line, std::int64_t from, std::int64_t to, std::vector<score_sample>& samples);
+			rvision::core::errc fetch_page(line_id_t line, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, std::vector<score_sample>& samples);
+
+			rvision::core::errc raw_rows(std::unordered_map<line_id_t, std::uint32_t>& rows);
+			rvision::core::errc seal(line_id_t line, std::uint32_t rows, std::uint32_t& sealed, std::size_t& bytes);
+			rvision::core::errc retention_cutoff(line_id_t line, std::uint32_t rows, std::int64_t& cutoff);
+			rvision::core::errc retain(line_id_t line, std::int64_t cutoff, std::uint32_t batch, std::uint32_t& rows, std::uint32_t& blocks, std::uint32_t& rollups);
 		
 		private:
 			static int busy_handler(void* ud, int count);
+			bool has_column(const std::string& table, const std::string& column);
+			rvision::core::errc migrate_tables(bool& complete);
 			rvision::core::errc retrieve_error(const std::string& sql, int sres, const char* serr);
+			rvision::core::errc retrieve_error(sqlite3_stmt* stmt, int sres);
+
+			sqlite3_stmt* prepare(statements kind);
+			void finalize(statements kind);
+
+			rvision::core::errc decode_block(sqlite3_stmt* stmt, int column, std::vector<score_sample>& samples);
 
 		private:
 			std::shared_ptr<rvision::core::logger> m_logger;
 			connection_ptr m_connection;
+			std::map<statements, statement_ptr> m_statements;
 		};
 
-		struct connection_pool
-		{
-			struct no_resource : public std::exception
-			{
-
-			};
-
-			struct draining : public std::exception
-			{
-
-			};
+		using connection_pool = rvision::connection_pool<connection>;
+		
 
-			struct accessor
-			{
-				accessor(std::shared_ptr<rvision::core::logger> logger, connection_pool& pool, std::uint32_t attemps, const std::chrono::seconds& wait);
-				~accessor();
-				connection* operator->() const noexcept;
-
-			private:
-				std::unique_ptr<connection> m_connection;
-				std::shared_ptr<rvision::core::logger> m_logger;
-				connection_pool& m_pool;
-			};
-						
-			using pool_connection_t = std::unique_ptr<connection>;
-			using pool_connection_factory_t = std::function< pool_connection_t () >;
+	public:
+		//PRAGMA user_version of a fully migrated file
+		static constexpr int schema_version = 1;
 
-			connection_pool(std::uint32_t size, const pool_connection_factory_t& factory);
-			~connection_pool();
+	public:
+		lines_db(const std::string& path, std::shared_ptr<rvision::core::logger> logger, const lines_db_config& config = {});
+		~lines_db() override;
 
-			friend accessor;
-			
-		private:
-			std::uint32_t count() const;
-			std::uint32_t add();
-			pool_connection_t pop();
-			void push(pool_connection_t&& conn);
+	public:
+		rvision::core::errc add_line(const std::string& line) override;
+		rvision::core::errc rem_line(const std::string& line) override;
+		rvision::core::errc update_line(const std::string& line, std::double_t score) override;
+		rvision::core::errc update_line(const std::string& line, const score_sample& sample) override;
+		rvision::core::errc last_score(const std::string& line, std::double_t& score) override;
+		rvision::core::errc last_score(const std::string& line, score_sample& sample) override;
+		rvision::core::errc last_scores(const std::vector<std::string>& lines, score_samples_t& samples) override;
+		rvision::core::errc fetch_score(const std::string& line, std::vector<std::double_t>& score) override;
+		rvision::core::errc fetch_score(const std::string& line, std::int64_t from, std::int64_t to, std::vector<score_sample>& samples) override;
+		rvision::core::errc fetch_page(const std::string& line, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink, score_page& result) override;
+		rvision::core::errc fetch_rollups(const std::string& line, std::int64_t from, std::int64_t to, std::int64_t resolution, std::vector<score_rollup>& rollups, std::int64_t& level) override;
+		rvision::core::errc aggregate(const std::string& line, std::int64_t from, std::int64_t to, score_rollup& result) override;
 
-		private:
-			std::atomic<std::uint32_t> m_max;
-			std::atomic<std::uint32_t> m_curr;
-			std::atomic<bool> m_drainig;
-			std::mutex m_lock;
-			pool_connection_factory_t m_factory;
-			std::deque<pool_connection_t> m_pool;
-			std::shared_ptr<rvision::core::logger> m_logger;
-		};		
-		
+		std::future<rvision::core::errc> add_line_async(const std::string& line) override;
+		std::future<rvision::core::errc> update_line_async(const std::string& line, const score_sample& sample) override;
+		std::future<async_result<score_sample>> last_score_async(const std::string& line) override;
+		std::future<async_result<score_samples_t>> last_scores_async(const std::vector<std::string>& lines) override;
+		std::future<async_result<std::vector<std::double_t>>> fetch_score_async(const std::string& line) override;
+		std::future<async_result<std::vector<score_sample>>> fetch_score_async(const std::string& line, std::int64_t from, std::int64_t to) override;
 
-	public:
-		lines_db(const std::string& path, std::shared_ptr<rvision::core::logger> logger);
-		~lines_db();
+		void metrics(boost::property_tree::ptree& tree) const override;
 
-	public:
-		rvision::core::errc add_line(const std::string& line);
-		rvision::core::errc rem_line(const std::string& line);
-		rvision::core::errc update_line(const std::string& line, std::double_t score);
-		rvision::core::errc last_score(const std::string& line, std::double_t& score);
-		rvision::core::errc fetch_score(const std::string& line, std::vector<std::double_t>& score);
+		//names of the known lines
+		void lines(std::vector<std::string>& lines) const;
 
 	private:
 		void init();
+		bool line_id(const std::string& line, line_id_t& id) const;
+		rvision::core::errc enqueue(const std::string& line, const score_sample& sample, std::promise<rvision::core::errc>* committed);
+		void write(std::stop_token stoken);
+		rvision::core::errc commit(std::vector<score_update>& scores, bool close = false);
+		void committed(std::uint64_t seq, rvision::core::errc errc);
+		void seal(const std::vector<score_update>& scores);
+		void roll(const std::vector<score_update>& scores, std::vector<rollup_update>& flush, bool close, rollup_snapshot& snapshot);
+		void restore(rollup_snapshot& snapshot);
+		std::uint64_t pending_rollups(line_id_t line, std::int64_t level, std::int64_t from, std::int64_t to, std::vector<score_rollup>& rollups) const;
+		rvision::core::errc read_rollups(connection& conn, line_id_t line, std::int64_t level, std::int64_t from, std::int64_t to, std::vector<score_rollup>& rollups) const;
+		rvision::core::errc aggregate(connection& conn, line_id_t line, std::int64_t from, std::int64_t to, std::size_t level, score_rollup& result) const;
+		void checkpoint(std::stop_token stoken);
+		void maintain(std::stop_token stoken);
+		void retain(line_id_t line, const retention_policy& policy, std::stop_token stoken);
+		void vacuum(std::stop_token stoken);
 				
 	private:
 		std::string m_db_path;
+		lines_db_config m_config;
 		std::shared_ptr<rvision::core::logger> m_logger;
 		std::unique_ptr<connection_pool> m_pool;
-		std::mutex m_cache_lock;
-		std::unordered_map<std::string, std::vector<std::double_t>> m_cache;
-		std::atomic<std::uint64_t> m_max;
-		std::atomic<std::uint64_t> m_curr;
+		std::mutex m_writer_lock;
+		std::unique_ptr<connection> m_writer;
+		std::unique_ptr<connection> m_checkpointer;
+		bool m_wal;
+		mutable std::shared_mutex m_lines_lock;
+		std::unordered_map<std::string, line_id_t> m_lines;
+		std::unordered_map<line_id_t, std::uint32_t> m_raw_rows;
+		//lines removed since the last commit, the batch the writer took before the removal still holds their scores
+		std::unordered_set<line_id_t> m_removed_lines;
+		std::mutex m_queue_lock;
+		std::condition_variable_any m_queue_wait;
+		std::vector<score_update> m_queue;
+		std::uint64_t m_enqueued;
+		//set once the writer took its last batch
+		bool m_stopped;
+		std::deque<commit_waiter> m_commit_waiters;
+		std::atomic<std::uint64_t> m_queue_depth;
+		std::atomic<std::uint64_t> m_commits;
+		std::atomic<std::uint64_t> m_committed;
+		std::atomic<std::uint64_t> m_dropped;
+		//rows of batches whose transaction failed
+		std::atomic<std::uint64_t> m_failed;
+		rvision::core::histogram m_commit_latency;
+		rvision::core::histogram m_commit_rows;
+		std::atomic<std::uint64_t> m_sealed_blocks;
+		std::atomic<std::uint64_t> m_sealed_rows;
+		std::atomic<std::uint64_t> m_sealed_bytes;
+		rvision::core::histogram m_seal_latency;
+		mutable std::mutex m_rollup_lock;
+		std::unordered_map<line_id_t, std::vector<score_rollup>> m_open_rollups;
+		//closed buckets and late samples not committed yet
+		std::map<rollup_key, score_rollup> m_flushing_rollups;
+		std::uint64_t m_rollup_generation;
+		std::atomic<std::uint64_t> m_rollups_flushed;
+		mutable rvision::core::histogram m_rollup_latency;
+		std::mutex m_checkpoint_lock;
+		std::condition_variable_any m_checkpoint_wait;
+		std::atomic<std::int64_t> m_wal_frames;
+		std::atomic<std::uint64_t> m_checkpoints;
+		rvision::core::histogram m_checkpoint_latency;
+		std::mutex m_maintenance_lock;
+		std::condition_variable_any m_maintenance_wait;
+		std::atomic<std::uint32_t> m_retention_batch;
+		std::atomic<std::uint64_t> m_maintenance_runs;
+		std::atomic<std::uint64_t> m_retained_rows;
+		std::atomic<std::uint64_t> m_retained_blocks;
+		std::atomic<std::uint64_t> m_retained_rollups;
+		std::atomic<std::uint64_t> m_vacuumed_pages;
+		std::atomic<std::int64_t> m_freelist_pages;
+		std::atomic<std::uint64_t> m_budget_overruns;
+		rvision::core::histogram m_maintenance_slice;
+		std::unique_ptr<rvision::core::executor> m_executor;
+		std::jthread m_write_thread;
+		std::jthread m_checkpoint_thread;
+		std::jthread m_maintenance_thread;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,598 @@
+#include "lines_log.hpp"
+
+namespace rvision
+{
+	static const std::string log_name("lines_log");
+
+	namespace detail
+	{
+		static const std::uint64_t _segment_magic = 0x31474f4c53565200; //"\0RVSLOG1"
+		static const std::string _segment_extension(".seg");
+
+		static std::filesystem::path segment_path(const std::filesystem::path& folder, std::uint64_t sequence)
+		{
+			std::string _name = std::to_string(sequence);
+			_name.insert(0, 20 - std::min<std::size_t>(_name.size(), 20), '0');
+			_name += _segment_extension;
+
+			return folder / _name;
+		}
+	}
+
+	lines_log::segment::segment(const std::filesystem::path& path, std::uint64_t sequence)
+	: path(path), sequence(sequence), file(path.generic_string().c_str(), boost::interprocess::read_write), region(file, boost::interprocess::read_write),
+	header(static_cast<segment_header*>(region.get_address())), data(reinterpret_cast<score_sample*>(header + 1)), unsynced(0)
+	{
+	}
+
+	std::uint64_t lines_log::segment::size() const
+	{
+		return std::min(std::atomic_ref<std::uint64_t>(header->count).load(std::memory_order_acquire), header->capacity);
+	}
+
+	std::span<const score_sample> lines_log::segment::records() const
+	{
+		return std::span<const score_sample>(data, static_cast<std::size_t>(size()));
+	}
+
+	std::span<const score_sample> lines_log::segment::records(std::int64_t from, std::int64_t to, std::uint32_t stride) const
+	{
+		auto _records = records();
+		auto _cmp = [](const score_sample& s, std::int64_t ts) { return s.ts < ts; };
+
+		//the sparse index narrows the binary search to one stride: the one after the last entry before from,
+		//samples equal to from may start in an earlier stride than the last entry equal to it
+		auto _block = std::lower_bound(index.begin(), index.end(), from);
+		std::size_t _first = _block == index.begin() ? 0 : static_cast<std::size_t>(std::distance(index.begin(), _block) - 1) * stride;
+		std::size_t _last = std::min<std::size_t>(_records.size(), _first + stride);
+
+		auto _begin = std::lower_bound(_records.begin() + _first, _records.begin() + _last, from, _cmp);
+
+		auto _end = std::upper_bound(_begin, _records.end(), to, [](std::int64_t ts, const score_sample& s) { return ts < s.ts; });
+
+		return std::span<const score_sample>(_begin, _end);
+	}
+
+	lines_log::lines_log(const std::string& path, std::shared_ptr<rvision::core::logger> logger, const lines_log_config& config)
+		: m_logger(logger), m_path(path), m_config(config), m_segments(0), m_appended(0), m_out_of_order(0), m_rollovers(0), m_retired(0), m_syncs(0)
+	{
+		m_path /= log_name;
+
+		if (m_config._segment_records == 0 || m_config._index_stride == 0)
+		{
+			throw rvision::core::exception("lines_log::lines_log => segment records and index stride must not be 0 !!!", rvision::core::errc::invalid_argument);
+		}
+
+		m_logger->info("lines_log::lines_log => path : {}, segment records : {}, retain segments : {}, sync records : {}, index stride : {}", m_path.generic_string(),
+			m_config._segment_records, m_config._retain_segments, m_config._sync_records, m_config._index_stride);
+
+		std::error_code ec;
+		std::filesystem::create_directories(m_path, ec);
+
+		if (ec)
+		{
+			m_logger->error("lines_log::lines_log => create folder: {} error: {}", m_path.generic_string(), ec.message());
+
+			throw rvision::core::exception("lines_log::lines_log => exception !!!", rvision::core::errc::invalid_argument);
+		}
+
+		init();
+	}
+
+	lines_log::~lines_log()
+	{
+		std::unique_lock<std::shared_mutex> lock(m_lines_lock);
+
+		for (auto& l : m_lines)
+		{
+			std::unique_lock<std::shared_mutex> line_lock(l.second->lock);
+
+			for (auto& s : l.second->segments)
+			{
+				sync_segment(*s, false);
+			}
+		}
+
+		m_logger->debug("lines_log::~lines_log().");
+	}
+
+	void lines_log::init()
+	{
+		std::unique_lock<std::shared_mutex> lock(m_lines_lock);
+
+		for (const auto& f : std::filesystem::directory_iterator(m_path))
+		{
+			if (!f.is_directory())
+			{
+				continue;
+			}
+
+			auto _log = std::make_shared<line_log>();
+			_log->folder = f.path();
+
+			std::vector<std::pair<std::uint64_t, std::filesystem::path>> _files;
+
+			for (const auto& s : std::filesystem::directory_iterator(f.path()))
+			{
+				if (!s.is_regular_file() || s.path().extension() != detail::_segment_extension)
+				{
+					continue;
+				}
+
+				auto _stem = s.path().stem().string();
+				std::uint64_t _sequence = 0;
+
+				auto [_end, _ec] = std::from_chars(_stem.data(), _stem.data() + _stem.size(), _sequence);
+
+				if (_ec != std::errc() || _end != _stem.data() + _stem.size())
+				{
+					m_logger->warn("lines_log::init => file: {} is not a segment, skipped", s.path().generic_string());
+
+					continue;
+				}
+
+				_files.emplace_back(_sequence, s.path());
+			}
+
+			std::sort(_files.begin(), _files.end());
+
+			for (const auto& [sequence, p] : _files)
+			{
+				if (auto _segment = open_segment(p, sequence); _segment)
+				{
+					_log->segments.emplace_back(std::move(_segment));
+				}
+			}
+
+			m_segments.fetch_add(_log->segments.size(), std::memory_order_relaxed);
+
+			m_lines.emplace(f.path().filename().string(), std::move(_log));
+		}
+
+		m_logger->info("lines_log::init => known lines : {}, segments : {}", m_lines.size(), m_segments.load(std::memory_order_relaxed));
+	}
+
+	std::unique_ptr<lines_log::segment> lines_log::open_segment(const std::filesystem::path& path, std::uint64_t sequence)
+	{
+		try
+		{
+			auto _segment = std::make_unique<segment>(path, sequence);
+
+			if (_segment->region.get_size() < sizeof(segment_header) || _segment->header->magic != detail::_segment_magic
+				|| _segment->region.get_size() < sizeof(segment_header) + _segment->header->capacity * sizeof(score_sample))
+			{
+				m_logger->error("lines_log::open_segment => segment: {} is corrupt, skipped", path.generic_string());
+
+				return nullptr;
+			}
+
+			index_segment(*_segment);
+
+			return _segment;
+		}
+		catch (const boost::interprocess::interprocess_exception& ex)
+		{
+			m_logger->error("lines_log::open_segment => segment: {} error: {}", path.generic_string(), ex.what());
+		}
+
+		return nullptr;
+	}
+
+	std::unique_ptr<lines_log::segment> lines_log::create_segment(line_log& log)
+	{
+		std::uint64_t _sequence = log.segments.empty() ? 0 : log.segments.back()->sequence + 1;
+		auto _path = detail::segment_path(log.folder, _sequence);
+
+		try
+		{
+			{
+				std::ofstream _file(_path, std::ios::binary | std::ios::trunc);
+			}
+
+			std::filesystem::resize_file(_path, sizeof(segment_header) + std::uint64_t(m_config._segment_records) * sizeof(score_sample));
+
+			auto _segment = std::make_unique<segment>(_path, _sequence);
+
+			_segment->header->capacity = m_config._segment_records;
+			_segment->header->count = 0;
+			_segment->header->magic = detail::_segment_magic;
+
+			_segment->index.reserve(m_config._segment_records / m_config._index_stride + 1);
+
+			m_segments.fetch_add(1, std::memory_order_relaxed);
+
+			return _segment;
+		}
+		catch (const std::exception& ex)
+		{
+			m_logger->error("lines_log::create_segment => segment: {} error: {}", _path.generic_string(), ex.what());
+		}
+
+		return nullptr;
+	}
+
+	void lines_log::index_segment(segment& seg)
+	{
+		auto _records = seg.records();
+
+		seg.index.clear();
+		seg.index.reserve(seg.header->capacity / m_config._index_stride + 1);
+
+		for (std::size_t i = 0; i < _records.size(); i += m_config._index_stride)
+		{
+			seg.index.emplace_back(_records[i].ts);
+		}
+	}
+
+	void lines_log::sync_segment(segment& seg, bool async)
+	{
+		if (seg.unsynced == 0)
+		{
+			return;
+		}
+
+		auto _start = std::chrono::steady_clock::now();
+
+		seg.region.flush(0, 0, async);
+
+		m_sync_latency.record(std::chrono::steady_clock::now() - _start);
+		m_syncs.fetch_add(1, std::memory_order_relaxed);
+
+		seg.unsynced = 0;
+	}
+
+	std::shared_ptr<lines_log::line_log> lines_log::find(const std::string& line) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_lines_lock);
+
+		if (auto p = m_lines.find(line); p != m_lines.end())
+		{
+			return p->second;
+		}
+
+		m_logger->error("lines_log::find => unknown line: {}", line);
+
+		return nullptr;
+	}
+
+	rvision::core::errc lines_log::add_line(const std::string& line)
+	{
+		m_logger->debug("lines_log::add_line => try to add line: {}", line);
+
+		std::unique_lock<std::shared_mutex> lock(m_lines_lock);
+
+		if (m_lines.contains(line))
+		{
+			return rvision::core::errc::success;
+		}
+
+		auto _log = std::make_shared<line_log>();
+		_log->folder = m_path / line;
+
+		std::error_code ec;
+		std::filesystem::create_directories(_log->folder, ec);
+
+		if (ec)
+		{
+			m_logger->error("lines_log::add_line => create folder: {} error: {}", _log->folder.generic_string(), ec.message());
+
+			return rvision::core::errc::fail;
+		}
+
+		m_lines.emplace(line, std::move(_log));
+
+		return rvision::core::errc::success;
+	}
+
+	rvision::core::errc lines_log::rem_line(const std::string& line)
+	{
+		m_logger->debug("lines_log::rem_line => try to rem line: {}", line);
+
+		std::shared_ptr<line_log> _log;
+		{
+			std::unique_lock<std::shared_mutex> lock(m_lines_lock);
+
+			if (auto p = m_lines.find(line); p != m_lines.end())
+			{
+				_log = std::move(p->second);
+
+				m_lines.erase(p);
+			}
+		}
+
+		if (!_log)
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		std::unique_lock<std::shared_mutex> lock(_log->lock);
+
+		m_segments.fetch_sub(_log->segments.size(), std::memory_order_relaxed);
+
+		_log->segments.clear();
+
+		std::error_code ec;
+		std::filesystem::remove_all(_log->folder, ec);
+
+		if (ec)
+		{
+			m_logger->error("lines_log::rem_line => remove folder: {} error: {}", _log->folder.generic_string(), ec.message());
+
+			return rvision::core::errc::fail;
+		}
+
+		return rvision::core::errc::success;
+	}
+
+	rvision::core::errc lines_log::update_line(const std::string& line, std::double_t score)
+	{
+		return update_line(line, score_sample{score_now(), score});
+	}
+
+	rvision::core::errc lines_log::update_line(const std::string& line, const score_sample& sample)
+	{
+		auto _log = find(line);
+		if (!_log)
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		std::unique_lock<std::shared_mutex> lock(_log->lock);
+
+		segment* _segment = _log->segments.empty() ? nullptr : _log->segments.back().get();
+
+		if (_segment && _segment->size() != 0 && sample.ts < _segment->data[_segment->size() - 1].ts)
+		{
+			//records stay sorted so range reads can binary search them
+			m_out_of_order.fetch_add(1, std::memory_order_relaxed);
+
+			m_logger->debug("lines_log::update_line => out of order sample for line: {} ts: {}", line, sample.ts);
+
+			return rvision::core::errc::invalid_argument;
+		}
+
+		if (!_segment || _segment->size() == _segment->header->capacity)
+		{
+			if (_segment)
+			{
+				sync_segment(*_segment, true);
+
+				m_rollovers.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			auto _created = create_segment(*_log);
+			if (!_created)
+			{
+				return rvision::core::errc::fail;
+			}
+
+			_segment = _created.get();
+
+			_log->segments.emplace_back(std::move(_created));
+
+			//retention drops whole segments, oldest first
+			while (m_config._retain_segments != 0 && _log->segments.size() > m_config._retain_segments)
+			{
+				auto _path = _log->segments.front()->path;
+
+				_log->segments.pop_front();
+
+				std::error_code ec;
+				std::filesystem::remove(_path, ec);
+
+				m_segments.fetch_sub(1, std::memory_order_relaxed);
+				m_retired.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		auto _count = _segment->size();
+
+		std::memcpy(_segment->data + _count, &sample, sizeof(score_sample));
+
+		if (_count % m_config._index_stride == 0)
+		{
+			_segment->index.emplace_back(sample.ts);
+		}
+
+		std::atomic_ref<std::uint64_t>(_segment->header->count).store(_count + 1, std::memory_order_release);
+
+		m_appended.fetch_add(1, std::memory_order_relaxed);
+
+		if (m_config._sync_records != 0 && ++_segment->unsynced >= m_config._sync_records)
+		{
+			sync_segment(*_segment, true);
+		}
+
+		return rvision::core::errc::success;
+	}
+
+	rvision::core::errc lines_log::last_score(const std::string& line, std::double_t& score)
+	{
+		score_sample _sample;
+
+		auto errc = last_score(line, _sample);
+		if (errc == rvision::core::errc::success)
+		{
+			score = _sample.score;
+		}
+
+		return errc;
+	}
+
+	rvision::core::errc lines_log::last_score(const std::string& line, score_sample& sample)
+	{
+		auto _log = find(line);
+		if (!_log)
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		std::shared_lock<std::shared_mutex> lock(_log->lock);
+
+		for (auto s = _log->segments.rbegin(); s != _log->segments.rend(); ++s)
+		{
+			if (auto _records = (*s)->records(); !_records.empty())
+			{
+				sample = _records.back();
+
+				return rvision::core::errc::success;
+			}
+		}
+
+		return rvision::core::errc::not_found;
+	}
+
+	rvision::core::errc lines_log::fetch_score(const std::string& line, std::vector<std::double_t>& score)
+	{
+		auto _log = find(line);
+		if (!_log)
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		std::shared_lock<std::shared_mutex> lock(_log->lock);
+
+		//segments are walked back from the newest until the portion is found, then copied forward
+		std::size_t _total = 0;
+		auto _first = _log->segments.size();
+
+		while (_first > 0 && _total < fetch_portion)
+		{
+			_total += _log->segments[--_first]->size();
+		}
+
+		auto _skip = _total > fetch_portion ? _total - fetch_portion : 0;
+
+		score.reserve(score.size() + std::min(_total, fetch_portion));
+
+		for (auto i = _first; i < _log->segments.size(); ++i)
+		{
+			auto _records = _log->segments[i]->records();
+
+			if (_skip >= _records.size())
+			{
+				_skip -= _records.size();
+
+				continue;
+			}
+
+			for (const auto& r : _records.subspan(_skip))
+			{
+				score.emplace_back(r.score);
+			}
+
+			_skip = 0;
+		}
+
+		return rvision::core::errc::success;
+	}
+
+	rvision::core::errc lines_log::fetch_score(const std::string& line, std::int64_t from, std::int64_t to, std::vector<score_sample>& samples)
+	{
+		return scan(line, from, to, [&samples](std::span<const score_sample> records)
+		{
+			samples.insert(samples.end(), records.begin(), records.end());
+
+			return true;
+		});
+	}
+
+	rvision::core::errc lines_log::fetch_page(const std::string& line, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink, score_page& result)
+	{
+		result = {};
+		result.next = from;
+		result.skip = skip;
+
+		if (page == 0 || from > to)
+		{
+			return rvision::core::errc::invalid_argument;
+		}
+
+		std::vector<score_sample> _samples;
+		_samples.reserve(page);
+
+		//the page is copied out under the line lock, the sink sees it once the lock is released
+		auto errc = scan(line, from, to, [&](std::span<const score_sample> records)
+		{
+			//the samples of ts from the previous page ended with
+			while (skip != 0 && !records.empty() && records.front().ts == from)
+			{
+				records = records.subspan(1);
+				--skip;
+			}
+
+			auto _records = records.first(std::min<std::size_t>(records.size(), page - _samples.size()));
+
+			_samples.insert(_samples.end(), _records.begin(), _records.end());
+
+			return _samples.size() < page;
+		});
+
+		if (errc != rvision::core::errc::success)
+		{
+			return errc;
+		}
+
+		result.advance(_samples);
+		result.more = _samples.size() == page;
+
+		if (!_samples.empty() && !sink(std::span<const score_sample>(_samples)))
+		{
+			result.more = false;
+		}
+
+		return errc;
+	}
+
+	rvision::core::errc lines_log::scan(const std::string& line, std::int64_t from, std::int64_t to, const scan_callback_t& callback)
+	{
+		auto _log = find(line);
+		if (!_log)
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		std::shared_lock<std::shared_mutex> lock(_log->lock);
+
+		for (const auto& s : _log->segments)
+		{
+			auto _records = s->records();
+
+			if (_records.empty() || _records.back().ts < from)
+			{
+				continue;
+			}
+
+			if (_records.front().ts > to)
+			{
+				break;
+			}
+
+			if (auto _range = s->records(from, to, m_config._index_stride); !_range.empty() && !callback(_range))
+			{
+				break;
+			}
+		}
+
+		return rvision::core::errc::success;
+	}
+
+	void lines_log::metrics(boost::property_tree::ptree& tree) const
+	{
+		{
+			std::shared_lock<std::shared_mutex> lock(m_lines_lock);
+
+			tree.put("log.lines", m_lines.size());
+		}
+
+		tree.put("log.segments", m_segments.load(std::memory_order_relaxed));
+		tree.put("log.segment_bytes", sizeof(segment_header) + std::uint64_t(m_config._segment_records) * sizeof(score_sample));
+		tree.put("log.appended", m_appended.load(std::memory_order_relaxed));
+		tree.put("log.out_of_order", m_out_of_order.load(std::memory_order_relaxed));
+		tree.put("log.rollovers", m_rollovers.load(std::memory_order_relaxed));
+		tree.put("log.retired", m_retired.load(std::memory_order_relaxed));
+		tree.put("log.syncs", m_syncs.load(std::memory_order_relaxed));
+
+		rvision::core::put_histogram(tree, "log.sync_latency_us", m_sync_latency);
+	}
+}
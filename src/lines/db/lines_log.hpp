@@ -0,0 +1,101 @@
+#pragma once
+#include <core/headers.hpp>
+#include <core/logger.hpp>
+#include <core/histogram.hpp>
+#include <lines/utils/score_sample.hpp>
+#include <lines/db/lines_storage.hpp>
+
+namespace rvision
+{
+	struct lines_log_config
+	{
+		std::uint32_t _segment_records = 65536;
+		std::uint32_t _retain_segments = 0;
+		std::uint32_t _sync_records = 4096;
+		std::uint32_t _index_stride = 64;
+	};
+
+	//append-only score log: one folder per line, fixed-size (ts, score) records in mmap'd segment files
+	class lines_log : public lines_storage
+	{
+		static_assert(sizeof(score_sample) == 16 && std::is_standard_layout_v<score_sample>, "score_sample is the on-disk record");
+
+		struct segment_header
+		{
+			std::uint64_t magic;
+			std::uint64_t capacity;
+			std::uint64_t count;
+			std::uint64_t reserved[5];
+		};
+
+		struct segment
+		{
+			segment(const std::filesystem::path& path, std::uint64_t sequence);
+
+			std::uint64_t size() const;
+			std::span<const score_sample> records() const;
+			std::span<const score_sample> records(std::int64_t from, std::int64_t to, std::uint32_t stride) const;
+
+			std::filesystem::path path;
+			std::uint64_t sequence;
+			boost::interprocess::file_mapping file;
+			boost::interprocess::mapped_region region;
+			segment_header* header;
+			score_sample* data;
+			//ts of every stride-th record
+			std::vector<std::int64_t> index;
+			std::uint64_t unsynced;
+		};
+
+		struct line_log
+		{
+			std::shared_mutex lock;
+			std::filesystem::path folder;
+			std::deque<std::unique_ptr<segment>> segments;
+		};
+
+	public:
+		using scan_callback_t = std::function<bool(std::span<const score_sample> records)>;
+
+		lines_log(const std::string& path, std::shared_ptr<rvision::core::logger> logger, const lines_log_config& config = {});
+		~lines_log() override;
+
+	public:
+		rvision::core::errc add_line(const std::string& line) override;
+		rvision::core::errc rem_line(const std::string& line) override;
+		rvision::core::errc update_line(const std::string& line, std::double_t score) override;
+		rvision::core::errc update_line(const std::string& line, const score_sample& sample) override;
+		rvision::core::errc last_score(const std::string& line, std::double_t& score) override;
+		rvision::core::errc last_score(const std::string& line, score_sample& sample) override;
+		rvision::core::errc fetch_score(const std::string& line, std::vector<std::double_t>& score) override;
+		rvision::core::errc fetch_score(const std::string& line, std::int64_t from, std::int64_t to, std::vector<score_sample>& samples) override;
+		rvision::core::errc fetch_page(const std::string& line, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink, score_page& result) override;
+
+		//zero-copy range read, the spans point into the mapping and are valid only inside the callback
+		rvision::core::errc scan(const std::string& line, std::int64_t from, std::int64_t to, const scan_callback_t& callback);
+
+		void metrics(boost::property_tree::ptree& tree) const override;
+
+	private:
+		void init();
+		std::shared_ptr<line_log> find(const std::string& line) const;
+		std::unique_ptr<segment> open_segment(const std::filesystem::path& path, std::uint64_t sequence);
+		std::unique_ptr<segment> create_segment(line_log& log);
+		void index_segment(segment& seg);
+		void sync_segment(segment& seg, bool async);
+
+	private:
+		std::shared_ptr<rvision::core::logger> m_logger;
+		std::filesystem::path m_path;
+		lines_log_config m_config;
+		mutable std::shared_mutex m_lines_lock;
+		std::unordered_map<std::string, std::shared_ptr<line_log>> m_lines;
+		std::atomic<std::uint64_t> m_segments;
+		std::atomic<std::uint64_t> m_appended;
+		std::atomic<std::uint64_t> m_out_of_order;
+		std::atomic<std::uint64_t> m_rollovers;
+		std::atomic<std::uint64_t> m_retired;
+		std::atomic<std::uint64_t> m_syncs;
+		rvision::core::histogram m_sync_latency;
+	};
+}
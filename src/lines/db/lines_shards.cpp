@@ -0,0 +1,303 @@
+#include "lines_shards.hpp"
+
+namespace rvision
+{
+	namespace detail
+	{
+		static const std::string _unsharded_file("rvision.db");
+	}
+
+	lines_shards::lines_shards(const std::string& path, std::shared_ptr<rvision::core::logger> logger, const lines_db_config& config)
+		: m_logger(logger)
+	{
+		const auto _count = std::max<std::uint32_t>(config._shards, 1);
+
+		check_layout(path, _count, logger);
+
+		//the readers and the executor threads are split between the shards
+		auto _readers = config._readers ? config._readers : 2 * std::thread::hardware_concurrency();
+
+		lines_db_config _config(config);
+		_config._readers = std::max<std::uint32_t>(_readers / _count, 1);
+		_config._async_threads = config._async_threads ? std::max<std::uint32_t>(config._async_threads / _count, 1) : 0;
+
+		m_logger->info("lines_shards::lines_shards => path : {}, shards : {}, readers per shard : {}", path, _count, _config._readers);
+
+		for (std::uint32_t i = 0; i < _count; ++i)
+		{
+			_config._file = shard_file(i);
+
+			m_shards.emplace_back(std::make_unique<lines_db>(path, logger, _config));
+		}
+
+		for (std::uint32_t i = 0; i < _count; ++i)
+		{
+			std::vector<std::string> _lines;
+			m_shards[i]->lines(_lines);
+
+			for (const auto& l : _lines)
+			{
+				if (shard_of(l, _count) != i)
+				{
+					m_logger->error("lines_shards::lines_shards => line: {} is in shard {} but hashes to {}", l, i, shard_of(l, _count));
+
+					throw rvision::core::exception("lines_shards::lines_shards => shard count changed, reshard first !!!", rvision::core::errc::invalid_argument);
+				}
+			}
+		}
+	}
+
+	lines_shards::~lines_shards()
+	{
+		m_logger->debug("lines_shards::~lines_shards().");
+	}
+
+	void lines_shards::check_layout(const std::string& path, std::uint32_t shards, std::shared_ptr<rvision::core::logger> logger)
+	{
+		shards = std::max<std::uint32_t>(shards, 1);
+
+		//a file of another layout left behind means its lines would silently start over empty
+		if (shards > 1 && std::filesystem::exists(path + detail::_unsharded_file))
+		{
+			throw rvision::core::exception("lines_shards::check_layout => rvision.db has to be resharded first !!!", rvision::core::errc::invalid_argument);
+		}
+
+		std::error_code _ec;
+
+		for (const auto& e : std::filesystem::directory_iterator(path, _ec))
+		{
+			auto _name = e.path().filename().string();
+
+			if (!_name.starts_with("rvision-") || !_name.ends_with(".db"))
+			{
+				continue;
+			}
+
+			std::uint32_t _shard = 0;
+			auto _first = _name.data() + 8;
+			auto _last = _name.data() + _name.size() - 3;
+			auto [_end, _errc] = std::from_chars(_first, _last, _shard);
+
+			if (_errc != std::errc() || _end != _last || _first == _last)
+			{
+				continue;
+			}
+
+			if (_shard >= shards)
+			{
+				logger->error("lines_shards::check_layout => {} is left from more shards than {}", _name, shards);
+
+				throw rvision::core::exception("lines_shards::check_layout => shard count changed, reshard first !!!", rvision::core::errc::invalid_argument);
+			}
+		}
+	}
+
+	std::uint32_t lines_shards::shard_of(const std::string& line, std::uint32_t shards)
+	{
+		//fnv-1a 64
+		std::uint64_t _hash = 14695981039346656037ull;
+
+		for (auto c : line)
+		{
+			_hash = (_hash ^ static_cast<std::uint8_t>(c)) * 1099511628211ull;
+		}
+
+		return static_cast<std::uint32_t>(_hash % std::max<std::uint32_t>(shards, 1));
+	}
+
+	std::string lines_shards::shard_file(std::uint32_t shard)
+	{
+		return "rvision-" + std::to_string(shard) + ".db";
+	}
+
+	lines_db& lines_shards::shard(const std::string& line) const
+	{
+		return *m_shards[shard_of(line, static_cast<std::uint32_t>(m_shards.size()))];
+	}
+
+	rvision::core::errc lines_shards::add_line(const std::string& line)
+	{
+		return shard(line).add_line(line);
+	}
+
+	rvision::core::errc lines_shards::rem_line(const std::string& line)
+	{
+		return shard(line).rem_line(line);
+	}
+
+	rvision::core::errc lines_shards::update_line(const std::string& line, std::double_t score)
+	{
+		return shard(line).update_line(line, score);
+	}
+
+	rvision::core::errc lines_shards::update_line(const std::string& line, const score_sample& sample)
+	{
+		return shard(line).update_line(line, sample);
+	}
+
+	rvision::core::errc lines_shards::last_score(const std::string& line, std::double_t& score)
+	{
+		return shard(line).last_score(line, score);
+	}
+
+	rvision::core::errc lines_shards::last_score(const std::string& line, score_sample& sample)
+	{
+		return shard(line).last_score(line, sample);
+	}
+
+	rvision::core::errc lines_shards::last_scores(const std::vector<std::string>& lines, score_samples_t& samples)
+	{
+		//one batch per shard, all shards at once
+		std::vector<std::vector<std::string>> _batches(m_shards.size());
+
+		for (const auto& l : lines)
+		{
+			_batches[shard_of(l, static_cast<std::uint32_t>(m_shards.size()))].emplace_back(l);
+		}
+
+		std::vector<std::future<async_result<score_samples_t>>> _pending;
+		_pending.reserve(m_shards.size());
+
+		for (std::size_t i = 0; i < m_shards.size(); ++i)
+		{
+			if (!_batches[i].empty())
+			{
+				_pending.emplace_back(m_shards[i]->last_scores_async(_batches[i]));
+			}
+		}
+
+		auto errc = rvision::core::errc::success;
+
+		samples.reserve(samples.size() + lines.size());
+
+		for (auto& f : _pending)
+		{
+			auto _result = f.get();
+
+			if (_result.errc != rvision::core::errc::success)
+			{
+				errc = _result.errc;
+			}
+
+			samples.merge(_result.value);
+		}
+
+		return errc;
+	}
+
+	rvision::core::errc lines_shards::fetch_score(const std::string& line, std::vector<std::double_t>& score)
+	{
+		return shard(line).fetch_score(line, score);
+	}
+
+	rvision::core::errc lines_shards::fetch_score(const std::string& line, std::int64_t from, std::int64_t to, std::vector<score_sample>& samples)
+	{
+		return shard(line).fetch_score(line, from, to, samples);
+	}
+
+	rvision::core::errc lines_shards::fetch_page(const std::string& line, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink, score_page& result)
+	{
+		return shard(line).fetch_page(line, from, skip, to, page, sink, result);
+	}
+
+	rvision::core::errc lines_shards::fetch_rollups(const std::string& line, std::int64_t from, std::int64_t to, std::int64_t resolution, std::vector<score_rollup>& rollups, std::int64_t& level)
+	{
+		return shard(line).fetch_rollups(line, from, to, resolution, rollups, level);
+	}
+
+	rvision::core::errc lines_shards::aggregate(const std::string& line, std::int64_t from, std::int64_t to, score_rollup& result)
+	{
+		return shard(line).aggregate(line, from, to, result);
+	}
+
+	std::future<rvision::core::errc> lines_shards::add_line_async(const std::string& line)
+	{
+		return shard(line).add_line_async(line);
+	}
+
+	std::future<rvision::core::errc> lines_shards::update_line_async(const std::string& line, const score_sample& sample)
+	{
+		return shard(line).update_line_async(line, sample);
+	}
+
+	std::future<async_result<score_sample>> lines_shards::last_score_async(const std::string& line)
+	{
+		return shard(line).last_score_async(line);
+	}
+
+	std::future<async_result<score_samples_t>> lines_shards::last_scores_async(const std::vector<std::string>& lines)
+	{
+		//the shard batches are queued at once, the merge runs in the thread that waits for the result
+		std::vector<std::vector<std::string>> _batches(m_shards.size());
+
+		for (const auto& l : lines)
+		{
+			_batches[shard_of(l, static_cast<std::uint32_t>(m_shards.size()))].emplace_back(l);
+		}
+
+		auto _pending = std::make_shared<std::vector<std::future<async_result<score_samples_t>>>>();
+
+		for (std::size_t i = 0; i < m_shards.size(); ++i)
+		{
+			if (!_batches[i].empty())
+			{
+				_pending->emplace_back(m_shards[i]->last_scores_async(_batches[i]));
+			}
+		}
+
+		return std::async(std::launch::deferred, [_pending]()
+		{
+			async_result<score_samples_t> _result;
+			_result.errc = rvision::core::errc::success;
+
+			for (auto& f : *_pending)
+			{
+				auto _shard = f.get();
+
+				if (_shard.errc != rvision::core::errc::success)
+				{
+					_result.errc = _shard.errc;
+				}
+
+				_result.value.merge(_shard.value);
+			}
+
+			return _result;
+		});
+	}
+
+	std::future<async_result<std::vector<std::double_t>>> lines_shards::fetch_score_async(const std::string& line)
+	{
+		return shard(line).fetch_score_async(line);
+	}
+
+	std::future<async_result<std::vector<score_sample>>> lines_shards::fetch_score_async(const std::string& line, std::int64_t from, std::int64_t to)
+	{
+		return shard(line).fetch_score_async(line, from, to);
+	}
+
+	void lines_shards::metrics(boost::property_tree::ptree& tree) const
+	{
+		tree.put("db.shards.count", m_shards.size());
+
+		std::uint64_t _queue_depth = 0;
+		std::uint64_t _committed = 0;
+		std::uint64_t _dropped = 0;
+
+		for (std::size_t i = 0; i < m_shards.size(); ++i)
+		{
+			boost::property_tree::ptree _shard;
+			m_shards[i]->metrics(_shard);
+
+			_queue_depth += _shard.get<std::uint64_t>("db.queue_depth", 0);
+			_committed += _shard.get<std::uint64_t>("db.committed", 0);
+			_dropped += _shard.get<std::uint64_t>("db.dropped", 0);
+
+			tree.put_child("db.shards." + std::to_string(i), _shard.get_child("db"));
+		}
+
+		tree.put("db.queue_depth", _queue_depth);
+		tree.put("db.committed", _committed);
+		tree.put("db.dropped", _dropped);
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <core/headers.hpp>
+#include <core/logger.hpp>
+#include <lines/db/lines_db.hpp>
+
+namespace rvision
+{
+	//lines hashed onto _shards sqlite files rvision-0.db .. rvision-<n-1>.db, each with its own writer, readers and executor
+	class lines_shards : public lines_storage
+	{
+	public:
+		lines_shards(const std::string& path, std::shared_ptr<rvision::core::logger> logger, const lines_db_config& config);
+		~lines_shards() override;
+
+	public:
+		//stable across builds and platforms, the reshard tool places lines with it too
+		static std::uint32_t shard_of(const std::string& line, std::uint32_t shards);
+		static std::string shard_file(std::uint32_t shard);
+		//throws when the folder holds files of another shard count, rvision.db counts as one shard
+		static void check_layout(const std::string& path, std::uint32_t shards, std::shared_ptr<rvision::core::logger> logger);
+
+		rvision::core::errc add_line(const std::string& line) override;
+		rvision::core::errc rem_line(const std::string& line) override;
+		rvision::core::errc update_line(const std::string& line, std::double_t score) override;
+		rvision::core::errc update_line(const std::string& line, const score_sample& sample) override;
+		rvision::core::errc last_score(const std::string& line, std::double_t& score) override;
+		rvision::core::errc last_score(const std::string& line, score_sample& sample) override;
+		rvision::core::errc last_scores(const std::vector<std::string>& lines, score_samples_t& samples) override;
+		rvision::core::errc fetch_score(const std::string& line, std::vector<std::double_t>& score) override;
+		rvision::core::errc fetch_score(const std::string& line, std::int64_t from, std::int64_t to, std::vector<score_sample>& samples) override;
+		rvision::core::errc fetch_page(const std::string& line, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink, score_page& result) override;
+		rvision::core::errc fetch_rollups(const std::string& line, std::int64_t from, std::int64_t to, std::int64_t resolution, std::vector<score_rollup>& rollups, std::int64_t& level) override;
+		rvision::core::errc aggregate(const std::string& line, std::int64_t from, std::int64_t to, score_rollup& result) override;
+
+		std::future<rvision::core::errc> add_line_async(const std::string& line) override;
+		std::future<rvision::core::errc> update_line_async(const std::string& line, const score_sample& sample) override;
+		std::future<async_result<score_sample>> last_score_async(const std::string& line) override;
+		std::future<async_result<score_samples_t>> last_scores_async(const std::vector<std::string>& lines) override;
+		std::future<async_result<std::vector<std::double_t>>> fetch_score_async(const std::string& line) override;
+		std::future<async_result<std::vector<score_sample>>> fetch_score_async(const std::string& line, std::int64_t from, std::int64_t to) override;
+
+		void metrics(boost::property_tree::ptree& tree) const override;
+
+	private:
+		lines_db& shard(const std::string& line) const;
+
+	private:
+		std::shared_ptr<rvision::core::logger> m_logger;
+		std::vector<std::unique_ptr<lines_db>> m_shards;
+	};
+}
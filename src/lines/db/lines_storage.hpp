@@ -0,0 +1,153 @@
+#pragma once
+#include <core/headers.hpp>
+#include <lines/utils/score_sample.hpp>
+#include <lines/utils/score_rollup.hpp>
+
+namespace rvision
+{
+	//one keyset page of a history read, while more is set the following page starts at next after skip samples of ts next:
+	//samples sharing a ts may straddle two pages
+	struct score_page
+	{
+		std::size_t count = 0;
+		bool more = false;
+		std::int64_t next = 0;
+		std::uint32_t skip = 0;
+
+		//counts samples handed on in ts order, next and skip follow the last of them
+		void advance(std::span<const score_sample> samples)
+		{
+			if (samples.empty())
+			{
+				return;
+			}
+
+			auto _last = samples.back().ts;
+			auto _equal = std::find_if(samples.rbegin(), samples.rend(), [_last](const score_sample& s) { return s.ts != _last; }) - samples.rbegin();
+
+			skip = static_cast<std::size_t>(_equal) == samples.size() && next == _last ? skip + static_cast<std::uint32_t>(_equal) : static_cast<std::uint32_t>(_equal);
+			next = _last;
+			count += samples.size();
+		}
+	};
+
+	//receives the samples of a page in ts order, returning false stops the read
+	using score_sink_t = std::function<bool(std::span<const score_sample> samples)>;
+
+	//value of an async call, errc tells whether value is filled
+	template<typename T>
+	struct async_result
+	{
+		rvision::core::errc errc = rvision::core::errc::fail;
+		T value{};
+	};
+
+	using score_samples_t = std::unordered_map<std::string, score_sample>;
+
+	//score history backend of lines_provider, selected by lines_storage in rvision.json
+	class lines_storage
+	{
+	public:
+		//samples fetch_score(line, score) returns: the newest ones, oldest first
+		static constexpr std::size_t fetch_portion = 100;
+
+	public:
+		virtual ~lines_storage() = default;
+
+		virtual rvision::core::errc add_line(const std::string& line) = 0;
+		virtual rvision::core::errc rem_line(const std::string& line) = 0;
+		virtual rvision::core::errc update_line(const std::string& line, std::double_t score) = 0;
+		virtual rvision::core::errc update_line(const std::string& line, const score_sample& sample) = 0;
+		virtual rvision::core::errc last_score(const std::string& line, std::double_t& score) = 0;
+		virtual rvision::core::errc last_score(const std::string& line, score_sample& sample) = 0;
+		virtual rvision::core::errc fetch_score(const std::string& line, std::vector<std::double_t>& score) = 0;
+		virtual rvision::core::errc fetch_score(const std::string& line, std::int64_t from, std::int64_t to, std::vector<score_sample>& samples) = 0;
+		//skip samples of ts from are left out, they were on the previous page
+		virtual rvision::core::errc fetch_page(const std::string& line, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink, score_page& result) = 0;
+
+		//last sample of each known line, unknown lines are left out of samples
+		virtual rvision::core::errc last_scores(const std::vector<std::string>& lines, score_samples_t& samples)
+		{
+			samples.reserve(samples.size() + lines.size());
+
+			for (const auto& l : lines)
+			{
+				score_sample _sample;
+
+				if (last_score(l, _sample) == rvision::core::errc::success)
+				{
+					samples.emplace(l, _sample);
+				}
+			}
+
+			return rvision::core::errc::success;
+		}
+
+		//rollup buckets of the coarsest level not wider than resolution, level is the chosen bucket width
+		virtual rvision::core::errc fetch_rollups(const std::string& line, std::int64_t from, std::int64_t to, std::int64_t resolution, std::vector<score_rollup>& rollups, std::int64_t& level)
+		{
+			return rvision::core::errc::not_implement;
+		}
+
+		//one aggregate of [from, to]
+		virtual rvision::core::errc aggregate(const std::string& line, std::int64_t from, std::int64_t to, score_rollup& result)
+		{
+			return rvision::core::errc::not_implement;
+		}
+
+		//async variants, a backend without its own executor completes them inline
+		virtual std::future<rvision::core::errc> add_line_async(const std::string& line)
+		{
+			return ready(add_line(line));
+		}
+
+		virtual std::future<rvision::core::errc> update_line_async(const std::string& line, const score_sample& sample)
+		{
+			return ready(update_line(line, sample));
+		}
+
+		virtual std::future<async_result<score_sample>> last_score_async(const std::string& line)
+		{
+			async_result<score_sample> _result;
+			_result.errc = last_score(line, _result.value);
+
+			return ready(std::move(_result));
+		}
+
+		virtual std::future<async_result<score_samples_t>> last_scores_async(const std::vector<std::string>& lines)
+		{
+			async_result<score_samples_t> _result;
+			_result.errc = last_scores(lines, _result.value);
+
+			return ready(std::move(_result));
+		}
+
+		virtual std::future<async_result<std::vector<std::double_t>>> fetch_score_async(const std::string& line)
+		{
+			async_result<std::vector<std::double_t>> _result;
+			_result.errc = fetch_score(line, _result.value);
+
+			return ready(std::move(_result));
+		}
+
+		virtual std::future<async_result<std::vector<score_sample>>> fetch_score_async(const std::string& line, std::int64_t from, std::int64_t to)
+		{
+			async_result<std::vector<score_sample>> _result;
+			_result.errc = fetch_score(line, from, to, _result.value);
+
+			return ready(std::move(_result));
+		}
+
+		virtual void metrics(boost::property_tree::ptree& tree) const = 0;
+
+	protected:
+		template<typename T>
+		static std::future<T> ready(T&& value)
+		{
+			std::promise<T> _promise;
+			_promise.set_value(std::forward<T>(value));
+
+			return _promise.get_future();
+		}
+	};
+}
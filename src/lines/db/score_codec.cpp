@@ -0,0 +1,333 @@
+#include "score_codec.hpp"
+
+namespace rvision
+{
+	namespace detail
+	{
+		//delta-of-delta buckets: control prefix length, payload bits
+		struct dod_bucket
+		{
+			std::uint32_t prefix_bits;
+			std::uint64_t prefix;
+			std::uint32_t value_bits;
+		};
+
+		static const dod_bucket _dod_buckets[] =
+		{
+			{2, 0b10, 7},
+			{3, 0b110, 9},
+			{4, 0b1110, 12},
+			{4, 0b1111, 64}
+		};
+
+		static bool fits(std::int64_t value, std::uint32_t bits)
+		{
+			if (bits == 64)
+			{
+				return true;
+			}
+
+			const std::int64_t _min = -((std::int64_t(1) << (bits - 1)) - 1);
+			const std::int64_t _max = std::int64_t(1) << (bits - 1);
+
+			return value >= _min && value <= _max;
+		}
+
+		static std::uint64_t bias(std::int64_t value, std::uint32_t bits)
+		{
+			return bits == 64 ? static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value + ((std::int64_t(1) << (bits - 1)) - 1));
+		}
+
+		static std::int64_t unbias(std::uint64_t value, std::uint32_t bits)
+		{
+			return bits == 64 ? static_cast<std::int64_t>(value) : static_cast<std::int64_t>(value) - ((std::int64_t(1) << (bits - 1)) - 1);
+		}
+	}
+
+	score_codec::bit_writer::bit_writer(std::vector<std::uint8_t>& data)
+	: m_data(data), m_free(0)
+	{
+	}
+
+	void score_codec::bit_writer::write(std::uint64_t value, std::uint32_t bits)
+	{
+		while (bits != 0)
+		{
+			if (m_free == 0)
+			{
+				m_data.emplace_back(0);
+				m_free = 8;
+			}
+
+			auto _take = std::min(bits, m_free);
+			auto _chunk = static_cast<std::uint8_t>((value >> (bits - _take)) & ((1u << _take) - 1));
+
+			m_data.back() |= static_cast<std::uint8_t>(_chunk << (m_free - _take));
+
+			m_free -= _take;
+			bits -= _take;
+		}
+	}
+
+	void score_codec::bit_writer::write_bit(bool bit)
+	{
+		write(bit ? 1 : 0, 1);
+	}
+
+	score_codec::bit_reader::bit_reader(const std::uint8_t* data, std::size_t size)
+	: m_data(data), m_size(size), m_offset(0)
+	{
+	}
+
+	bool score_codec::bit_reader::read(std::uint32_t bits, std::uint64_t& value)
+	{
+		if (m_offset + bits > m_size * 8)
+		{
+			return false;
+		}
+
+		value = 0;
+
+		while (bits != 0)
+		{
+			auto _used = static_cast<std::uint32_t>(m_offset % 8);
+			auto _take = std::min(bits, 8 - _used);
+			auto _chunk = (m_data[m_offset / 8] >> (8 - _used - _take)) & ((1u << _take) - 1);
+
+			value = (value << _take) | _chunk;
+
+			m_offset += _take;
+			bits -= _take;
+		}
+
+		return true;
+	}
+
+	bool score_codec::bit_reader::read_bit(bool& bit)
+	{
+		std::uint64_t _value = 0;
+
+		if (!read(1, _value))
+		{
+			return false;
+		}
+
+		bit = _value != 0;
+
+		return true;
+	}
+
+	void score_codec::encode(const score_sample* samples, std::size_t count, std::vector<std::uint8_t>& block)
+	{
+		bit_writer _writer(block);
+
+		_writer.write(count, 32);
+
+		if (count == 0)
+		{
+			return;
+		}
+
+		std::int64_t _prev_ts = samples[0].ts;
+		std::int64_t _prev_delta = 0;
+		std::uint64_t _prev_value = std::bit_cast<std::uint64_t>(samples[0].score);
+		std::uint32_t _prev_leading = 64;
+		std::uint32_t _prev_trailing = 0;
+
+		_writer.write(static_cast<std::uint64_t>(_prev_ts), 64);
+		_writer.write(_prev_value, 64);
+
+		for (std::size_t i = 1; i < count; ++i)
+		{
+			auto _delta = samples[i].ts - _prev_ts;
+			auto _dod = _delta - _prev_delta;
+
+			if (_dod == 0)
+			{
+				_writer.write_bit(false);
+			}
+			else
+			{
+				for (const auto& b : detail::_dod_buckets)
+				{
+					if (detail::fits(_dod, b.value_bits))
+					{
+						_writer.write(b.prefix, b.prefix_bits);
+						_writer.write(detail::bias(_dod, b.value_bits), b.value_bits);
+						break;
+					}
+				}
+			}
+
+			_prev_ts = samples[i].ts;
+			_prev_delta = _delta;
+
+			auto _value = std::bit_cast<std::uint64_t>(samples[i].score);
+			auto _xor = _value ^ _prev_value;
+
+			if (_xor == 0)
+			{
+				_writer.write_bit(false);
+			}
+			else
+			{
+				auto _leading = std::min<std::uint32_t>(std::countl_zero(_xor), 31);
+				auto _trailing = static_cast<std::uint32_t>(std::countr_zero(_xor));
+
+				_writer.write_bit(true);
+
+				if (_prev_leading != 64 && _leading >= _prev_leading && _trailing >= _prev_trailing)
+				{
+					//meaningful bits fit into the previous window
+					_writer.write_bit(false);
+					_writer.write(_xor >> _prev_trailing, 64 - _prev_leading - _prev_trailing);
+				}
+				else
+				{
+					auto _meaningful = 64 - _leading - _trailing;
+
+					_writer.write_bit(true);
+					_writer.write(_leading, 5);
+					_writer.write(_meaningful - 1, 6);
+					_writer.write(_xor >> _trailing, _meaningful);
+
+					_prev_leading = _leading;
+					_prev_trailing = _trailing;
+				}
+			}
+
+			_prev_value = _value;
+		}
+	}
+
+	rvision::core::errc score_codec::decode(const std::uint8_t* block, std::size_t size, std::vector<score_sample>& samples)
+	{
+		bit_reader _reader(block, size);
+
+		std::uint64_t _count = 0;
+		if (!_reader.read(32, _count))
+		{
+			return rvision::core::errc::fail;
+		}
+
+		if (_count == 0)
+		{
+			return rvision::core::errc::success;
+		}
+
+		//every sample after the first takes two bits at least, a larger count is a corrupt header
+		if (_count - 1 > (size * 8) / 2)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		std::uint64_t _ts = 0;
+		std::uint64_t _value = 0;
+
+		if (!_reader.read(64, _ts) || !_reader.read(64, _value))
+		{
+			return rvision::core::errc::fail;
+		}
+
+		samples.reserve(samples.size() + _count);
+		samples.emplace_back(score_sample{static_cast<std::int64_t>(_ts), std::bit_cast<std::double_t>(_value)});
+
+		std::int64_t _prev_ts = static_cast<std::int64_t>(_ts);
+		std::int64_t _prev_delta = 0;
+		std::uint32_t _prev_leading = 0;
+		std::uint32_t _prev_trailing = 0;
+
+		for (std::uint64_t i = 1; i < _count; ++i)
+		{
+			std::int64_t _dod = 0;
+			bool _bit = false;
+
+			if (!_reader.read_bit(_bit))
+			{
+				return rvision::core::errc::fail;
+			}
+
+			if (_bit)
+			{
+				//prefix 1..1110 picks the bucket, four ones select the last one
+				std::size_t _bucket = 0;
+
+				while (_bucket < std::size(detail::_dod_buckets) - 1)
+				{
+					if (!_reader.read_bit(_bit))
+					{
+						return rvision::core::errc::fail;
+					}
+
+					if (!_bit)
+					{
+						break;
+					}
+
+					++_bucket;
+				}
+
+				std::uint64_t _payload = 0;
+				auto _bits = detail::_dod_buckets[_bucket].value_bits;
+
+				if (!_reader.read(_bits, _payload))
+				{
+					return rvision::core::errc::fail;
+				}
+
+				_dod = detail::unbias(_payload, _bits);
+			}
+
+			_prev_delta += _dod;
+			_prev_ts += _prev_delta;
+
+			if (!_reader.read_bit(_bit))
+			{
+				return rvision::core::errc::fail;
+			}
+
+			if (_bit)
+			{
+				bool _new_window = false;
+
+				if (!_reader.read_bit(_new_window))
+				{
+					return rvision::core::errc::fail;
+				}
+
+				if (_new_window)
+				{
+					std::uint64_t _leading = 0;
+					std::uint64_t _meaningful = 0;
+
+					if (!_reader.read(5, _leading) || !_reader.read(6, _meaningful))
+					{
+						return rvision::core::errc::fail;
+					}
+
+					//the window has to fit a 64-bit score, a wider one is a corrupt block
+					if (_leading + _meaningful + 1 > 64)
+					{
+						return rvision::core::errc::fail;
+					}
+
+					_prev_leading = static_cast<std::uint32_t>(_leading);
+					_prev_trailing = 64 - _prev_leading - static_cast<std::uint32_t>(_meaningful + 1);
+				}
+
+				std::uint64_t _xor = 0;
+
+				if (!_reader.read(64 - _prev_leading - _prev_trailing, _xor))
+				{
+					return rvision::core::errc::fail;
+				}
+
+				_value ^= _xor << _prev_trailing;
+			}
+
+			samples.emplace_back(score_sample{_prev_ts, std::bit_cast<std::double_t>(_value)});
+		}
+
+		return rvision::core::errc::success;
+	}
+}
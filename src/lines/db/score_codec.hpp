@@ -0,0 +1,43 @@
+#pragma once
+#include <core/headers.hpp>
+#include <lines/utils/score_sample.hpp>
+
+namespace rvision
+{
+	//gorilla-style block of consecutive samples of one line:
+	//timestamps as delta-of-delta with variable length buckets, scores as xor against the previous score.
+	//a line polled at a steady period with an unchanged score costs 2 bits per sample.
+	class score_codec
+	{
+		class bit_writer
+		{
+		public:
+			explicit bit_writer(std::vector<std::uint8_t>& data);
+
+			void write(std::uint64_t value, std::uint32_t bits);
+			void write_bit(bool bit);
+
+		private:
+			std::vector<std::uint8_t>& m_data;
+			std::uint32_t m_free;
+		};
+
+		class bit_reader
+		{
+		public:
+			bit_reader(const std::uint8_t* data, std::size_t size);
+
+			bool read(std::uint32_t bits, std::uint64_t& value);
+			bool read_bit(bool& bit);
+
+		private:
+			const std::uint8_t* m_data;
+			std::size_t m_size;
+			std::size_t m_offset;
+		};
+
+	public:
+		static void encode(const score_sample* samples, std::size_t count, std::vector<std::uint8_t>& block);
+		static rvision::core::errc decode(const std::uint8_t* block, std::size_t size, std::vector<score_sample>& samples);
+	};
+}
@@ -0,0 +1,286 @@
+#include "lines_parser.hpp"
+
+namespace rvision
+{
+	namespace detail
+	{
+		static const std::string_view _lines_member("lines");
+		static const std::uint32_t _max_depth = 64;
+	}
+
+	lines_parser::lines_parser(const std::vector<std::string>& sports)
+		: m_pos(nullptr), m_end(nullptr), m_depth(0)
+	{
+		m_fields.reserve(sports.size());
+
+		for (const auto& s : sports)
+		{
+			field _field;
+			_field.key = s;
+
+			std::transform(_field.key.begin(), _field.key.end(), _field.key.begin(), [](unsigned char c)
+			{
+				 return std::toupper(c);
+			});
+
+			m_fields.push_back(std::move(_field));
+		}
+
+		for (std::size_t i = 0; i < m_fields.size(); ++i)
+		{
+			m_index.emplace(m_fields[i].key, i);
+		}
+	}
+
+	bool lines_parser::parse(std::string_view body)
+	{
+		for (auto& f : m_fields)
+		{
+			f.value = 0.0;
+			f.found = false;
+		}
+
+		m_pos = body.data();
+		m_end = body.data() + body.size();
+		m_depth = 0;
+
+		if (!consume('{'))
+		{
+			return false;
+		}
+
+		if (consume('}'))
+		{
+			return true;
+		}
+
+		do
+		{
+			std::string_view _key;
+
+			if (!parse_string(_key) || !consume(':'))
+			{
+				return false;
+			}
+
+			if (_key == detail::_lines_member)
+			{
+				skip_spaces();
+
+				if (m_pos < m_end && *m_pos == '{')
+				{
+					if (!parse_lines())
+					{
+						return false;
+					}
+
+					continue;
+				}
+			}
+
+			if (!skip_value())
+			{
+				return false;
+			}
+		}
+		while (consume(','));
+
+		return consume('}');
+	}
+
+	bool lines_parser::parse_lines()
+	{
+		if (!consume('{'))
+		{
+			return false;
+		}
+
+		if (consume('}'))
+		{
+			return true;
+		}
+
+		do
+		{
+			std::string_view _key;
+
+			if (!parse_string(_key) || !consume(':'))
+			{
+				return false;
+			}
+
+			auto p = m_index.find(_key);
+
+			if (!parse_score(p != m_index.end() ? &m_fields[p->second] : nullptr))
+			{
+				return false;
+			}
+		}
+		while (consume(','));
+
+		return consume('}');
+	}
+
+	bool lines_parser::parse_score(field* target)
+	{
+		skip_spaces();
+
+		if (!target || m_pos >= m_end)
+		{
+			return skip_value();
+		}
+
+		std::string_view _number;
+
+		if (*m_pos == '"')
+		{
+			if (!parse_string(_number))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			auto _begin = m_pos;
+
+			if (!skip_value())
+			{
+				return false;
+			}
+
+			_number = std::string_view(_begin, m_pos - _begin);
+		}
+
+		std::double_t _value = 0.0;
+
+		auto [ptr, ec] = std::from_chars(_number.data(), _number.data() + _number.size(), _value);
+
+		//a value that is not a number is left out like a missing line
+		if (ec == std::errc() && ptr == _number.data() + _number.size())
+		{
+			target->value = _value;
+			target->found = true;
+		}
+
+		return true;
+	}
+
+	bool lines_parser::parse_string(std::string_view& value)
+	{
+		skip_spaces();
+
+		if (m_pos >= m_end || *m_pos != '"')
+		{
+			return false;
+		}
+
+		auto _begin = ++m_pos;
+
+		while (m_pos < m_end && *m_pos != '"')
+		{
+			//escaped characters are kept as they are, keys of the lines never need them
+			m_pos += (*m_pos == '\\') ? 2 : 1;
+		}
+
+		if (m_pos >= m_end)
+		{
+			return false;
+		}
+
+		value = std::string_view(_begin, m_pos - _begin);
+
+		++m_pos;
+
+		return true;
+	}
+
+	bool lines_parser::skip_value()
+	{
+		skip_spaces();
+
+		if (m_pos >= m_end)
+		{
+			return false;
+		}
+
+		if (*m_pos == '"')
+		{
+			std::string_view _value;
+
+			return parse_string(_value);
+		}
+
+		if (*m_pos == '{' || *m_pos == '[')
+		{
+			if (++m_depth > detail::_max_depth)
+			{
+				return false;
+			}
+
+			const char _close = (*m_pos == '{') ? '}' : ']';
+			const bool _object = (*m_pos == '{');
+
+			++m_pos;
+
+			if (!consume(_close))
+			{
+				do
+				{
+					std::string_view _key;
+
+					if (_object && (!parse_string(_key) || !consume(':')))
+					{
+						return false;
+					}
+
+					if (!skip_value())
+					{
+						return false;
+					}
+				}
+				while (consume(','));
+
+				if (!consume(_close))
+				{
+					return false;
+				}
+			}
+
+			--m_depth;
+
+			return true;
+		}
+
+		//numbers and literals run up to the next delimiter
+		auto _begin = m_pos;
+
+		while (m_pos < m_end && *m_pos != ',' && *m_pos != '}' && *m_pos != ']' && !std::isspace(static_cast<unsigned char>(*m_pos)))
+		{
+			++m_pos;
+		}
+
+		return m_pos != _begin;
+	}
+
+	void lines_parser::skip_spaces()
+	{
+		while (m_pos < m_end && std::isspace(static_cast<unsigned char>(*m_pos)))
+		{
+			++m_pos;
+		}
+	}
+
+	bool lines_parser::consume(char c)
+	{
+		skip_spaces();
+
+		if (m_pos < m_end && *m_pos == c)
+		{
+			++m_pos;
+
+			return true;
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <core/headers.hpp>
+
+namespace rvision
+{
+	//single pass extractor of the lines.<SPORT> scores of a poll responce, works on the body in place without building a document.
+	//scores may be json numbers or numeric strings, any other member is skipped
+	class lines_parser
+	{
+		struct field
+		{
+			std::string key;
+			std::double_t value = 0.0;
+			bool found = false;
+		};
+
+	public:
+		explicit lines_parser(const std::vector<std::string>& sports);
+
+		//false on a malformed body, fields found before the error keep their values
+		bool parse(std::string_view body);
+
+		std::size_t size() const { return m_fields.size(); }
+		bool found(std::size_t i) const { return m_fields[i].found; }
+		std::double_t value(std::size_t i) const { return m_fields[i].value; }
+
+	private:
+		bool parse_lines();
+		bool parse_score(field* target);
+		bool parse_string(std::string_view& value);
+		bool skip_value();
+		void skip_spaces();
+		bool consume(char c);
+
+	private:
+		//keys are uppercased once, the index points into m_fields
+		std::vector<field> m_fields;
+		std::unordered_map<std::string_view, std::size_t> m_index;
+		const char* m_pos;
+		const char* m_end;
+		std::uint32_t m_depth;
+	};
+}
@@ -2,86 +2,258 @@
 
 namespace rvision
 {
-	lines_poller::lines_poller(std::shared_ptr<rvision::core::logger> logger, const std::string& address, const std::string& sport, const std::chrono::seconds& period, const poll_callback& cb)
-	:m_logger(logger), m_address(address), m_sport(sport), m_period(period), m_poll_callback(cb)
+	namespace detail
 	{
-		m_logger->info("lines_poller::lines_poller => address: {}", m_address);
+		//weight of the latest poll in the change rate, about the last 10 polls count
+		static const std::double_t _change_rate_weight = 0.1;
+	}
+
+	lines_poller::lines_poller(std::shared_ptr<rvision::core::logger> logger, lines_scheduler& scheduler, upstream_client& upstream, const std::string& address, const std::string& sport, const std::chrono::seconds& period,
+		const lines_poller_config& config, const poll_callback& cb)
+	:lines_poller(logger, scheduler, upstream, address, std::vector<std::string>{sport}, period, config, cb)
+	{
+	}
+
+	lines_poller::lines_poller(std::shared_ptr<rvision::core::logger> logger, lines_scheduler& scheduler, upstream_client& upstream, const std::string& address, const std::vector<std::string>& sports, const std::chrono::seconds& period,
+		const lines_poller_config& config, const poll_callback& cb)
+	:m_scheduler(scheduler), m_upstream(upstream), m_uri(address), m_id(0), m_poll_callback(cb), m_sports(sports), m_parser(std::make_unique<lines_parser>(sports)), m_address(address), m_config(config),
+	 m_period(std::chrono::duration_cast<std::chrono::milliseconds>(period)), m_last_scores(sports.size(), 0.0), m_change_rates(sports.size(), 0.0), m_polled(sports.size(), false),
+	 m_confirmed_ts(sports.size(), 0), m_skipped(sports.size(), 0), m_logger(logger)
+	{
+		if (m_config._adaptive)
+		{
+			m_config._max_period = std::max(m_config._min_period, m_config._max_period);
+			m_period = std::clamp(m_period, m_config._min_period, m_config._max_period);
+		}
+
+		m_logger->info("lines_poller::lines_poller => address: {}, period: {} ms{}", m_address, m_period.count(), m_config._adaptive ? " (adaptive)" : "");
 
-		m_thread = std::jthread([&] (std::stop_token stoken)
+		m_id = m_scheduler.add(m_period, [this]()
 		{
-			while(!stoken.stop_requested())
+			poll();
+		});
+	}
+	
+	lines_poller::~lines_poller()
+	{
+		m_logger->info("lines_poller::~lines_poller => removing {} from the scheduler...", m_address);
+		
+		m_scheduler.rem(m_id);
+		
+		m_logger->info("lines_poller::~lines_poller => {} has been removed.", m_address);
+	}
+	
+	void lines_poller::set_lines(const std::string& address, const std::vector<std::string>& sports)
+	{
+		std::unique_lock<std::mutex> poll_lock(m_poll_lock);
+
+		std::vector<std::double_t> _last_scores(sports.size(), 0.0);
+		std::vector<std::double_t> _change_rates(sports.size(), 0.0);
+		std::vector<bool> _polled(sports.size(), false);
+		std::vector<std::int64_t> _confirmed_ts(sports.size(), 0);
+		std::vector<std::uint64_t> _skipped(sports.size(), 0);
+
+		bool _joined = false;
+
+		{
+			std::unique_lock<std::mutex> lock(m_stats_lock);
+
+			for (std::size_t i = 0; i < sports.size(); ++i)
 			{
-				std::unique_lock<std::mutex> locker(m_lock);
+				auto p = std::find(m_sports.begin(), m_sports.end(), sports[i]);
 
-				auto waiter = m_wait.wait_for(locker, m_period);
-				
-				if (stoken.stop_requested())
+				if (p == m_sports.end())
 				{
-					m_logger->debug("lines_poller::lines_poller::thread => break!");
-					break;
+					_joined = true;
+
+					continue;
 				}
 
-				poll();
+				auto _old = static_cast<std::size_t>(p - m_sports.begin());
+
+				_last_scores[i] = m_last_scores[_old];
+				_change_rates[i] = m_change_rates[_old];
+				_polled[i] = m_polled[_old];
+				_confirmed_ts[i] = m_confirmed_ts[_old];
+				_skipped[i] = m_skipped[_old];
 			}
-		});	
 
+			m_sports = sports;
+			m_last_scores.swap(_last_scores);
+			m_change_rates.swap(_change_rates);
+			m_polled.swap(_polled);
+			m_confirmed_ts.swap(_confirmed_ts);
+			m_skipped.swap(_skipped);
+		}
+
+		//a not modified responce would leave a joined line without its first score, the validators are dropped then
+		if (_joined)
+		{
+			m_etag.clear();
+			m_last_modified.clear();
+		}
+
+		m_parser = std::make_unique<lines_parser>(sports);
+		m_uri = Poco::URI(address);
+
+		m_logger->info("lines_poller::set_lines => address: {} -> {}", m_address, address);
+
+		m_address = address;
 	}
-	
-	lines_poller::~lines_poller()
+
+	void lines_poller::confirm()
 	{
-		m_thread.request_stop();
-		
-		m_logger->info("lines_poller::~lines_poller => stopping main thread...");
-		
-		m_thread.join();
-		
-		m_logger->info("lines_poller::~lines_poller => main thread has been stopped.");
+		m_logger->debug("lines_poller::poll => {} not modified", m_address);
+
+		{
+			std::unique_lock<std::mutex> lock(m_stats_lock);
+
+			auto _now = score_now();
 
+			for (std::size_t i = 0; i < m_sports.size(); ++i)
+			{
+				m_change_rates[i] -= detail::_change_rate_weight * m_change_rates[i];
+				m_confirmed_ts[i] = _now;
+				++m_skipped[i];
+			}
+		}
+
+		adapt(false);
 	}
-	
+
+	void lines_poller::adapt(bool changed)
+	{
+		if (!m_config._adaptive)
+		{
+			return;
+		}
+
+		std::chrono::milliseconds _period;
+
+		{
+			std::unique_lock<std::mutex> lock(m_stats_lock);
+
+			//a moving line is caught up quickly, a static one backs off gradually
+			auto _next = changed ? m_period / 2 : m_period + m_period / 4;
+
+			_period = m_period = std::clamp(_next, m_config._min_period, m_config._max_period);
+		}
+
+		m_scheduler.set_period(m_id, _period);
+	}
+
+	void lines_poller::metrics(boost::property_tree::ptree& tree, const std::string& path) const
+	{
+		std::unique_lock<std::mutex> lock(m_stats_lock);
+
+		auto _now = score_now();
+
+		for (std::size_t i = 0; i < m_sports.size(); ++i)
+		{
+			auto& _line = tree.put_child(boost::property_tree::ptree::path_type(path + m_sports[i], '/'), boost::property_tree::ptree());
+
+			_line.put("period_ms", m_period.count());
+			_line.put("change_rate", m_change_rates[i]);
+			_line.put("confirmed_age_ms", m_confirmed_ts[i] ? _now - m_confirmed_ts[i] : -1);
+			_line.put("skipped_writes", m_skipped[i]);
+
+			//the lines of a batch share one deadline
+			m_scheduler.metrics(m_id.load(), _line);
+		}
+	}
+
 	void lines_poller::poll() try
 	{
-		Poco::URI uri(m_address);
-		
-		m_logger->debug("lines_poller::poll => address: {}, host: {}, port: {}", m_address, uri.getHost(), uri.getPort());
+		std::unique_lock<std::mutex> poll_lock(m_poll_lock);
 
-		Poco::Net::HTTPClientSession session(uri.getHost(), uri.getPort());
+		m_logger->debug("lines_poller::poll => address: {}, host: {}, port: {}", m_address, m_uri.getHost(), m_uri.getPort());
 
-		session.setKeepAlive(true);
-		session.setKeepAliveTimeout(Poco::Timespan(60, 0));
-		session.setTimeout(Poco::Timespan(60, 0));
-		
-		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, uri.getPath(), Poco::Net::HTTPMessage::HTTP_1_1);
+		static const std::string _none;
 
-		session.sendRequest(request);
-				
-		Poco::Net::HTTPResponse responce;				
-		std::istream& responce_ss = session.receiveResponse(responce);
-		
-		if (responce.getStatus() == Poco::Net::HTTPResponse::HTTPStatus::HTTP_OK)
+		auto errc = m_upstream.get(m_uri, m_config._conditional ? m_etag : _none, m_config._conditional ? m_last_modified : _none, m_response);
+
+		if (errc == rvision::core::errc::insufficient_resources)
 		{
-			auto _sport = m_sport;
-			std::transform(_sport.begin(), _sport.end(), _sport.begin(), [](unsigned char c)
-			{
-				 return std::toupper(c);
-			});
-			
-			Poco::Util::JSONConfiguration responce_data(responce_ss);
+			m_logger->debug("lines_poller::poll => circuit of {} is open, poll skipped", m_address);
 
-			std::string property("lines.");
-			property += _sport;
-	
-			auto score = responce_data.getDouble(property, 0.0);
+			return;
+		}
+
+		if (errc != rvision::core::errc::success)
+		{
+			return;
+		}
+
+		auto _status = m_response.status;
+
+		if (m_config._conditional && _status == Poco::Net::HTTPResponse::HTTPStatus::HTTP_OK)
+		{
+			m_etag = m_response.etag;
+			m_last_modified = m_response.last_modified;
+		}
+
+		if (_status == Poco::Net::HTTPResponse::HTTPStatus::HTTP_NOT_MODIFIED)
+		{
+			confirm();
+
+			return;
+		}
+
+		if (_status != Poco::Net::HTTPResponse::HTTPStatus::HTTP_OK)
+		{
+			m_logger->error("lines_poller::poll => responce status: {}", _status);
 
-			m_logger->debug("lines_poller::poll => property: {}, score: {}", property, score);
+			return;
+		}
+
+		if (!m_parser->parse(m_response.body))
+		{
+			m_logger->error("lines_poller::poll => malformed responce of {}", m_address);
 
-			m_poll_callback(m_sport, score);
+			return;
 		}
-		else
+
+		bool _changed = false;
+
+		for (std::size_t i = 0; i < m_parser->size(); ++i)
 		{
-			m_logger->error("lines_poller::poll => responce status: {}", responce.getStatus());
+			//a group response may leave out lines the upstream does not know, they are not reported as zero
+			if (m_sports.size() > 1 && !m_parser->found(i))
+			{
+				m_logger->error("lines_poller::poll => line: {} is missing in the responce of {}", m_sports[i], m_address);
+
+				continue;
+			}
+
+			auto _score = m_parser->value(i);
+			bool _report = true;
+
+			{
+				std::unique_lock<std::mutex> lock(m_stats_lock);
+
+				bool _line_changed = m_polled[i] && _score != m_last_scores[i];
+
+				//the first score of a line is always reported, later ones only when they differ
+				_report = !m_config._conditional || !m_polled[i] || _line_changed;
+
+				m_change_rates[i] += detail::_change_rate_weight * ((_line_changed ? 1.0 : 0.0) - m_change_rates[i]);
+				m_last_scores[i] = _score;
+				m_polled[i] = true;
+				m_confirmed_ts[i] = score_now();
+				m_skipped[i] += _report ? 0 : 1;
+
+				_changed = _changed || _line_changed;
+			}
+
+			m_logger->debug("lines_poller::poll => line: {}, score: {}{}", m_sports[i], _score, _report ? "" : " (unchanged)");
+
+			if (_report)
+			{
+				m_poll_callback(m_sports[i], _score);
+			}
 		}
 
+		adapt(_changed);
 	}
 	catch (const std::exception& e)
 	{
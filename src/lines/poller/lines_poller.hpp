@@ -1,30 +1,74 @@
 #pragma once
 #include <core/headers.hpp>
 #include <core/logger.hpp>
+#include <lines/poller/lines_scheduler.hpp>
+#include <lines/poller/upstream_client.hpp>
+#include <lines/poller/lines_parser.hpp>
+#include <lines/utils/score_sample.hpp>
 
 namespace rvision
 {
 	using poll_callback = std::function<void(const std::string& sport, std::double_t score)>;
+
+	struct lines_poller_config
+	{
+		//the period halves after a poll that changed a score and grows by a quarter after one that did not
+		bool _adaptive = false;
+		std::chrono::milliseconds _min_period = std::chrono::milliseconds(1000);
+		std::chrono::milliseconds _max_period = std::chrono::milliseconds(60000);
+		//If-None-Match/If-Modified-Since requests, unchanged scores only confirm the line instead of being reported
+		bool _conditional = true;
+	};
 	
+	//registration of one line, or of a group of lines fetched by one request, in the shared scheduler, polls run on its workers
 	class lines_poller
 	{
-		using time_point_t = std::chrono::steady_clock::time_point;
-
 	public:
-		lines_poller(std::shared_ptr<rvision::core::logger> logger, const std::string& address, const std::string& sport, const std::chrono::seconds& period, const poll_callback& cb);
+		lines_poller(std::shared_ptr<rvision::core::logger> logger, lines_scheduler& scheduler, upstream_client& upstream, const std::string& address, const std::string& sport, const std::chrono::seconds& period,
+			const lines_poller_config& config, const poll_callback& cb);
+		lines_poller(std::shared_ptr<rvision::core::logger> logger, lines_scheduler& scheduler, upstream_client& upstream, const std::string& address, const std::vector<std::string>& sports, const std::chrono::seconds& period,
+			const lines_poller_config& config, const poll_callback& cb);
 		~lines_poller();
 
+		//a group poller takes a new request and set of lines in place, its period and grid are kept,
+		//as is what it knows of the lines staying in the group
+		void set_lines(const std::string& address, const std::vector<std::string>& sports);
+
+		//current period, score change rate, scheduling lag and interval of each line
+		void metrics(boost::property_tree::ptree& tree, const std::string& path) const;
+
 	private:
 		void poll();
+		void confirm();
+		void adapt(bool changed);
 
 	private:
-		std::jthread m_thread;
-		std::mutex m_lock;
-		std::condition_variable m_wait;
+		lines_scheduler& m_scheduler;
+		upstream_client& m_upstream;
+		Poco::URI m_uri;
+		//set once the scheduler returns it, the first poll may already be running on a worker
+		std::atomic<lines_scheduler::id_t> m_id;
 		poll_callback m_poll_callback;
-		std::string m_sport;
+		//held by a poll, set_lines waits for the one in flight
+		std::mutex m_poll_lock;
+		std::vector<std::string> m_sports;
+		//the scheduler never overlaps polls of one poller, the body buffer is reused by each of them
+		upstream_response m_response;
+		std::unique_ptr<lines_parser> m_parser;
 		std::string m_address;
-		std::chrono::seconds m_period;
+		lines_poller_config m_config;
+		//validators of the last 200 responce
+		std::string m_etag;
+		std::string m_last_modified;
+		mutable std::mutex m_stats_lock;
+		std::chrono::milliseconds m_period;
+		std::vector<std::double_t> m_last_scores;
+		//exponential moving average of the polls that changed the score of the line
+		std::vector<std::double_t> m_change_rates;
+		std::vector<bool> m_polled;
+		//last poll that saw the line, changed or not
+		std::vector<std::int64_t> m_confirmed_ts;
+		std::vector<std::uint64_t> m_skipped;
 		std::shared_ptr<rvision::core::logger> m_logger;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "lines_scheduler.hpp"
+
+namespace rvision
+{
+	lines_scheduler::lines_scheduler(std::shared_ptr<rvision::core::logger> logger, std::uint32_t workers, std::double_t jitter, overrun_policy overrun)
+		: m_logger(logger), m_next_id(0), m_jitter(std::clamp(jitter, 0.0, 0.5)), m_overrun(overrun), m_random(std::random_device{}()), m_runs(0), m_overlaps(0), m_missed(0), m_workers(workers)
+	{
+		m_logger->info("lines_scheduler::lines_scheduler => workers: {}, jitter: {}, catch up: {}", workers, m_jitter, m_overrun == overrun_policy::catch_up);
+
+		m_thread = std::jthread([this](std::stop_token stoken)
+		{
+			run(stoken);
+		});
+	}
+
+	lines_scheduler::~lines_scheduler()
+	{
+		m_thread.request_stop();
+		m_thread.join();
+
+		m_logger->debug("lines_scheduler::~lines_scheduler().");
+	}
+
+	lines_scheduler::id_t lines_scheduler::add(const std::chrono::milliseconds& period, const task_t& task)
+	{
+		auto _item = std::make_shared<entry>();
+		_item->period = std::max(period, std::chrono::milliseconds(1));
+		_item->task = task;
+
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			_item->id = ++m_next_id;
+
+			m_entries.emplace(_item->id, _item);
+			m_deadlines.push(deadline{std::chrono::steady_clock::now() + jittered(_item->period), _item->id});
+		}
+
+		m_wait.notify_one();
+
+		return _item->id;
+	}
+
+	void lines_scheduler::rem(id_t id)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		auto p = m_entries.find(id);
+		if (p == m_entries.end())
+		{
+			return;
+		}
+
+		auto _item = p->second;
+
+		//its deadline stays in the heap and is dropped when it comes up
+		_item->active = false;
+		m_entries.erase(p);
+
+		m_idle.wait(lock, [&_item] { return !_item->in_flight; });
+	}
+
+	void lines_scheduler::set_period(id_t id, const std::chrono::milliseconds& period)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		if (auto p = m_entries.find(id); p != m_entries.end())
+		{
+			p->second->period = std::max(period, std::chrono::milliseconds(1));
+		}
+	}
+
+	std::chrono::steady_clock::duration lines_scheduler::jittered(const std::chrono::milliseconds& period)
+	{
+		if (m_jitter <= 0.0)
+		{
+			return period;
+		}
+
+		std::uniform_real_distribution<std::double_t> _offset(-m_jitter, m_jitter);
+
+		return std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * (1.0 + _offset(m_random)));
+	}
+
+	void lines_scheduler::run(std::stop_token stoken)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		while (!stoken.stop_requested())
+		{
+			if (m_deadlines.empty())
+			{
+				m_wait.wait(lock, stoken, [this] { return !m_deadlines.empty(); });
+
+				continue;
+			}
+
+			auto _at = m_deadlines.top().at;
+
+			//an entry added with an earlier deadline wakes the timer up
+			if (m_wait.wait_until(lock, stoken, _at, [this, _at] { return m_deadlines.top().at < _at; }) || stoken.stop_requested())
+			{
+				continue;
+			}
+
+			auto _now = std::chrono::steady_clock::now();
+
+			while (!m_deadlines.empty() && m_deadlines.top().at <= _now)
+			{
+				auto _due = m_deadlines.top();
+				m_deadlines.pop();
+
+				auto p = m_entries.find(_due.id);
+				if (p == m_entries.end())
+				{
+					continue;
+				}
+
+				auto _item = p->second;
+				auto _period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(_item->period);
+
+				//the next deadline is the previous one plus the period, never the end of the run, so the latency does not add up;
+				//deadlines a stalled timer passed are folded into this run instead of firing a burst
+				auto _next = _due.at + _period;
+				if (_next <= _now)
+				{
+					auto _passed = (_now - _due.at) / _period;
+
+					_next = _due.at + (_passed + 1) * _period;
+
+					missed(*_item, _passed);
+				}
+
+				m_deadlines.push(deadline{_next, _due.id});
+
+				//a poll slower than its period never queues up behind itself, catch_up owes the line one run right after it
+				if (_item->in_flight)
+				{
+					m_overlaps.fetch_add(1, std::memory_order_relaxed);
+
+					if (m_overrun == overrun_policy::catch_up && !_item->pending)
+					{
+						_item->pending = true;
+						_item->pending_at = _due.at;
+					}
+					else
+					{
+						missed(*_item, 1);
+					}
+
+					continue;
+				}
+
+				_item->in_flight = true;
+
+				m_workers.submit([this, _item, _at = _due.at]()
+				{
+					execute(_item, _at);
+				});
+			}
+		}
+	}
+
+	void lines_scheduler::missed(entry& item, std::uint64_t count)
+	{
+		item.missed.fetch_add(count, std::memory_order_relaxed);
+		m_missed.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void lines_scheduler::execute(std::shared_ptr<entry> item, time_point_t at)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		//a run owed by catch_up follows on the same worker
+		while (item->active)
+		{
+			auto _start = std::chrono::steady_clock::now();
+			auto _last = item->last_start;
+
+			item->last_start = _start;
+
+			lock.unlock();
+
+			m_lag.record(_start - at);
+			item->lag.record(_start - at);
+
+			if (_last != time_point_t())
+			{
+				item->interval.record(_start - _last);
+			}
+
+			item->task();
+
+			m_latency.record(std::chrono::steady_clock::now() - _start);
+			m_runs.fetch_add(1, std::memory_order_relaxed);
+
+			lock.lock();
+
+			if (!item->pending)
+			{
+				break;
+			}
+
+			item->pending = false;
+			at = item->pending_at;
+		}
+
+		item->pending = false;
+		item->in_flight = false;
+
+		lock.unlock();
+
+		m_idle.notify_all();
+	}
+
+	void lines_scheduler::metrics(boost::property_tree::ptree& tree, const std::string& path) const
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			tree.put(path + ".lines", m_entries.size());
+			tree.put(path + ".deadlines", m_deadlines.size());
+		}
+
+		tree.put(path + ".runs", m_runs.load(std::memory_order_relaxed));
+		tree.put(path + ".overlaps", m_overlaps.load(std::memory_order_relaxed));
+		tree.put(path + ".missed", m_missed.load(std::memory_order_relaxed));
+
+		rvision::core::put_histogram(tree, path + ".lag_us", m_lag);
+		rvision::core::put_histogram(tree, path + ".poll_latency_us", m_latency);
+
+		m_workers.metrics(tree, path + ".workers");
+	}
+
+	void lines_scheduler::metrics(id_t id, boost::property_tree::ptree& tree) const
+	{
+		std::shared_ptr<entry> _item;
+
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			if (auto p = m_entries.find(id); p != m_entries.end())
+			{
+				_item = p->second;
+			}
+		}
+
+		if (!_item)
+		{
+			return;
+		}
+
+		tree.put("missed", _item->missed.load(std::memory_order_relaxed));
+
+		rvision::core::put_histogram(tree, "lag_us", _item->lag);
+		rvision::core::put_histogram(tree, "interval_us", _item->interval);
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <core/headers.hpp>
+#include <core/logger.hpp>
+#include <core/histogram.hpp>
+#include <core/executor.hpp>
+
+namespace rvision
+{
+	//what happens to a run whose deadline passed while the previous run of the line was still going or the timer was held up
+	enum class overrun_policy
+	{
+		//dropped, the line runs again at its next deadline
+		skip = 0,
+		//run once as soon as possible, however many deadlines were missed
+		catch_up = 1
+	};
+
+	//one timer thread keeps a min-heap of poll deadlines and hands due polls to a fixed worker pool,
+	//the thread count does not grow with the lines
+	class lines_scheduler
+	{
+	public:
+		using id_t = std::uint64_t;
+		using task_t = std::function<void()>;
+
+	private:
+		using time_point_t = std::chrono::steady_clock::time_point;
+
+		struct entry
+		{
+			id_t id = 0;
+			std::chrono::milliseconds period;
+			task_t task;
+			bool active = true;
+			bool in_flight = false;
+			//catch_up run owed for a deadline that came while in flight
+			bool pending = false;
+			time_point_t pending_at;
+			time_point_t last_start;
+			std::atomic<std::uint64_t> missed{0};
+			//start - deadline and start - previous start of the runs of the line
+			rvision::core::histogram lag;
+			rvision::core::histogram interval;
+		};
+
+		struct deadline
+		{
+			time_point_t at;
+			id_t id = 0;
+
+			bool operator>(const deadline& other) const
+			{
+				return at > other.at;
+			}
+		};
+
+	public:
+		//deadlines are absolute, a line keeps to the grid of its first deadline and the latency of its runs does not add up,
+		//jitter - the first deadline is moved by up to +-jitter (at most 0.5) of the period so the lines do not poll in lockstep
+		lines_scheduler(std::shared_ptr<rvision::core::logger> logger, std::uint32_t workers, std::double_t jitter = 0.0, overrun_policy overrun = overrun_policy::skip);
+		~lines_scheduler();
+
+		//first run one period from now
+		id_t add(const std::chrono::milliseconds& period, const task_t& task);
+		//returns once a running task of the entry has finished, it is never started again
+		void rem(id_t id);
+		//applies from the next deadline on, may be called from the task itself
+		void set_period(id_t id, const std::chrono::milliseconds& period);
+
+		void metrics(boost::property_tree::ptree& tree, const std::string& path) const;
+		//lag_us, interval_us and missed of one entry
+		void metrics(id_t id, boost::property_tree::ptree& tree) const;
+
+	private:
+		void run(std::stop_token stoken);
+		void missed(entry& item, std::uint64_t count);
+		void execute(std::shared_ptr<entry> item, time_point_t at);
+		std::chrono::steady_clock::duration jittered(const std::chrono::milliseconds& period);
+
+	private:
+		std::shared_ptr<rvision::core::logger> m_logger;
+		mutable std::mutex m_lock;
+		std::condition_variable_any m_wait;
+		std::condition_variable_any m_idle;
+		std::priority_queue<deadline, std::vector<deadline>, std::greater<deadline>> m_deadlines;
+		std::unordered_map<id_t, std::shared_ptr<entry>> m_entries;
+		id_t m_next_id;
+		std::double_t m_jitter;
+		overrun_policy m_overrun;
+		std::minstd_rand m_random;
+		std::atomic<std::uint64_t> m_runs;
+		std::atomic<std::uint64_t> m_overlaps;
+		std::atomic<std::uint64_t> m_missed;
+		rvision::core::histogram m_lag;
+		rvision::core::histogram m_latency;
+		rvision::core::executor m_workers;
+		std::jthread m_thread;
+	};
+}
@@ -0,0 +1,145 @@
+#include "session_pool.hpp"
+
+namespace rvision
+{
+	session_pool::lease::lease(session_pool& pool, const std::string& key, session_ptr session, bool reused)
+		: m_pool(&pool), m_key(key), m_session(std::move(session)), m_reused(reused)
+	{
+	}
+
+	session_pool::lease::lease(lease&& other) noexcept
+		: m_pool(other.m_pool), m_key(std::move(other.m_key)), m_session(std::move(other.m_session)), m_reused(other.m_reused)
+	{
+		other.m_pool = nullptr;
+	}
+
+	session_pool::lease::~lease()
+	{
+		if (m_pool)
+		{
+			m_pool->release(m_key, std::move(m_session));
+		}
+	}
+
+	void session_pool::lease::reconnect()
+	{
+		//the next request opens a new connection on the same session
+		m_session->reset();
+		m_reused = false;
+
+		m_pool->m_reconnects.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void session_pool::lease::drop()
+	{
+		m_session->reset();
+		m_session.reset();
+	}
+
+	session_pool::session_pool(std::shared_ptr<rvision::core::logger> logger, std::uint32_t size, const std::chrono::milliseconds& timeout)
+		: m_logger(logger), m_size(std::max<std::uint32_t>(size, 1)), m_timeout(timeout), m_created(0), m_reused(0), m_reconnects(0), m_waits(0), m_timeouts(0)
+	{
+		m_logger->info("session_pool::session_pool => sessions per upstream: {}", m_size);
+	}
+
+	session_pool::~session_pool()
+	{
+		m_logger->debug("session_pool::~session_pool().");
+	}
+
+	session_pool::lease session_pool::acquire(const Poco::URI& uri)
+	{
+		auto _key = uri.getHost() + ":" + std::to_string(uri.getPort());
+
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		auto& _upstream = m_upstreams[_key];
+
+		if (_upstream.idle.empty() && _upstream.sessions >= m_size)
+		{
+			m_waits.fetch_add(1, std::memory_order_relaxed);
+
+			if (!_upstream.wait.wait_for(lock, m_timeout, [&_upstream, this] { return !_upstream.idle.empty() || _upstream.sessions < m_size; }))
+			{
+				m_timeouts.fetch_add(1, std::memory_order_relaxed);
+
+				m_logger->error("session_pool::acquire => no session to {} within {} ms", _key, m_timeout.count());
+
+				throw no_session();
+			}
+		}
+
+		if (!_upstream.idle.empty())
+		{
+			auto _session = std::move(_upstream.idle.back());
+			_upstream.idle.pop_back();
+
+			m_reused.fetch_add(1, std::memory_order_relaxed);
+
+			return lease(*this, _key, std::move(_session), true);
+		}
+
+		++_upstream.sessions;
+
+		lock.unlock();
+
+		auto _session = std::make_unique<Poco::Net::HTTPClientSession>(uri.getHost(), uri.getPort());
+
+		_session->setKeepAlive(true);
+		_session->setKeepAliveTimeout(Poco::Timespan(std::chrono::duration_cast<std::chrono::microseconds>(m_timeout).count()));
+		_session->setTimeout(Poco::Timespan(std::chrono::duration_cast<std::chrono::microseconds>(m_timeout).count()));
+
+		m_created.fetch_add(1, std::memory_order_relaxed);
+
+		m_logger->debug("session_pool::acquire => new session to {}", _key);
+
+		return lease(*this, _key, std::move(_session), false);
+	}
+
+	void session_pool::release(const std::string& key, session_ptr session)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		auto& _upstream = m_upstreams[key];
+
+		if (session)
+		{
+			_upstream.idle.push_back(std::move(session));
+		}
+		else
+		{
+			--_upstream.sessions;
+		}
+
+		//the upstreams are never erased, the condition outlives the lock
+		lock.unlock();
+
+		_upstream.wait.notify_one();
+	}
+
+	void session_pool::metrics(boost::property_tree::ptree& tree, const std::string& path) const
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			std::size_t _sessions = 0;
+			std::size_t _idle = 0;
+
+			for (const auto& [key, item] : m_upstreams)
+			{
+				_sessions += item.sessions;
+				_idle += item.idle.size();
+			}
+
+			tree.put(path + ".upstreams", m_upstreams.size());
+			tree.put(path + ".sessions", _sessions);
+			tree.put(path + ".idle", _idle);
+		}
+
+		tree.put(path + ".created", m_created.load(std::memory_order_relaxed));
+		tree.put(path + ".reused", m_reused.load(std::memory_order_relaxed));
+		tree.put(path + ".reconnects", m_reconnects.load(std::memory_order_relaxed));
+		tree.put(path + ".waits", m_waits.load(std::memory_order_relaxed));
+		tree.put(path + ".timeouts", m_timeouts.load(std::memory_order_relaxed));
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <core/headers.hpp>
+#include <core/logger.hpp>
+
+namespace rvision
+{
+	//persistent keep-alive sessions per upstream host:port, borrowed for one request and returned
+	class session_pool
+	{
+		using session_ptr = std::unique_ptr<Poco::Net::HTTPClientSession>;
+
+		struct upstream
+		{
+			std::vector<session_ptr> idle;
+			std::uint32_t sessions = 0;
+			//only the waiters of this upstream are woken by a returned session
+			std::condition_variable wait;
+		};
+
+	public:
+		//returns the session to its upstream when it goes out of scope, a dropped one is closed instead
+		class lease
+		{
+		public:
+			lease(session_pool& pool, const std::string& key, session_ptr session, bool reused);
+			lease(lease&& other) noexcept;
+			~lease();
+
+			lease(const lease&) = delete;
+			lease& operator=(const lease&) = delete;
+
+			Poco::Net::HTTPClientSession& session() { return *m_session; }
+			//true when the connection was already used by an earlier request and may have been closed by the server
+			bool reused() const { return m_reused; }
+			void reconnect();
+			void drop();
+
+		private:
+			session_pool* m_pool;
+			std::string m_key;
+			session_ptr m_session;
+			bool m_reused;
+		};
+
+	public:
+		//no session of the upstream came back within the timeout
+		struct no_session : public std::exception
+		{
+			const char* what() const noexcept override
+			{
+				return "session_pool: no session within timeout";
+			}
+		};
+
+	public:
+		session_pool(std::shared_ptr<rvision::core::logger> logger, std::uint32_t size, const std::chrono::milliseconds& timeout);
+		~session_pool();
+
+		//blocks while all sessions of the upstream are leased, throws no_session after the timeout
+		lease acquire(const Poco::URI& uri);
+
+		void metrics(boost::property_tree::ptree& tree, const std::string& path) const;
+
+	private:
+		void release(const std::string& key, session_ptr session);
+
+	private:
+		std::shared_ptr<rvision::core::logger> m_logger;
+		std::uint32_t m_size;
+		std::chrono::milliseconds m_timeout;
+		mutable std::mutex m_lock;
+		std::unordered_map<std::string, upstream> m_upstreams;
+		std::atomic<std::uint64_t> m_created;
+		std::atomic<std::uint64_t> m_reused;
+		std::atomic<std::uint64_t> m_reconnects;
+		std::atomic<std::uint64_t> m_waits;
+		std::atomic<std::uint64_t> m_timeouts;
+	};
+}
@@ -0,0 +1,446 @@
+#include "upstream_client.hpp"
+
+namespace rvision
+{
+	namespace detail
+	{
+		static const std::size_t _recent_latencies = 256;
+		//the hedge threshold is refreshed every this many samples and only once the ring is this full
+		static const std::size_t _hedge_refresh = 32;
+	}
+
+	upstream_client::upstream_client(std::shared_ptr<rvision::core::logger> logger, const upstream_config& config)
+		: m_logger(logger), m_config(config), m_sessions(logger, config._sessions, config._timeout), m_attempts(config._hedge ? config._hedge_threads : 1)
+	{
+		m_config._hedge_percentile = std::clamp(m_config._hedge_percentile, 0.5, 0.999);
+		m_config._breaker_failures = std::max<std::uint32_t>(m_config._breaker_failures, 1);
+		m_config._breaker_max_backoff = std::max(m_config._breaker_backoff, m_config._breaker_max_backoff);
+
+		m_logger->info("upstream_client::upstream_client => hedge: {}, p{}, breaker after {} failures", m_config._hedge, m_config._hedge_percentile * 100.0, m_config._breaker_failures);
+	}
+
+	upstream_client::~upstream_client()
+	{
+		m_logger->debug("upstream_client::~upstream_client().");
+	}
+
+	rvision::core::errc upstream_client::get(const Poco::URI& uri, const std::string& etag, const std::string& last_modified, upstream_response& response)
+	{
+		auto _item = find(uri.getHost() + ":" + std::to_string(uri.getPort()));
+
+		auto _admission = admit(*_item);
+
+		if (_admission == admission::rejected)
+		{
+			_item->rejected.fetch_add(1, std::memory_order_relaxed);
+
+			return rvision::core::errc::insufficient_resources;
+		}
+
+		//a probe of an open circuit is a single request
+		auto _delay = (_admission == admission::probe) ? std::chrono::microseconds(0) : hedge_delay(*_item);
+
+		if (_delay.count() == 0)
+		{
+			return attempt(*_item, uri, etag, last_modified, response);
+		}
+
+		return hedged(_item, uri, etag, last_modified, _delay, response);
+	}
+
+	rvision::core::errc upstream_client::hedged(std::shared_ptr<upstream> item, const Poco::URI& uri, const std::string& etag, const std::string& last_modified, const std::chrono::microseconds& delay, upstream_response& response)
+	{
+		auto _race = std::make_shared<race>();
+
+		//the attempts hold copies, a loser may outlive this call and the poller that made it
+		auto _launch = [this, item, _race, uri, etag, last_modified](bool hedge)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_race->lock);
+
+				++_race->pending;
+			}
+
+			m_attempts.submit([this, item, _race, uri, etag, last_modified, hedge]()
+			{
+				upstream_response _response;
+
+				auto _result = attempt(*item, uri, etag, last_modified, _response, _race.get());
+
+				//a server error loses like a transport error, it is the result only when no attempt is left
+				bool _won = _result == rvision::core::errc::success && _response.status < Poco::Net::HTTPResponse::HTTPStatus::HTTP_INTERNAL_SERVER_ERROR;
+
+				{
+					std::unique_lock<std::mutex> lock(_race->lock);
+
+					--_race->pending;
+
+					if (!_race->done && (_won || _race->pending == 0))
+					{
+						_race->done = true;
+						_race->result = _result;
+						_race->hedge_won = hedge && _won;
+						_race->response = std::move(_response);
+
+						//the losers give their sessions back now instead of waiting for a response nobody reads
+						for (auto session : _race->sessions)
+						{
+							try
+							{
+								session->abort();
+							}
+							catch (const std::exception& e)
+							{
+								m_logger->debug("upstream_client::hedged => abort: {}", e.what());
+							}
+						}
+
+						_race->sessions.clear();
+					}
+				}
+
+				_race->wait.notify_all();
+			});
+		};
+
+		_launch(false);
+
+		std::unique_lock<std::mutex> lock(_race->lock);
+
+		if (!_race->wait.wait_for(lock, delay, [&_race] { return _race->done; }))
+		{
+			item->hedges.fetch_add(1, std::memory_order_relaxed);
+
+			lock.unlock();
+
+			_launch(true);
+
+			lock.lock();
+		}
+
+		_race->wait.wait(lock, [&_race] { return _race->done; });
+
+		if (_race->hedge_won)
+		{
+			item->hedge_wins.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		std::swap(response, _race->response);
+
+		return _race->result;
+	}
+
+	bool upstream_client::race::join(Poco::Net::HTTPClientSession* session)
+	{
+		std::unique_lock<std::mutex> guard(lock);
+
+		if (done)
+		{
+			return false;
+		}
+
+		sessions.push_back(session);
+
+		return true;
+	}
+
+	bool upstream_client::race::leave(Poco::Net::HTTPClientSession* session)
+	{
+		std::unique_lock<std::mutex> guard(lock);
+
+		auto p = std::find(sessions.begin(), sessions.end(), session);
+		if (p == sessions.end())
+		{
+			return false;
+		}
+
+		sessions.erase(p);
+
+		return true;
+	}
+
+	bool upstream_client::race::decided()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+
+		return done;
+	}
+
+	rvision::core::errc upstream_client::attempt(upstream& item, const Poco::URI& uri, const std::string& etag, const std::string& last_modified, upstream_response& response, race* contest)
+	{
+		item.requests.fetch_add(1, std::memory_order_relaxed);
+
+		auto _start = std::chrono::steady_clock::now();
+
+		auto _result = fetch(uri, etag, last_modified, response, contest);
+
+		//a loser aborted by the winner says nothing about the upstream
+		if (_result != rvision::core::errc::success && contest && contest->decided())
+		{
+			return _result;
+		}
+
+		//a server error counts against the upstream like a transport error, client errors do not
+		bool _ok = _result == rvision::core::errc::success && response.status < Poco::Net::HTTPResponse::HTTPStatus::HTTP_INTERNAL_SERVER_ERROR;
+
+		record(item, std::chrono::steady_clock::now() - _start, _ok);
+
+		return _result;
+	}
+
+	rvision::core::errc upstream_client::fetch(const Poco::URI& uri, const std::string& etag, const std::string& last_modified, upstream_response& response, race* contest) try
+	{
+		auto _lease = m_sessions.acquire(uri);
+
+		//an attempt of a hedged get exposes its session to the winner, it leaves the race before the session is dropped or given back
+		if (contest && !contest->join(&_lease.session()))
+		{
+			return rvision::core::errc::fail;
+		}
+
+		auto _leave = [&_lease, contest]()
+		{
+			return !contest || contest->leave(&_lease.session());
+		};
+
+		response.body.clear();
+
+		try
+		{
+			request(_lease, uri, etag, last_modified, response);
+		}
+		catch (const std::exception& e)
+		{
+			//a pooled connection the server has closed meanwhile fails on first use, it is retried once on a new one,
+			//an attempt aborted by the winner is not
+			if (!_leave() || !_lease.reused())
+			{
+				_lease.drop();
+				throw;
+			}
+
+			m_logger->debug("upstream_client::fetch => reconnecting {}: {}", uri.getHost(), e.what());
+
+			response.body.clear();
+			_lease.reconnect();
+
+			if (contest && !contest->join(&_lease.session()))
+			{
+				_lease.drop();
+				throw;
+			}
+
+			try
+			{
+				request(_lease, uri, etag, last_modified, response);
+			}
+			catch (...)
+			{
+				_leave();
+				_lease.drop();
+				throw;
+			}
+		}
+
+		//the winner may have aborted the session right after the response came in
+		if (!_leave())
+		{
+			_lease.drop();
+		}
+
+		return rvision::core::errc::success;
+	}
+	catch (const std::exception& e)
+	{
+		m_logger->error("upstream_client::fetch => host: {}, exception: {}", uri.getHost(), e.what());
+
+		return rvision::core::errc::fail;
+	}
+
+	void upstream_client::request(session_pool::lease& lease, const Poco::URI& uri, const std::string& etag, const std::string& last_modified, upstream_response& response)
+	{
+		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+
+		if (!etag.empty())
+		{
+			request.set("If-None-Match", etag);
+		}
+
+		if (!last_modified.empty())
+		{
+			request.set("If-Modified-Since", last_modified);
+		}
+
+		lease.session().sendRequest(request);
+				
+		Poco::Net::HTTPResponse responce;				
+		std::istream& responce_ss = lease.session().receiveResponse(responce);
+
+		//the body is read to the end so the connection can serve the next request
+		Poco::StreamCopier::copyToString(responce_ss, response.body);
+
+		response.status = responce.getStatus();
+		response.etag = responce.get("ETag", "");
+		response.last_modified = responce.get("Last-Modified", "");
+	}
+
+	std::shared_ptr<upstream_client::upstream> upstream_client::find(const std::string& key)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		auto& _item = m_upstreams[key];
+
+		if (!_item)
+		{
+			_item = std::make_shared<upstream>();
+			_item->recent.reserve(detail::_recent_latencies);
+			_item->backoff = m_config._breaker_backoff;
+		}
+
+		return _item;
+	}
+
+	upstream_client::admission upstream_client::admit(upstream& item)
+	{
+		std::unique_lock<std::mutex> lock(item.lock);
+
+		switch (item.state)
+		{
+			case circuit::closed:
+				return admission::allowed;
+
+			case circuit::open:
+				if (std::chrono::steady_clock::now() < item.open_until)
+				{
+					return admission::rejected;
+				}
+
+				//one probe at a time, the others keep being rejected until it settles the circuit
+				item.state = circuit::half_open;
+
+				return admission::probe;
+
+			default:
+				return admission::rejected;
+		}
+	}
+
+	void upstream_client::record(upstream& item, const std::chrono::steady_clock::duration& latency, bool ok)
+	{
+		std::unique_lock<std::mutex> lock(item.lock);
+
+		if (ok)
+		{
+			auto _us = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+
+			item.latency.record(_us);
+
+			if (item.recent.size() < detail::_recent_latencies)
+			{
+				item.recent.push_back(_us);
+			}
+			else
+			{
+				item.recent[item.next] = _us;
+			}
+
+			item.next = (item.next + 1) % detail::_recent_latencies;
+
+			if (item.next % detail::_hedge_refresh == 0 && item.recent.size() >= detail::_hedge_refresh)
+			{
+				auto _sorted = item.recent;
+				auto _rank = _sorted.begin() + static_cast<std::ptrdiff_t>(m_config._hedge_percentile * static_cast<std::double_t>(_sorted.size() - 1));
+
+				std::nth_element(_sorted.begin(), _rank, _sorted.end());
+
+				item.hedge_after = *_rank;
+			}
+
+			if (item.state != circuit::closed)
+			{
+				m_logger->info("upstream_client::record => circuit closed");
+			}
+
+			item.failures = 0;
+			item.state = circuit::closed;
+			item.backoff = m_config._breaker_backoff;
+
+			return;
+		}
+
+		item.errors.fetch_add(1, std::memory_order_relaxed);
+
+		++item.failures;
+
+		//a failed probe reopens the circuit for twice as long, the closed one opens after enough failures in a row
+		if (item.state == circuit::half_open || (item.state == circuit::closed && item.failures >= m_config._breaker_failures))
+		{
+			if (item.state == circuit::half_open)
+			{
+				item.backoff = std::min(item.backoff * 2, m_config._breaker_max_backoff);
+			}
+
+			item.state = circuit::open;
+			item.open_until = std::chrono::steady_clock::now() + item.backoff;
+
+			item.opened.fetch_add(1, std::memory_order_relaxed);
+
+			m_logger->error("upstream_client::record => circuit open for {} ms after {} failures", item.backoff.count(), item.failures);
+		}
+	}
+
+	std::chrono::microseconds upstream_client::hedge_delay(upstream& item)
+	{
+		if (!m_config._hedge)
+		{
+			return std::chrono::microseconds(0);
+		}
+
+		std::unique_lock<std::mutex> lock(item.lock);
+
+		if (item.hedge_after == 0)
+		{
+			return std::chrono::microseconds(0);
+		}
+
+		return std::max<std::chrono::microseconds>(std::chrono::microseconds(item.hedge_after), m_config._hedge_min_delay);
+	}
+
+	void upstream_client::metrics(boost::property_tree::ptree& tree, const std::string& path) const
+	{
+		m_sessions.metrics(tree, path + ".sessions");
+		m_attempts.metrics(tree, path + ".attempts");
+
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		for (const auto& [key, item] : m_upstreams)
+		{
+			auto _path = boost::replace_all_copy(path, ".", "/") + "/hosts/" + key + "/";
+
+			auto _put = [&tree, &_path](const std::string& name, auto value)
+			{
+				tree.put(boost::property_tree::ptree::path_type(_path + name, '/'), value);
+			};
+
+			{
+				std::unique_lock<std::mutex> item_lock(item->lock);
+
+				_put("circuit", item->state == circuit::closed ? "closed" : (item->state == circuit::open ? "open" : "half_open"));
+				_put("hedge_after_us", item->hedge_after);
+			}
+
+			_put("requests", item->requests.load(std::memory_order_relaxed));
+			_put("errors", item->errors.load(std::memory_order_relaxed));
+			_put("hedges", item->hedges.load(std::memory_order_relaxed));
+			_put("hedge_wins", item->hedge_wins.load(std::memory_order_relaxed));
+			_put("rejected", item->rejected.load(std::memory_order_relaxed));
+			_put("opened", item->opened.load(std::memory_order_relaxed));
+
+			auto _summary = item->latency.summarize();
+
+			_put("latency_us/p50", _summary.p50);
+			_put("latency_us/p95", _summary.p95);
+			_put("latency_us/p99", _summary.p99);
+		}
+	}
+}
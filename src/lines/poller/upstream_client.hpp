@@ -0,0 +1,119 @@
+#pragma once
+#include <core/headers.hpp>
+#include <core/logger.hpp>
+#include <core/error.hpp>
+#include <core/histogram.hpp>
+#include <core/executor.hpp>
+#include <lines/poller/session_pool.hpp>
+
+namespace rvision
+{
+	struct upstream_config
+	{
+		std::uint32_t _sessions = 16;
+		std::chrono::milliseconds _timeout = std::chrono::milliseconds(60000);
+		//a second request is sent once the first is slower than this percentile of the recent latencies of the upstream
+		bool _hedge = true;
+		std::double_t _hedge_percentile = 0.95;
+		std::chrono::milliseconds _hedge_min_delay = std::chrono::milliseconds(50);
+		std::uint32_t _hedge_threads = 16;
+		//consecutive failures opening the circuit, the probe interval doubles up to the max while it stays open
+		std::uint32_t _breaker_failures = 5;
+		std::chrono::milliseconds _breaker_backoff = std::chrono::milliseconds(1000);
+		std::chrono::milliseconds _breaker_max_backoff = std::chrono::milliseconds(60000);
+	};
+
+	struct upstream_response
+	{
+		Poco::Net::HTTPResponse::HTTPStatus status = Poco::Net::HTTPResponse::HTTPStatus::HTTP_OK;
+		std::string body;
+		std::string etag;
+		std::string last_modified;
+	};
+
+	//GET against the upstream hosts over the session pool, with per host latency tracking, hedged requests and a circuit breaker
+	class upstream_client
+	{
+		enum class circuit
+		{
+			closed = 0,
+			open = 1,
+			half_open = 2
+		};
+
+		enum class admission
+		{
+			rejected = 0,
+			allowed = 1,
+			probe = 2
+		};
+
+		struct upstream
+		{
+			std::mutex lock;
+			//ring of the recent latencies of successful requests, in us
+			std::vector<std::uint64_t> recent;
+			std::size_t next = 0;
+			std::uint64_t hedge_after = 0;
+			circuit state = circuit::closed;
+			std::uint32_t failures = 0;
+			std::chrono::milliseconds backoff;
+			std::chrono::steady_clock::time_point open_until;
+			rvision::core::histogram latency;
+			std::atomic<std::uint64_t> requests{0};
+			std::atomic<std::uint64_t> errors{0};
+			std::atomic<std::uint64_t> hedges{0};
+			std::atomic<std::uint64_t> hedge_wins{0};
+			std::atomic<std::uint64_t> rejected{0};
+			std::atomic<std::uint64_t> opened{0};
+		};
+
+		//the first successful attempt of a hedged get wins and aborts the sessions of the others
+		struct race
+		{
+			std::mutex lock;
+			std::condition_variable wait;
+			bool done = false;
+			std::uint32_t pending = 0;
+			rvision::core::errc result = rvision::core::errc::fail;
+			bool hedge_won = false;
+			upstream_response response;
+			//sessions of the attempts with a request in flight
+			std::vector<Poco::Net::HTTPClientSession*> sessions;
+
+			//false once the race is decided, the attempt does not send its request then
+			bool join(Poco::Net::HTTPClientSession* session);
+			//false when the session was aborted by the winner
+			bool leave(Poco::Net::HTTPClientSession* session);
+			bool decided();
+		};
+
+	public:
+		upstream_client(std::shared_ptr<rvision::core::logger> logger, const upstream_config& config);
+		~upstream_client();
+
+		//errc::insufficient_resources while the circuit of the upstream is open, errc::fail on transport errors
+		rvision::core::errc get(const Poco::URI& uri, const std::string& etag, const std::string& last_modified, upstream_response& response);
+
+		void metrics(boost::property_tree::ptree& tree, const std::string& path) const;
+
+	private:
+		std::shared_ptr<upstream> find(const std::string& key);
+		admission admit(upstream& item);
+		void record(upstream& item, const std::chrono::steady_clock::duration& latency, bool ok);
+		std::chrono::microseconds hedge_delay(upstream& item);
+		rvision::core::errc attempt(upstream& item, const Poco::URI& uri, const std::string& etag, const std::string& last_modified, upstream_response& response, race* contest = nullptr);
+		rvision::core::errc fetch(const Poco::URI& uri, const std::string& etag, const std::string& last_modified, upstream_response& response, race* contest);
+		void request(session_pool::lease& lease, const Poco::URI& uri, const std::string& etag, const std::string& last_modified, upstream_response& response);
+		rvision::core::errc hedged(std::shared_ptr<upstream> item, const Poco::URI& uri, const std::string& etag, const std::string& last_modified, const std::chrono::microseconds& delay, upstream_response& response);
+
+	private:
+		std::shared_ptr<rvision::core::logger> m_logger;
+		upstream_config m_config;
+		session_pool m_sessions;
+		mutable std::mutex m_lock;
+		std::unordered_map<std::string, std::shared_ptr<upstream>> m_upstreams;
+		//declared last, pending attempts finish before the rest of the client goes away
+		rvision::core::executor m_attempts;
+	};
+}
@@ -0,0 +1,92 @@
+#include "lines_ingest.hpp"
+
+namespace rvision
+{
+	rvision::core::errc lines_ingest::read(std::istream& body, bool ndjson, const sink_t& sink, lines_ingest_result& result)
+	{
+		auto _take = [&sink, &result](const boost::property_tree::ptree& value)
+		{
+			std::string _sport;
+			score_sample _sample;
+
+			if (item(value, _sport, _sample) && sink(_sport, _sample) == rvision::core::errc::success)
+			{
+				++result.accepted;
+			}
+			else
+			{
+				++result.rejected;
+			}
+		};
+
+		body >> std::ws;
+
+		//a json array is parsed whole, ndjson is taken one line at a time
+		if (!ndjson && body.peek() == '[')
+		{
+			boost::property_tree::ptree _items;
+
+			try
+			{
+				boost::property_tree::read_json(body, _items);
+			}
+			catch (const std::exception&)
+			{
+				return rvision::core::errc::invalid_argument;
+			}
+
+			for (const auto& [key, value] : _items)
+			{
+				_take(value);
+			}
+
+			return rvision::core::errc::success;
+		}
+
+		std::string _line;
+
+		while (std::getline(body, _line))
+		{
+			if (boost::trim_copy(_line).empty())
+			{
+				continue;
+			}
+
+			boost::property_tree::ptree _item;
+			std::istringstream _line_ss(_line);
+
+			try
+			{
+				boost::property_tree::read_json(_line_ss, _item);
+			}
+			catch (const std::exception&)
+			{
+				++result.rejected;
+
+				continue;
+			}
+
+			_take(_item);
+		}
+
+		return rvision::core::errc::success;
+	}
+
+	bool lines_ingest::item(const boost::property_tree::ptree& item, std::string& sport, score_sample& sample)
+	{
+		sport = item.get<std::string>("sport", "");
+
+		auto _score = item.get_optional<std::double_t>("score");
+		auto _ts = item.get_optional<std::int64_t>("ts");
+
+		if (sport.empty() || !_score || (item.count("ts") && !_ts))
+		{
+			return false;
+		}
+
+		sample.score = *_score;
+		sample.ts = _ts ? *_ts : score_now();
+
+		return true;
+	}
+}
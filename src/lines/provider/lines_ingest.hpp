@@ -0,0 +1,25 @@
+#pragma once
+#include <core/headers.hpp>
+#include <core/error.hpp>
+#include <lines/utils/score_sample.hpp>
+
+namespace rvision
+{
+	struct lines_ingest_result
+	{
+		std::uint64_t accepted = 0;
+		std::uint64_t rejected = 0;
+	};
+
+	//body of POST /ingest: one json array [{"sport": .., "score": .., "ts": <ms>}, ..] or ndjson, one object per line read as it streams in.
+	//ts defaults to the time of arrival, an item that is malformed or not taken by the sink is rejected
+	class lines_ingest
+	{
+	public:
+		using sink_t = std::function<rvision::core::errc(const std::string& sport, const score_sample& sample)>;
+
+		//errc::invalid_argument for a malformed json array, nothing of it is handed to the sink then
+		static rvision::core::errc read(std::istream& body, bool ndjson, const sink_t& sink, lines_ingest_result& result);
+		static bool item(const boost::property_tree::ptree& item, std::string& sport, score_sample& sample);
+	};
+}
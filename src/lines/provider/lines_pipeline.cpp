@@ -0,0 +1,302 @@
+#include "lines_pipeline.hpp"
+
+namespace rvision
+{
+	namespace detail
+	{
+		static const char* overload_name(overload_policy policy)
+		{
+			switch (policy)
+			{
+			case overload_policy::block:
+				return "block";
+			case overload_policy::drop_oldest:
+				return "drop_oldest";
+			case overload_policy::coalesce:
+				return "coalesce";
+			}
+
+			return "";
+		}
+	}
+
+	lines_pipeline::lines_pipeline(std::shared_ptr<rvision::core::logger> logger, const lines_pipeline_config& config, const handler_t& publish, const handler_t& persist)
+		: m_logger(logger), m_publish(publish), m_persist(persist)
+	{
+		auto _persist_overload = config._persist_overload;
+
+		if (_persist_overload == overload_policy::block)
+		{
+			m_logger->warn("lines_pipeline::lines_pipeline => persist stage can not block publishing, drop_oldest is used");
+
+			_persist_overload = overload_policy::drop_oldest;
+		}
+
+		m_stages[publish_stage] = std::make_unique<stage>(config._publish_queue, config._publish_overload);
+		m_stages[persist_stage] = std::make_unique<stage>(config._persist_queue, _persist_overload);
+
+		for (auto index : {publish_stage, persist_stage})
+		{
+			m_stages[index]->thread = std::jthread([this, index](std::stop_token stoken)
+			{
+				run(stoken, *m_stages[index], index);
+			});
+		}
+
+		m_logger->info("lines_pipeline::lines_pipeline => publish: {}/{}, persist: {}/{}", m_stages[publish_stage]->queue.capacity(), detail::overload_name(config._publish_overload),
+			m_stages[persist_stage]->queue.capacity(), detail::overload_name(_persist_overload));
+	}
+
+	lines_pipeline::~lines_pipeline()
+	{
+		drain();
+
+		//publish goes first, it feeds persist
+		for (auto& s : m_stages)
+		{
+			s->thread.request_stop();
+
+			s->wake.fetch_add(1, std::memory_order_release);
+			s->wake.notify_all();
+
+			s->thread.join();
+		}
+
+		m_logger->debug("lines_pipeline::~lines_pipeline().");
+	}
+
+	void lines_pipeline::add(const std::string& line)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_lines_lock);
+
+		if (!m_lines.contains(line))
+		{
+			auto _slot = std::make_shared<line_slot>();
+			_slot->line = line;
+
+			m_lines.emplace(line, _slot);
+		}
+	}
+
+	void lines_pipeline::rem(const std::string& line)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_lines_lock);
+
+		if (auto p = m_lines.find(line); p != m_lines.end())
+		{
+			//samples still queued for the line are skipped
+			p->second->active.store(false, std::memory_order_release);
+
+			m_lines.erase(p);
+		}
+	}
+
+	rvision::core::errc lines_pipeline::push(const std::string& line, const score_sample& sample)
+	{
+		std::shared_ptr<line_slot> _slot;
+
+		{
+			std::shared_lock<std::shared_mutex> lock(m_lines_lock);
+
+			auto p = m_lines.find(line);
+			if (p == m_lines.end())
+			{
+				return rvision::core::errc::not_found;
+			}
+
+			_slot = p->second;
+		}
+
+		enqueue(*m_stages[publish_stage], publish_stage, _slot, sample);
+
+		return rvision::core::errc::success;
+	}
+
+	void lines_pipeline::enqueue(stage& s, stages index, const std::shared_ptr<line_slot>& slot, const score_sample& sample)
+	{
+		auto _now = std::chrono::steady_clock::now();
+
+		if (s.policy == overload_policy::coalesce)
+		{
+			std::unique_lock<std::mutex> lock(slot->lock);
+
+			if (slot->queued[index])
+			{
+				//the queued sample gives way to a newer one only, a late push doesn't move the line back
+				if (sample.ts >= slot->latest[index].ts)
+				{
+					slot->latest[index] = sample;
+				}
+
+				s.coalesced.fetch_add(1, std::memory_order_relaxed);
+
+				return;
+			}
+
+			slot->latest[index] = sample;
+			slot->queued[index] = true;
+			slot->latest_at[index] = _now;
+		}
+
+		item _item{slot, sample, _now};
+
+		s.pushed.fetch_add(1, std::memory_order_release);
+
+		bool _blocked = false;
+
+		while (!s.queue.try_push(_item))
+		{
+			//persist never blocks publishing, a coalescing queue shorter than the lines makes room like drop_oldest there
+			if (s.policy == overload_policy::drop_oldest || index == persist_stage)
+			{
+				item _oldest;
+
+				if (s.queue.try_pop(_oldest))
+				{
+					if (s.policy == overload_policy::coalesce)
+					{
+						std::unique_lock<std::mutex> lock(_oldest.slot->lock);
+
+						_oldest.slot->queued[index] = false;
+					}
+
+					s.dropped.fetch_add(1, std::memory_order_relaxed);
+
+					finish(s, 1);
+				}
+
+				continue;
+			}
+
+			if (!_blocked)
+			{
+				_blocked = true;
+
+				s.blocked.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			//a stage thread finishing an item after the failed push changes the value, the wait does not miss it
+			auto _finished = s.finished.load(std::memory_order_acquire);
+
+			if (s.queue.try_push(_item))
+			{
+				break;
+			}
+
+			s.finished.wait(_finished, std::memory_order_acquire);
+		}
+
+		s.wake.fetch_add(1, std::memory_order_release);
+		s.wake.notify_one();
+	}
+
+	void lines_pipeline::run(std::stop_token stoken, stage& s, stages index)
+	{
+		item _item;
+
+		while (true)
+		{
+			auto _wake = s.wake.load(std::memory_order_acquire);
+
+			if (!s.queue.try_pop(_item))
+			{
+				//stops once the queue is empty
+				if (stoken.stop_requested())
+				{
+					break;
+				}
+
+				s.wake.wait(_wake, std::memory_order_acquire);
+
+				continue;
+			}
+
+			auto _sample = _item.sample;
+			auto _queued = _item.queued;
+
+			if (s.policy == overload_policy::coalesce)
+			{
+				std::unique_lock<std::mutex> lock(_item.slot->lock);
+
+				_sample = _item.slot->latest[index];
+				_queued = _item.slot->latest_at[index];
+				_item.slot->queued[index] = false;
+			}
+
+			auto _start = std::chrono::steady_clock::now();
+
+			s.queue_wait.record(_start - _queued);
+
+			if (_item.slot->active.load(std::memory_order_acquire))
+			{
+				if (index == publish_stage)
+				{
+					m_publish(_item.slot->line, _sample);
+
+					enqueue(*m_stages[persist_stage], persist_stage, _item.slot, _sample);
+				}
+				else
+				{
+					m_persist(_item.slot->line, _sample);
+				}
+			}
+
+			s.latency.record(std::chrono::steady_clock::now() - _start);
+
+			_item.slot.reset();
+
+			finish(s, 1);
+		}
+	}
+
+	void lines_pipeline::finish(stage& s, std::uint64_t count)
+	{
+		s.finished.fetch_add(count, std::memory_order_release);
+		s.finished.notify_all();
+	}
+
+	void lines_pipeline::drain()
+	{
+		//publish first, what it hands on to persist is counted there before it is finished here
+		for (auto& s : m_stages)
+		{
+			auto _target = s->pushed.load(std::memory_order_acquire);
+			auto _finished = s->finished.load(std::memory_order_acquire);
+
+			while (_finished < _target)
+			{
+				s->finished.wait(_finished, std::memory_order_acquire);
+
+				_finished = s->finished.load(std::memory_order_acquire);
+			}
+		}
+	}
+
+	void lines_pipeline::metrics(boost::property_tree::ptree& tree, const std::string& path) const
+	{
+		{
+			std::shared_lock<std::shared_mutex> lock(m_lines_lock);
+
+			tree.put(path + ".lines", m_lines.size());
+		}
+
+		static const std::array<std::string, 2> _names = {"publish", "persist"};
+
+		for (auto index : {publish_stage, persist_stage})
+		{
+			const auto& s = *m_stages[index];
+			auto _path = path + "." + _names[index];
+
+			tree.put(_path + ".policy", detail::overload_name(s.policy));
+			tree.put(_path + ".capacity", s.queue.capacity());
+			tree.put(_path + ".depth", s.queue.size());
+			tree.put(_path + ".pushed", s.pushed.load(std::memory_order_relaxed));
+			tree.put(_path + ".dropped", s.dropped.load(std::memory_order_relaxed));
+			tree.put(_path + ".coalesced", s.coalesced.load(std::memory_order_relaxed));
+			tree.put(_path + ".blocked", s.blocked.load(std::memory_order_relaxed));
+
+			rvision::core::put_histogram(tree, _path + ".queue_wait_us", s.queue_wait);
+			rvision::core::put_histogram(tree, _path + ".latency_us", s.latency);
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <core/headers.hpp>
+#include <core/logger.hpp>
+#include <core/error.hpp>
+#include <core/histogram.hpp>
+#include <core/ring_queue.hpp>
+#include <lines/utils/score_sample.hpp>
+#include <array>
+
+namespace rvision
+{
+	//what a stage does with a sample its full queue has no room for
+	enum class overload_policy
+	{
+		//the producer waits for room
+		block = 0,
+		//the oldest queued sample is dropped
+		drop_oldest = 1,
+		//a line is queued once, newer samples replace its pending one
+		coalesce = 2
+	};
+
+	struct lines_pipeline_config
+	{
+		std::uint32_t _publish_queue = 4096;
+		overload_policy _publish_overload = overload_policy::block;
+		//publishing never waits on persistence, block is taken as drop_oldest here
+		std::uint32_t _persist_queue = 65536;
+		overload_policy _persist_overload = overload_policy::drop_oldest;
+	};
+
+	//polled and pushed samples go through two bounded stages, each drained by its own thread:
+	//publish (window and delta cache) hands every sample on to persist (storage), a slow storage does not hold up the pollers or the cache
+	class lines_pipeline
+	{
+	public:
+		using handler_t = std::function<void(const std::string& line, const score_sample& sample)>;
+
+	private:
+		enum stages
+		{
+			publish_stage = 0,
+			persist_stage = 1
+		};
+
+		struct line_slot
+		{
+			std::string line;
+			std::atomic<bool> active{true};
+			//pending sample of each coalescing stage
+			std::mutex lock;
+			std::array<score_sample, 2> latest;
+			std::array<std::chrono::steady_clock::time_point, 2> latest_at;
+			std::array<bool, 2> queued{};
+		};
+
+		struct item
+		{
+			std::shared_ptr<line_slot> slot;
+			score_sample sample;
+			std::chrono::steady_clock::time_point queued;
+		};
+
+		struct stage
+		{
+			stage(std::size_t capacity, overload_policy overload)
+				: queue(capacity), policy(overload)
+			{
+			}
+
+			rvision::core::ring_queue<item> queue;
+			overload_policy policy;
+			//bumped on every push and on stop, the stage thread sleeps on it
+			std::atomic<std::uint64_t> wake{0};
+			std::atomic<std::uint64_t> pushed{0};
+			//handled or dropped, a blocked producer and drain sleep on it
+			std::atomic<std::uint64_t> finished{0};
+			std::atomic<std::uint64_t> dropped{0};
+			std::atomic<std::uint64_t> coalesced{0};
+			std::atomic<std::uint64_t> blocked{0};
+			rvision::core::histogram queue_wait;
+			rvision::core::histogram latency;
+			std::jthread thread;
+		};
+
+	public:
+		lines_pipeline(std::shared_ptr<rvision::core::logger> logger, const lines_pipeline_config& config, const handler_t& publish, const handler_t& persist);
+		//samples already queued are published and persisted first
+		~lines_pipeline();
+
+		void add(const std::string& line);
+		void rem(const std::string& line);
+
+		//errc::not_found for a line that is not added, a full queue blocks, drops its oldest sample or coalesces as configured
+		rvision::core::errc push(const std::string& line, const score_sample& sample);
+
+		//returns once the samples pushed so far are persisted or dropped
+		void drain();
+
+		void metrics(boost::property_tree::ptree& tree, const std::string& path) const;
+
+	private:
+		void enqueue(stage& s, stages index, const std::shared_ptr<line_slot>& slot, const score_sample& sample);
+		void run(std::stop_token stoken, stage& s, stages index);
+		void finish(stage& s, std::uint64_t count);
+
+	private:
+		std::shared_ptr<rvision::core::logger> m_logger;
+		handler_t m_publish;
+		handler_t m_persist;
+		mutable std::shared_mutex m_lines_lock;
+		std::unordered_map<std::string, std::shared_ptr<line_slot>> m_lines;
+		std::array<std::unique_ptr<stage>, 2> m_stages;
+	};
+}
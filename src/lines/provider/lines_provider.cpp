@@ -2,24 +2,92 @@
 
 namespace rvision
 {	
-	lines_provider::lines_provider(const std::unordered_map<std::string, std::uint32_t>& sports, const std::string& host, const std::string& api, const std::string& db, std::shared_ptr<rvision::core::logger> logger)
-	: m_host(host), m_api(api), m_logger(logger), m_db(db, logger)
+	namespace detail
+	{
+		static std::unique_ptr<lines_storage> create_storage(const std::string& db, std::shared_ptr<rvision::core::logger> logger, const lines_provider_config& config)
+		{
+			if (config._storage == "log")
+			{
+				return std::make_unique<lines_log>(db, logger, config._log);
+			}
+
+			if (config._storage != "sqlite")
+			{
+				logger->error("lines_provider::create_storage => unknown storage: {}, sqlite is used", config._storage);
+			}
+
+			if (config._db._shards > 1)
+			{
+				return std::make_unique<lines_shards>(db, logger, config._db);
+			}
+
+			lines_shards::check_layout(db, 1, logger);
+
+			return std::make_unique<lines_db>(db, logger, config._db);
+		}
+
+		static const std::string _snapshot_name("lines_cache.snap");
+	}
+
+	lines_provider::lines_provider(const std::unordered_map<std::string, std::uint32_t>& sports, const std::string& host, const std::string& api, const std::string& db, std::shared_ptr<rvision::core::logger> logger,
+		const lines_provider_config& config)
+	: m_host(host), m_api(api), m_logger(logger), m_config(config), m_db(detail::create_storage(db, logger, config)), m_snapshot_path(db + detail::_snapshot_name), m_snapshots(0), m_ingested(0), m_late(0), m_unstored(0),
+	  m_pipeline(logger, config._pipeline, [this](const std::string& sport, const score_sample& sample) { publish(sport, sample); }, [this](const std::string& sport, const score_sample& sample) { persist(sport, sample); }),
+	  m_upstream(logger, config._upstream), m_scheduler(logger, std::max<std::uint32_t>(config._poll_workers, 1), config._poll_jitter, config._poll_overrun), m_poll_groups_count(0)
 	{
 		m_address += m_host;
 		m_address += "/";
 		m_address += m_api;
 
-		m_logger->info("lines_provider::lines_provider => address {}", m_address);
+		m_logger->info("lines_provider::lines_provider => address {}, window {} samples per line", m_address, m_config._window);
+
+		if (m_config._snapshot)
+		{
+			load_snapshot();
+		}
 
 		for(const auto& s : sports)
 		{
 			std::chrono::seconds period(s.second);
 			add(s.first, period);
 		}
+
+		{
+			std::unique_lock<std::shared_mutex> lock(m_lines_cache_lock);
+
+			m_restored_cache.clear();
+		}
+
+		if (m_config._snapshot && m_config._snapshot_interval.count() > 0)
+		{
+			m_snapshot_thread = std::jthread([this](std::stop_token stoken)
+			{
+				snapshot(stoken);
+			});
+		}
 	}
 	
 	lines_provider::~lines_provider()
 	{
+		//no poller may touch the cache after the last snapshot
+		{
+			std::unique_lock<std::mutex> lock(m_pollers_lock);
+
+			m_pollers.clear();
+		}
+
+		m_pipeline.drain();
+
+		m_snapshot_thread.request_stop();
+		if (m_snapshot_thread.joinable())
+		{
+			m_snapshot_thread.join();
+		}
+
+		if (m_config._snapshot)
+		{
+			save_snapshot();
+		}
 	}
 	
 	lines_provider_state lines_provider::state()
@@ -45,22 +113,44 @@ namespace rvision
 		address += "/";
 		address += sport;
 		
-		m_db.add_line(sport);
+		m_db->add_line(sport);
 		
-		update_cache(sport, 0.0);
+		init_cache(sport);
+
+		{
+			std::unique_lock<std::shared_mutex> lock(m_windows_lock);
+
+			if (!m_windows.contains(sport))
+			{
+				m_windows.emplace(sport, std::make_shared<score_window>(m_config._window));
+			}
+		}
+
+		m_pipeline.add(sport);
 		
+		//a push line is fed by ingest only
+		if (period.count() == 0)
+		{
+			m_logger->info("lines_provider::add => line: {} is pushed, no poller", sport);
+
+			return;
+		}
+
 		std::unique_lock<std::mutex> lock(m_pollers_lock);
+
+		if (m_config._poll_batch > 1)
+		{
+			join_group(sport, period);
+
+			return;
+		}
+
 		if(auto p = m_pollers.find(address); p == m_pollers.end())
 		{
-			m_pollers.emplace(std::piecewise_construct, std::forward_as_tuple(address), std::forward_as_tuple(m_logger, address, sport, period,
-			[&](const std::string& sport, std::double_t score)
+			m_pollers.emplace(std::piecewise_construct, std::forward_as_tuple(address), std::forward_as_tuple(m_logger, m_scheduler, m_upstream, address, sport, period, m_config._poller,
+			[this](const std::string& sport, std::double_t score)
 			{
-				m_db.update_line(sport, score);
-				
-				update_cache(sport, score);
-
-				m_logger->debug("lines_provider::update => line : {} with score : {}", sport, score);
-				
+				m_pipeline.push(sport, score_sample{score_now(), score});
 			}));
 		}
 	}
@@ -68,28 +158,246 @@ namespace rvision
 	void lines_provider::rem(const std::string& sport)
 	{
 		std::string address(m_address);
-		address += "//";
+		address += "/";
 		address += sport;
 				
-		std::unique_lock<std::mutex> lock(m_pollers_lock);
-		if(auto p = m_pollers.find(address); p != m_pollers.end())
 		{
-			m_pollers.erase(p);
+			std::unique_lock<std::mutex> lock(m_pollers_lock);
+
+			if (m_config._poll_batch > 1)
+			{
+				leave_group(sport);
+			}
+			else if(auto p = m_pollers.find(address); p != m_pollers.end())
+			{
+				m_pollers.erase(p);
+			}
+		}
+
+		m_pipeline.rem(sport);
+
+		{
+			std::unique_lock<std::shared_mutex> lock(m_windows_lock);
+
+			m_windows.erase(sport);
+		}
+		
+		m_db->rem_line(sport);
+	}
+	
+	void lines_provider::publish(const std::string& sport, const score_sample& sample)
+	{
+		if (auto _window = window(sport))
+		{
+			//a late sample is left out of the window and the cache, persist still gets it after this and the reads find it there
+			if (!_window->push(sample))
+			{
+				m_late.fetch_add(1, std::memory_order_relaxed);
+
+				m_logger->debug("lines_provider::publish => line : {} late sample ts : {}", sport, sample.ts);
+
+				return;
+			}
 		}
 		
-		m_db.rem_line(sport);
+		update_cache(sport, sample.score);
+
+		m_logger->debug("lines_provider::publish => line : {} with score : {}", sport, sample.score);
+	}
+
+	void lines_provider::persist(const std::string& sport, const score_sample& sample)
+	{
+		auto errc = m_db->update_line(sport, sample);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_unstored.fetch_add(1, std::memory_order_relaxed);
+
+			m_logger->error("lines_provider::persist => line : {} ts : {} is not stored, error : {}", sport, sample.ts, errc);
+		}
+	}
+
+	rvision::core::errc lines_provider::ingest(const std::string& sport, const score_sample& sample)
+	{
+		auto errc = m_pipeline.push(sport, sample);
+
+		if (errc == rvision::core::errc::success)
+		{
+			m_ingested.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return errc;
+	}
+
+	void lines_provider::flush()
+	{
+		m_pipeline.drain();
+	}
+
+	void lines_provider::join_group(const std::string& sport, const std::chrono::seconds& period)
+	{
+		for (const auto& [key, group] : m_poll_groups)
+		{
+			if (std::find(group.sports.begin(), group.sports.end(), sport) != group.sports.end())
+			{
+				return;
+			}
+		}
+
+		//lines of the same period share a request until the group is full
+		auto _group = std::find_if(m_poll_groups.begin(), m_poll_groups.end(), [&](const auto& p)
+		{
+			return p.second.period == period && p.second.sports.size() < m_config._poll_batch;
+		});
+
+		if (_group == m_poll_groups.end())
+		{
+			auto _key = fmt::format("batch/{}/{}", period.count(), ++m_poll_groups_count);
+
+			_group = m_poll_groups.emplace(_key, poll_group{period, {}}).first;
+		}
+
+		_group->second.sports.push_back(sport);
+
+		regroup(_group->first);
+	}
+
+	void lines_provider::leave_group(const std::string& sport)
+	{
+		for (auto& [key, group] : m_poll_groups)
+		{
+			if (auto p = std::find(group.sports.begin(), group.sports.end(), sport); p != group.sports.end())
+			{
+				group.sports.erase(p);
+
+				regroup(key);
+
+				return;
+			}
+		}
+	}
+
+	void lines_provider::regroup(const std::string& key)
+	{
+		auto p = m_poll_groups.find(key);
+		if (p == m_poll_groups.end() || p->second.sports.empty())
+		{
+			m_pollers.erase(key);
+
+			if (p != m_poll_groups.end())
+			{
+				m_poll_groups.erase(p);
+			}
+
+			return;
+		}
+
+		std::string _sports;
+
+		for (std::size_t i = 0; i < p->second.sports.size(); ++i)
+		{
+			_sports += (i ? "," : "") + p->second.sports[i];
+		}
+
+		//line names are encoded, the commas between them are not
+		Poco::URI _uri(m_host + "/" + (m_config._poll_batch_api.empty() ? m_api : m_config._poll_batch_api));
+		_uri.addQueryParameter("sports", _sports);
+
+		auto address = _uri.toString();
+
+		//the request of a group changes with its lines, its poller takes it in place and keeps its period
+		if (auto _poller = m_pollers.find(key); _poller != m_pollers.end())
+		{
+			_poller->second.set_lines(address, p->second.sports);
+
+			return;
+		}
+
+		m_pollers.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(m_logger, m_scheduler, m_upstream, address, p->second.sports, p->second.period, m_config._poller,
+		[this](const std::string& sport, std::double_t score)
+		{
+			m_pipeline.push(sport, score_sample{score_now(), score});
+		}));
+	}
+
+	std::shared_ptr<score_window> lines_provider::window(const std::string& sport) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_windows_lock);
+
+		if (auto p = m_windows.find(sport); p != m_windows.end())
+		{
+			return p->second;
+		}
+
+		return nullptr;
 	}
 	
+	void lines_provider::complete(const std::string& sport, std::int64_t oldest, std::vector<std::double_t>& stored, std::vector<std::double_t>& score)
+	{
+		//the committed part of the window is the tail of stored, read after it so a commit in between can't repeat a score
+		if (!score.empty())
+		{
+			std::vector<score_sample> _overlap;
+			m_db->fetch_score(sport, oldest, std::numeric_limits<std::int64_t>::max(), _overlap);
+
+			stored.resize(stored.size() - std::min(stored.size(), _overlap.size()));
+		}
+
+		auto _older = std::min(stored.size(), lines_storage::fetch_portion - score.size());
+
+		score.insert(score.begin(), stored.end() - _older, stored.end());
+	}
+
 	std::unordered_map<std::string, std::vector<std::double_t>> lines_provider::fetch(const std::vector<std::string>& sports)
 	{
+		struct pending
+		{
+			std::string sport;
+			std::int64_t oldest = std::numeric_limits<std::int64_t>::max();
+			std::vector<std::double_t> score;
+			std::future<async_result<std::vector<std::double_t>>> stored;
+		};
+
 		std::unordered_map<std::string, std::vector<std::double_t>> lines;
+		std::vector<pending> _pending;
+
+		lines.reserve(sports.size());
 		
+		//the newest fetch_portion scores of each line, lines the window can't fill are read from the storage all at once
 		for(const auto& s : sports)
 		{
-			std::vector<std::double_t> score;
-			m_db.fetch_score(s, score);
-			
-			lines[s] = score;
+			pending _line;
+			_line.sport = s;
+
+			if (auto _window = window(s))
+			{
+				_line.oldest = _window->oldest();
+
+				if (_window->fetch(_line.score, lines_storage::fetch_portion) == lines_storage::fetch_portion)
+				{
+					lines[s] = std::move(_line.score);
+
+					continue;
+				}
+			}
+
+			_line.stored = m_db->fetch_score_async(s);
+
+			_pending.emplace_back(std::move(_line));
+		}
+
+		for (auto& p : _pending)
+		{
+			auto _stored = p.stored.get();
+
+			if (_stored.errc != rvision::core::errc::success)
+			{
+				m_logger->error("lines_provider::fetch => line : {} storage read failed, error : {}", p.sport, _stored.errc);
+			}
+
+			complete(p.sport, p.oldest, _stored.value, p.score);
+
+			lines[p.sport] = std::move(p.score);
 		}
 		
 		return lines;
@@ -98,43 +406,380 @@ namespace rvision
 	std::vector<std::double_t> lines_provider::fetch(const std::string& sport)
 	{
 		std::vector<std::double_t> score;
-		m_db.fetch_score(sport, score);
+		auto _oldest = std::numeric_limits<std::int64_t>::max();
+
+		if (auto _window = window(sport))
+		{
+			_oldest = _window->oldest();
+
+			if (_window->fetch(score, lines_storage::fetch_portion) == lines_storage::fetch_portion)
+			{
+				return score;
+			}
+		}
+
+		std::vector<std::double_t> _stored;
+		m_db->fetch_score(sport, _stored);
+
+		complete(sport, _oldest, _stored, score);
 		
 		return score;
 	}
+
+	std::vector<score_sample> lines_provider::fetch(const std::string& sport, std::int64_t from, std::int64_t to)
+	{
+		std::vector<score_sample> samples;
+
+		auto _window = window(sport);
+		auto _oldest = _window ? _window->oldest() : std::numeric_limits<std::int64_t>::max();
+
+		//only the part of the range older than the hot window goes to the db
+		if (from < _oldest)
+		{
+			m_db->fetch_score(sport, from, std::min(to, _oldest - 1), samples);
+		}
+
+		if (_window && to >= _oldest)
+		{
+			_window->fetch(from, to, samples);
+		}
+
+		return samples;
+	}
 	
+	rvision::core::errc lines_provider::fetch(const std::string& sport, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink, score_page& result)
+	{
+		result = {};
+		result.next = from;
+		result.skip = skip;
+
+		if (page == 0 || from > to)
+		{
+			return rvision::core::errc::invalid_argument;
+		}
+
+		auto _window = window(sport);
+		auto _oldest = _window ? _window->oldest() : std::numeric_limits<std::int64_t>::max();
+
+		if (from < _oldest)
+		{
+			bool _stopped = false;
+
+			auto errc = m_db->fetch_page(sport, from, skip, std::min(to, _oldest - 1), page, [&sink, &_stopped](std::span<const score_sample> samples)
+			{
+				_stopped = !sink(samples);
+
+				return !_stopped;
+			}, result);
+
+			//storage is exhausted below the window, the next page starts in it
+			if (errc == rvision::core::errc::success && !_stopped && !result.more && result.count < page && to >= _oldest)
+			{
+				result.more = true;
+				result.next = _oldest;
+				result.skip = 0;
+			}
+
+			return errc;
+		}
+
+		//nothing is left to read past the last representable ts
+		if (!_window)
+		{
+			return rvision::core::errc::success;
+		}
+
+		std::vector<score_sample> _samples;
+		_samples.reserve(std::min<std::size_t>(static_cast<std::size_t>(page) + skip, _window->capacity()));
+
+		_window->fetch(from, to, _samples, static_cast<std::size_t>(page) + skip);
+
+		auto _skipped = std::find_if(_samples.begin(), _samples.begin() + std::min<std::size_t>(skip, _samples.size()), [from](const score_sample& s) { return s.ts != from; });
+
+		_samples.erase(_samples.begin(), _skipped);
+
+		if (_samples.size() > page)
+		{
+			_samples.resize(page);
+		}
+
+		result.advance(_samples);
+		result.more = _samples.size() == page;
+
+		if (!_samples.empty() && !sink(std::span<const score_sample>(_samples)))
+		{
+			result.more = false;
+		}
+
+		return rvision::core::errc::success;
+	}
+
+	rvision::core::errc lines_provider::fetch_rollups(const std::string& sport, std::int64_t from, std::int64_t to, std::int64_t resolution, std::vector<score_rollup>& rollups, std::int64_t& level)
+	{
+		return m_db->fetch_rollups(sport, from, to, resolution, rollups, level);
+	}
+
+	rvision::core::errc lines_provider::aggregate(const std::string& sport, std::int64_t from, std::int64_t to, score_rollup& result)
+	{
+		return m_db->aggregate(sport, from, to, result);
+	}
+
+	rvision::core::errc lines_provider::stream(const std::string& sport, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink)
+	{
+		score_page _page;
+		_page.next = from;
+		_page.skip = skip;
+
+		do
+		{
+			auto errc = fetch(sport, _page.next, _page.skip, to, page, sink, _page);
+			if (errc != rvision::core::errc::success)
+			{
+				return errc;
+			}
+		}
+		while (_page.more);
+
+		return rvision::core::errc::success;
+	}
+
 	std::unordered_map<std::string, std::double_t> lines_provider::fetch_last(const std::vector<std::string>& sports)
 	{		
 		std::unordered_map<std::string, std::double_t> lines;
+		std::vector<std::string> _missing;
+
+		lines.reserve(sports.size());
 		
 		for(const auto& s : sports)
 		{
-			std::double_t score;
-			m_db.last_score(s, score);
-			
-			lines[s] = score;
+			score_sample _sample;
+
+			if (auto _window = window(s); _window && _window->last(_sample))
+			{
+				lines[s] = _sample.score;
+
+				continue;
+			}
+
+			_missing.emplace_back(s);
+		}
+
+		if (_missing.empty())
+		{
+			return lines;
+		}
+
+		//window misses are read in one batch, lines without history report 0
+		score_samples_t _samples;
+		m_db->last_scores(_missing, _samples);
+
+		for (const auto& s : _missing)
+		{
+			auto p = _samples.find(s);
+
+			lines[s] = p != _samples.end() ? p->second.score : 0.0;
 		}
 		
 		return lines;
 	}
+
+	std::double_t lines_provider::fetch_last(const std::string& sport)
+	{
+		score_sample _sample;
+
+		if (auto _window = window(sport); _window && _window->last(_sample))
+		{
+			return _sample.score;
+		}
+
+		m_db->last_score(sport, _sample);
+
+		return _sample.score;
+	}
 	
+	void lines_provider::metrics(boost::property_tree::ptree& tree) const
+	{
+		m_db->metrics(tree);
+
+		m_scheduler.metrics(tree, "lines.poller");
+		m_upstream.metrics(tree, "lines.poller.upstream");
+
+		m_pipeline.metrics(tree, "lines.pipeline");
+
+		tree.put("lines.ingested", m_ingested.load(std::memory_order_relaxed));
+		tree.put("lines.late", m_late.load(std::memory_order_relaxed));
+		tree.put("lines.unstored", m_unstored.load(std::memory_order_relaxed));
+
+		{
+			std::unique_lock<std::mutex> lock(m_pollers_lock);
+
+			for (const auto& [key, poller] : m_pollers)
+			{
+				poller.metrics(tree, "lines/poller/per_line/");
+			}
+		}
+
+		{
+			std::shared_lock<std::shared_mutex> lock(m_lines_cache_lock);
+
+			std::size_t _stale = 0;
+			auto _now = score_now();
+
+			for (const auto& [line, item] : m_lines_cache)
+			{
+				_stale += item.stale ? 1 : 0;
+
+				tree.put(boost::property_tree::ptree::path_type("lines/cache/lines/" + line + "/stale", '/'), item.stale);
+				tree.put(boost::property_tree::ptree::path_type("lines/cache/lines/" + line + "/recv_age_ms", '/'), item.recv_ts ? _now - item.recv_ts : -1);
+			}
+
+			tree.put("lines.cache.stale", _stale);
+		}
+
+		if (m_config._snapshot)
+		{
+			tree.put("lines.cache.snapshots", m_snapshots.load(std::memory_order_relaxed));
+
+			rvision::core::put_histogram(tree, "lines.cache.snapshot_latency_us", m_snapshot_latency);
+		}
+
+		std::shared_lock<std::shared_mutex> lock(m_windows_lock);
+
+		tree.put("lines.window.capacity", m_config._window);
+		tree.put("lines.window.lines", m_windows.size());
+
+		std::size_t _samples = 0;
+		for (const auto& w : m_windows)
+		{
+			_samples += w.second->size();
+		}
+
+		tree.put("lines.window.samples", _samples);
+	}
+	
+	void lines_provider::init_cache(const std::string& sport)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_lines_cache_lock);
+
+		if (m_lines_cache.contains(sport))
+		{
+			return;
+		}
+
+		//a restored line counts as inited until its first poll replaces the value
+		if (auto p = m_restored_cache.find(sport); p != m_restored_cache.end())
+		{
+			m_lines_cache[sport] = p->second;
+
+			return;
+		}
+
+		m_lines_cache[sport] = limes_delta_cache_item{};
+	}
+
 	void lines_provider::update_cache(const std::string& sport, std::double_t score)
 	{
 		std::unique_lock<std::shared_mutex> lock(m_lines_cache_lock);
 		
-		if(auto p = m_lines_cache.find(sport); p == m_lines_cache.end())
+		auto& item = m_lines_cache[sport];
+
+		item.inited = true;
+		item.stale = false;
+		item.last_recv = score;
+		item.recv_ts = score_now();
+	}
+
+	void lines_provider::load_snapshot()
+	{
+		std::int64_t _saved = 0;
+		std::vector<lines_snapshot_item> _items;
+
+		auto errc = lines_snapshot::load(m_snapshot_path, _saved, _items);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->info("lines_provider::load_snapshot => no snapshot at {}: {}", m_snapshot_path, errc);
+
+			return;
+		}
+
+		auto _age = score_now() - _saved;
+
+		if (m_config._snapshot_max_age.count() > 0 && _age > m_config._snapshot_max_age.count())
+		{
+			m_logger->info("lines_provider::load_snapshot => snapshot is {} ms old, max age {} ms, ignored", _age, m_config._snapshot_max_age.count());
+
+			return;
+		}
+
+		std::unique_lock<std::shared_mutex> lock(m_lines_cache_lock);
+
+		for (const auto& i : _items)
+		{
+			auto& item = m_restored_cache[i.line];
+
+			item.inited = true;
+			item.stale = true;
+			item.last_recv = i.last_recv;
+			item.last_send = i.last_send;
+			item.recv_ts = i.recv_ts;
+			item.send_ts = i.send_ts;
+		}
+
+		m_logger->info("lines_provider::load_snapshot => {} lines restored, snapshot age {} ms", _items.size(), _age);
+	}
+
+	void lines_provider::save_snapshot()
+	{
+		std::vector<lines_snapshot_item> _items;
+
 		{
-			limes_delta_cache_item item;
-			item.inited = false;
-			item.last_recv = score;
-			item.last_send = 0.0;
-			
-			m_lines_cache[sport] = item;
+			std::shared_lock<std::shared_mutex> lock(m_lines_cache_lock);
+
+			_items.reserve(m_lines_cache.size());
+
+			//a line never polled has nothing worth restoring
+			for (const auto& [line, item] : m_lines_cache)
+			{
+				if (item.inited)
+				{
+					_items.emplace_back(lines_snapshot_item{line, item.last_recv, item.last_send, item.recv_ts, item.send_ts});
+				}
+			}
+		}
+
+		auto _start = std::chrono::steady_clock::now();
+
+		auto errc = lines_snapshot::save(m_snapshot_path, score_now(), _items);
+
+		m_snapshot_latency.record(std::chrono::steady_clock::now() - _start);
+
+		if (errc != rvision::core::errc::success)
+		{
+			m_logger->error("lines_provider::save_snapshot => path: {} error: {}", m_snapshot_path, errc);
+
+			return;
 		}
-		else
+
+		m_snapshots.fetch_add(1, std::memory_order_relaxed);
+
+		m_logger->debug("lines_provider::save_snapshot => {} lines", _items.size());
+	}
+
+	void lines_provider::snapshot(std::stop_token stoken)
+	{
+		while (!stoken.stop_requested())
 		{
-			p->second.inited = true;
-			p->second.last_recv = score;
+			{
+				std::unique_lock<std::mutex> lock(m_snapshot_lock);
+
+				if (m_snapshot_wait.wait_for(lock, stoken, m_config._snapshot_interval, [] { return false; }) || stoken.stop_requested())
+				{
+					break;
+				}
+			}
+
+			save_snapshot();
 		}
 	}
 	
@@ -158,6 +803,7 @@ namespace rvision
 						deltas[l] = p->second.last_recv - p->second.last_send;
 
 						p->second.last_send = p->second.last_recv;
+						p->second.send_ts = score_now();
 					}
 					else
 					{
@@ -1,6 +1,11 @@
 #pragma once
 #include <lines/db/lines_db.hpp>
+#include <lines/db/lines_shards.hpp>
+#include <lines/db/lines_log.hpp>
 #include <lines/poller/lines_poller.hpp>
+#include <lines/provider/score_window.hpp>
+#include <lines/provider/lines_snapshot.hpp>
+#include <lines/provider/lines_pipeline.hpp>
 
 namespace rvision
 {
@@ -10,43 +15,122 @@ namespace rvision
 		ready = 1
 	};
 
+	struct lines_provider_config
+	{
+		std::uint32_t _window = 1024;
+		std::string _storage = "sqlite";
+		lines_db_config _db;
+		lines_log_config _log;
+		bool _snapshot = true;
+		std::chrono::milliseconds _snapshot_interval = std::chrono::milliseconds(10000);
+		std::chrono::milliseconds _snapshot_max_age = std::chrono::milliseconds(600000);
+		std::uint32_t _poll_workers = 16;
+		upstream_config _upstream;
+		//lines of one period fetched by one request (0, 1 - a request per line)
+		std::uint32_t _poll_batch = 0;
+		//multi-line endpoint taking ?sports=a,b,c (empty - the api)
+		std::string _poll_batch_api;
+		lines_poller_config _poller;
+		std::double_t _poll_jitter = 0.1;
+		overrun_policy _poll_overrun = overrun_policy::skip;
+		lines_pipeline_config _pipeline;
+	};
+
 	class lines_provider
 	{
+		struct poll_group
+		{
+			std::chrono::seconds period;
+			std::vector<std::string> sports;
+		};
+
 		struct limes_delta_cache_item
 		{
 			bool inited = false;
+			//restored from the snapshot and not polled since
+			bool stale = false;
 			std::double_t last_recv = 0.0;
 			std::double_t last_send = 0.0;
+			std::int64_t recv_ts = 0;
+			std::int64_t send_ts = 0;
 		};
 
 	public:
-		lines_provider(const std::unordered_map<std::string, std::uint32_t>& sports, const std::string& host, const std::string& api, const std::string& db, std::shared_ptr<rvision::core::logger> logger);
+		lines_provider(const std::unordered_map<std::string, std::uint32_t>& sports, const std::string& host, const std::string& api, const std::string& db, std::shared_ptr<rvision::core::logger> logger,
+			const lines_provider_config& config = {});
 		~lines_provider();
 
 		lines_provider_state state();
 
+		//a zero period adds a push line without a poller
 		void add(const std::string& sport, std::chrono::seconds& period);
 		void rem(const std::string& sport);
 
+		//a sample pushed by the producer takes the path of a polled one, errc::not_found for a line that is not added,
+		//one older than the last sample of the line only goes to the storage, the window and the cache keep the newer score,
+		//an append only storage refuses it and it counts in lines.unstored
+		rvision::core::errc ingest(const std::string& sport, const score_sample& sample);
+		//returns once the samples taken so far are in the cache and handed to the storage
+		void flush();
+
 		std::unordered_map<std::string, std::double_t> fetch_delta(const std::vector<std::string>& lines, bool changed);
 
 		std::unordered_map<std::string, std::vector<std::double_t>> fetch(const std::vector<std::string>& sports);
 		std::vector<std::double_t> fetch(const std::string& sport);
+		std::vector<score_sample> fetch(const std::string& sport, std::int64_t from, std::int64_t to);
+		rvision::core::errc fetch(const std::string& sport, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink, score_page& result);
+		rvision::core::errc fetch_rollups(const std::string& sport, std::int64_t from, std::int64_t to, std::int64_t resolution, std::vector<score_rollup>& rollups, std::int64_t& level);
+		rvision::core::errc aggregate(const std::string& sport, std::int64_t from, std::int64_t to, score_rollup& result);
+		rvision::core::errc stream(const std::string& sport, std::int64_t from, std::uint32_t skip, std::int64_t to, std::uint32_t page, const score_sink_t& sink);
 		std::unordered_map<std::string, std::double_t> fetch_last(const std::vector<std::string>& sports);
 		std::double_t fetch_last(const std::string& sport);
 
+		void metrics(boost::property_tree::ptree& tree) const;
+
 	private:
+		void init_cache(const std::string& sport);
 		void update_cache(const std::string& sport, std::double_t score);
+		void publish(const std::string& sport, const score_sample& sample);
+		void persist(const std::string& sport, const score_sample& sample);
+		void join_group(const std::string& sport, const std::chrono::seconds& period);
+		void leave_group(const std::string& sport);
+		void regroup(const std::string& key);
+		void load_snapshot();
+		void save_snapshot();
+		void snapshot(std::stop_token stoken);
+		std::shared_ptr<score_window> window(const std::string& sport) const;
+		void complete(const std::string& sport, std::int64_t oldest, std::vector<std::double_t>& stored, std::vector<std::double_t>& score);
 
 	private:
 		std::shared_ptr<rvision::core::logger> m_logger;
-		rvision::lines_db m_db;
+		lines_provider_config m_config;
+		std::unique_ptr<rvision::lines_storage> m_db;
 		std::string m_host;
 		std::string m_api;
 		std::string m_address;
-		std::mutex m_pollers_lock;
-		std::map<std::string, lines_poller> m_pollers;
-		std::shared_mutex m_lines_cache_lock;
+		std::string m_snapshot_path;
+		mutable std::shared_mutex m_lines_cache_lock;
 		std::unordered_map<std::string, limes_delta_cache_item> m_lines_cache;
+		std::unordered_map<std::string, limes_delta_cache_item> m_restored_cache;
+		std::mutex m_snapshot_lock;
+		std::condition_variable_any m_snapshot_wait;
+		std::atomic<std::uint64_t> m_snapshots;
+		std::atomic<std::uint64_t> m_ingested;
+		//samples older than the last one of their line, handed to the storage only
+		std::atomic<std::uint64_t> m_late;
+		//samples the storage refused, a late one on the append only log
+		std::atomic<std::uint64_t> m_unstored;
+		rvision::core::histogram m_snapshot_latency;
+		std::jthread m_snapshot_thread;
+		mutable std::shared_mutex m_windows_lock;
+		std::unordered_map<std::string, std::shared_ptr<score_window>> m_windows;
+		//declared after the cache, windows and storage it feeds, before the pollers feeding it
+		lines_pipeline m_pipeline;
+		upstream_client m_upstream;
+		lines_scheduler m_scheduler;
+		mutable std::mutex m_pollers_lock;
+		std::map<std::string, poll_group> m_poll_groups;
+		std::uint64_t m_poll_groups_count;
+		std::map<std::string, lines_poller> m_pollers;
 	};
 }
\ No newline at end of file
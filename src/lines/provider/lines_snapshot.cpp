@@ -0,0 +1,247 @@
+#include "lines_snapshot.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace rvision
+{
+	namespace detail
+	{
+		static const std::uint32_t _snapshot_magic = 0x534c5652; //RVLS
+		static const std::uint32_t _snapshot_version = 1;
+		static const std::size_t _snapshot_header = 2 * sizeof(std::uint32_t) + sizeof(std::uint32_t) + sizeof(std::int64_t);
+
+		class snapshot_writer
+		{
+		public:
+			template<typename T>
+			void put(const T& value)
+			{
+				auto _p = reinterpret_cast<const std::uint8_t*>(&value);
+
+				m_data.insert(m_data.end(), _p, _p + sizeof(T));
+			}
+
+			void put(const std::string& value)
+			{
+				put(static_cast<std::uint32_t>(value.size()));
+
+				m_data.insert(m_data.end(), value.begin(), value.end());
+			}
+
+			const std::vector<std::uint8_t>& data() const
+			{
+				return m_data;
+			}
+
+		private:
+			std::vector<std::uint8_t> m_data;
+		};
+
+		class snapshot_reader
+		{
+		public:
+			snapshot_reader(const std::uint8_t* data, std::size_t size)
+				: m_data(data), m_size(size), m_offset(0)
+			{
+			}
+
+			template<typename T>
+			bool get(T& value)
+			{
+				if (m_size - m_offset < sizeof(T))
+				{
+					return false;
+				}
+
+				std::memcpy(&value, m_data + m_offset, sizeof(T));
+				m_offset += sizeof(T);
+
+				return true;
+			}
+
+			bool get(std::string& value)
+			{
+				std::uint32_t _size = 0;
+
+				if (!get(_size) || m_size - m_offset < _size)
+				{
+					return false;
+				}
+
+				value.assign(reinterpret_cast<const char*>(m_data + m_offset), _size);
+				m_offset += _size;
+
+				return true;
+			}
+
+		private:
+			const std::uint8_t* m_data;
+			std::size_t m_size;
+			std::size_t m_offset;
+		};
+
+		//a file, or a folder on posix, is on the disk once it returns true
+		static bool sync_path(const std::filesystem::path& path, bool folder)
+		{
+#ifdef _WIN32
+			//ntfs journals the rename itself
+			if (folder)
+			{
+				return true;
+			}
+
+			auto _fd = ::_wopen(path.c_str(), _O_RDWR | _O_BINARY);
+			if (_fd < 0)
+			{
+				return false;
+			}
+
+			auto _result = ::_commit(_fd) == 0;
+
+			::_close(_fd);
+#else
+			auto _fd = ::open(path.c_str(), folder ? O_RDONLY | O_DIRECTORY : O_RDWR);
+			if (_fd < 0)
+			{
+				return false;
+			}
+
+			auto _result = ::fsync(_fd) == 0;
+
+			::close(_fd);
+#endif
+			return _result;
+		}
+
+		static std::uint32_t fnv1a(const std::uint8_t* data, std::size_t size)
+		{
+			std::uint32_t _hash = 2166136261u;
+
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				_hash = (_hash ^ data[i]) * 16777619u;
+			}
+
+			return _hash;
+		}
+	}
+
+	rvision::core::errc lines_snapshot::save(const std::string& path, std::int64_t saved, const std::vector<lines_snapshot_item>& items)
+	{
+		detail::snapshot_writer _writer;
+
+		for (const auto& i : items)
+		{
+			if (i.line.size() > std::numeric_limits<std::uint32_t>::max())
+			{
+				return rvision::core::errc::invalid_argument;
+			}
+		}
+
+		_writer.put(detail::_snapshot_magic);
+		_writer.put(detail::_snapshot_version);
+		_writer.put(static_cast<std::uint32_t>(items.size()));
+		_writer.put(saved);
+
+		for (const auto& i : items)
+		{
+			_writer.put(i.line);
+			_writer.put(i.last_recv);
+			_writer.put(i.last_send);
+			_writer.put(i.recv_ts);
+			_writer.put(i.send_ts);
+		}
+
+		_writer.put(detail::fnv1a(_writer.data().data(), _writer.data().size()));
+
+		auto _temp = path + ".tmp";
+
+		{
+			std::ofstream _file(_temp, std::ios::binary | std::ios::trunc);
+
+			if (!_file.write(reinterpret_cast<const char*>(_writer.data().data()), static_cast<std::streamsize>(_writer.data().size())) || !_file.flush())
+			{
+				return rvision::core::errc::fail;
+			}
+		}
+
+		//the new snapshot is on the disk before it replaces the old one, the rename is once the folder is synced
+		if (!detail::sync_path(_temp, false))
+		{
+			return rvision::core::errc::fail;
+		}
+
+		std::error_code _ec;
+		std::filesystem::rename(_temp, path, _ec);
+
+		if (_ec)
+		{
+			return rvision::core::errc::fail;
+		}
+
+		auto _folder = std::filesystem::absolute(std::filesystem::path(path), _ec).parent_path();
+
+		return !_ec && detail::sync_path(_folder, true) ? rvision::core::errc::success : rvision::core::errc::fail;
+	}
+
+	rvision::core::errc lines_snapshot::load(const std::string& path, std::int64_t& saved, std::vector<lines_snapshot_item>& items)
+	{
+		std::ifstream _file(path, std::ios::binary);
+
+		if (!_file)
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		std::vector<std::uint8_t> _data((std::istreambuf_iterator<char>(_file)), std::istreambuf_iterator<char>());
+
+		if (_data.size() < detail::_snapshot_header + sizeof(std::uint32_t))
+		{
+			return rvision::core::errc::invalid_argument;
+		}
+
+		std::uint32_t _hash = 0;
+		std::memcpy(&_hash, _data.data() + _data.size() - sizeof(_hash), sizeof(_hash));
+
+		if (_hash != detail::fnv1a(_data.data(), _data.size() - sizeof(_hash)))
+		{
+			return rvision::core::errc::invalid_argument;
+		}
+
+		detail::snapshot_reader _reader(_data.data(), _data.size() - sizeof(_hash));
+
+		std::uint32_t _magic = 0;
+		std::uint32_t _version = 0;
+		std::uint32_t _count = 0;
+
+		if (!_reader.get(_magic) || !_reader.get(_version) || !_reader.get(_count) || !_reader.get(saved)
+			|| _magic != detail::_snapshot_magic || _version != detail::_snapshot_version)
+		{
+			return rvision::core::errc::invalid_argument;
+		}
+
+		items.reserve(_count);
+
+		while (_count--)
+		{
+			lines_snapshot_item _item;
+
+			if (!_reader.get(_item.line) || !_reader.get(_item.last_recv) || !_reader.get(_item.last_send) || !_reader.get(_item.recv_ts) || !_reader.get(_item.send_ts))
+			{
+				items.clear();
+
+				return rvision::core::errc::invalid_argument;
+			}
+
+			items.emplace_back(std::move(_item));
+		}
+
+		return rvision::core::errc::success;
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <core/headers.hpp>
+
+namespace rvision
+{
+	struct lines_snapshot_item
+	{
+		std::string line;
+		std::double_t last_recv = 0.0;
+		std::double_t last_send = 0.0;
+		std::int64_t recv_ts = 0;
+		std::int64_t send_ts = 0;
+	};
+
+	//delta cache dump: header (magic, version, count, saved ts), one record per line, fnv-1a of everything before it.
+	//written to a temporary file and renamed over the previous snapshot, a torn file is never loaded.
+	class lines_snapshot
+	{
+	public:
+		static rvision::core::errc save(const std::string& path, std::int64_t saved, const std::vector<lines_snapshot_item>& items);
+		static rvision::core::errc load(const std::string& path, std::int64_t& saved, std::vector<lines_snapshot_item>& items);
+	};
+}
@@ -0,0 +1,146 @@
+#include "score_window.hpp"
+
+namespace rvision
+{
+	score_window::score_window(std::size_t capacity)
+	: m_capacity(capacity ? capacity : 1), m_slots(std::make_unique<slot[]>(m_capacity)), m_head(0), m_late(std::numeric_limits<std::int64_t>::min())
+	{
+	}
+
+	bool score_window::push(const score_sample& sample)
+	{
+		std::unique_lock<std::mutex> lock(m_write_lock);
+
+		auto _index = m_head.load(std::memory_order_relaxed);
+
+		//the slots stay in ts order, the reads take what is older than a late sample from the storage
+		if (_index != 0 && sample.ts < m_slots[(_index - 1) % m_capacity].ts.load(std::memory_order_relaxed))
+		{
+			m_late.store(std::max(m_late.load(std::memory_order_relaxed), sample.ts), std::memory_order_release);
+
+			return false;
+		}
+
+		auto& _slot = m_slots[_index % m_capacity];
+
+		//odd sequence marks the slot as being written, 2 * (index + 1) publishes it for index
+		_slot.seq.store(2 * _index + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		_slot.ts.store(sample.ts, std::memory_order_relaxed);
+		_slot.score.store(sample.score, std::memory_order_relaxed);
+
+		_slot.seq.store(2 * (_index + 1), std::memory_order_release);
+
+		m_head.store(_index + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	std::int64_t score_window::late_bound() const
+	{
+		auto _late = m_late.load(std::memory_order_acquire);
+
+		return _late == std::numeric_limits<std::int64_t>::min() ? _late : _late + 1;
+	}
+
+	bool score_window::read(std::uint64_t index, score_sample& sample) const
+	{
+		const auto& _slot = m_slots[index % m_capacity];
+
+		auto _seq = _slot.seq.load(std::memory_order_acquire);
+		if (_seq != 2 * (index + 1))
+		{
+			return false;
+		}
+
+		sample.ts = _slot.ts.load(std::memory_order_relaxed);
+		sample.score = _slot.score.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		return _slot.seq.load(std::memory_order_relaxed) == _seq;
+	}
+
+	bool score_window::last(score_sample& sample) const
+	{
+		auto _head = m_head.load(std::memory_order_acquire);
+
+		return _head != 0 && read(_head - 1, sample);
+	}
+
+	std::int64_t score_window::oldest() const
+	{
+		auto _head = m_head.load(std::memory_order_acquire);
+		auto _first = _head > m_capacity ? _head - m_capacity : 0;
+
+		score_sample _sample;
+		for (auto i = _first; i < _head; ++i)
+		{
+			if (read(i, _sample))
+			{
+				return std::max(_sample.ts, late_bound());
+			}
+		}
+
+		return std::numeric_limits<std::int64_t>::max();
+	}
+
+	std::size_t score_window::fetch(std::int64_t from, std::int64_t to, std::vector<score_sample>& samples, std::size_t limit) const
+	{
+		auto _head = m_head.load(std::memory_order_acquire);
+		auto _first = _head > m_capacity ? _head - m_capacity : 0;
+
+		auto _from = std::max(from, late_bound());
+
+		std::size_t _count = 0;
+
+		score_sample _sample;
+		for (auto i = _first; i < _head && _count < limit; ++i)
+		{
+			if (read(i, _sample) && _sample.ts >= _from && _sample.ts <= to)
+			{
+				samples.emplace_back(_sample);
+				++_count;
+			}
+		}
+
+		return _count;
+	}
+
+	std::size_t score_window::fetch(std::vector<std::double_t>& scores, std::size_t limit) const
+	{
+		auto _head = m_head.load(std::memory_order_acquire);
+		auto _first = _head - std::min<std::uint64_t>({_head, m_capacity, limit});
+
+		scores.reserve(scores.size() + static_cast<std::size_t>(_head - _first));
+
+		auto _from = late_bound();
+
+		std::size_t _count = 0;
+
+		score_sample _sample;
+		for (auto i = _first; i < _head; ++i)
+		{
+			if (read(i, _sample) && _sample.ts >= _from)
+			{
+				scores.emplace_back(_sample.score);
+				++_count;
+			}
+		}
+
+		return _count;
+	}
+
+	std::size_t score_window::capacity() const
+	{
+		return m_capacity;
+	}
+
+	std::size_t score_window::size() const
+	{
+		auto _head = m_head.load(std::memory_order_acquire);
+
+		return static_cast<std::size_t>(_head > m_capacity ? m_capacity : _head);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <core/headers.hpp>
+#include <lines/utils/score_sample.hpp>
+
+namespace rvision
+{
+	//fixed-capacity ring of the most recent samples of one line.
+	//writers are serialised, readers never lock: every slot is a seqlock and torn or overwritten slots are skipped.
+	class score_window
+	{
+		struct slot
+		{
+			std::atomic<std::uint64_t> seq{0};
+			std::atomic<std::int64_t> ts{0};
+			std::atomic<std::double_t> score{0.0};
+		};
+
+	public:
+		explicit score_window(std::size_t capacity);
+		~score_window() = default;
+
+		score_window(const score_window&) = delete;
+		score_window& operator=(const score_window&) = delete;
+
+		//false for a sample older than the last one, it is left out and the window no longer answers for its ts and older
+		bool push(const score_sample& sample);
+
+		bool last(score_sample& sample) const;
+		//every sample of the line from this ts on is in the window, the reads return nothing older
+		std::int64_t oldest() const;
+		std::size_t fetch(std::int64_t from, std::int64_t to, std::vector<score_sample>& samples, std::size_t limit = std::numeric_limits<std::size_t>::max()) const;
+		//the newest limit scores, oldest first
+		std::size_t fetch(std::vector<std::double_t>& scores, std::size_t limit = std::numeric_limits<std::size_t>::max()) const;
+
+		std::size_t capacity() const;
+		std::size_t size() const;
+
+	private:
+		bool read(std::uint64_t index, score_sample& sample) const;
+		std::int64_t late_bound() const;
+
+	private:
+		std::size_t m_capacity;
+		std::unique_ptr<slot[]> m_slots;
+		std::atomic<std::uint64_t> m_head;
+		//newest ts of a late sample left out, min when there was none
+		std::atomic<std::int64_t> m_late;
+		std::mutex m_write_lock;
+	};
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <core/headers.hpp>
+#include <lines/utils/score_sample.hpp>
+
+namespace rvision
+{
+	//ohlc-style aggregate of the samples of one bucket [bucket, bucket + level)
+	struct score_rollup
+	{
+		std::int64_t bucket = 0;
+		std::int64_t first_ts = 0;
+		std::int64_t last_ts = 0;
+		std::double_t first = 0.0;
+		std::double_t last = 0.0;
+		std::double_t min = 0.0;
+		std::double_t max = 0.0;
+		std::double_t sum = 0.0;
+		std::uint64_t count = 0;
+
+		void put(const score_sample& sample)
+		{
+			if (count == 0 || sample.ts < first_ts)
+			{
+				first_ts = sample.ts;
+				first = sample.score;
+			}
+
+			if (count == 0 || sample.ts >= last_ts)
+			{
+				last_ts = sample.ts;
+				last = sample.score;
+			}
+
+			min = count == 0 ? sample.score : std::min(min, sample.score);
+			max = count == 0 ? sample.score : std::max(max, sample.score);
+			sum += sample.score;
+
+			++count;
+		}
+
+		void merge(const score_rollup& other)
+		{
+			if (other.count == 0)
+			{
+				return;
+			}
+
+			if (count == 0)
+			{
+				*this = other;
+
+				return;
+			}
+
+			if (other.first_ts < first_ts)
+			{
+				first_ts = other.first_ts;
+				first = other.first;
+			}
+
+			if (other.last_ts >= last_ts)
+			{
+				last_ts = other.last_ts;
+				last = other.last;
+			}
+
+			min = std::min(min, other.min);
+			max = std::max(max, other.max);
+			sum += other.sum;
+			count += other.count;
+		}
+
+		std::double_t avg() const
+		{
+			return count ? sum / count : 0.0;
+		}
+	};
+
+	inline std::int64_t rollup_bucket(std::int64_t ts, std::int64_t level)
+	{
+		auto _bucket = ts / level * level;
+
+		return _bucket > ts ? _bucket - level : _bucket;
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <core/headers.hpp>
+
+namespace rvision
+{
+	//score timestamps are milliseconds since the unix epoch
+	using score_clock = std::chrono::system_clock;
+
+	struct score_sample
+	{
+		std::int64_t ts = 0;
+		std::double_t score = 0.0;
+	};
+
+	inline std::int64_t score_now()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(score_clock::now().time_since_epoch()).count();
+	}
+}
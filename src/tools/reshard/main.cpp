@@ -0,0 +1,309 @@
+#include <core/headers.hpp>
+#include <core/logger.hpp>
+#include <lines/db/lines_shards.hpp>
+#include <iostream>
+
+//offline move of every line to its shard for a new shard count:
+//rvision_reshard <data folder> <shards now> <shards wanted> <output folder>
+//the data folder is only read, the output folder is swapped in by hand while rvision is stopped
+
+namespace detail
+{
+	static const std::string _unsharded_file("rvision.db");
+
+	using connection_ptr = std::unique_ptr<sqlite3, decltype(&sqlite3_close_v2)>;
+	using statement_ptr = std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)>;
+
+	std::string shard_file(std::uint32_t shard, std::uint32_t shards)
+	{
+		return shards == 1 ? _unsharded_file : rvision::lines_shards::shard_file(shard);
+	}
+
+	bool execute(sqlite3* db, const std::string& sql, std::shared_ptr<rvision::core::logger> logger)
+	{
+		char* _error = nullptr;
+
+		if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &_error) != SQLITE_OK)
+		{
+			logger->error("reshard::execute => sql: {} error: {}", sql, _error ? _error : "");
+
+			sqlite3_free(_error);
+
+			return false;
+		}
+
+		return true;
+	}
+
+	statement_ptr prepare(sqlite3* db, const char* sql, std::shared_ptr<rvision::core::logger> logger)
+	{
+		sqlite3_stmt* stmt = nullptr;
+
+		if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+		{
+			logger->error("reshard::prepare => sql: {} error: {}", sql, sqlite3_errmsg(db));
+
+			sqlite3_finalize(stmt);
+			stmt = nullptr;
+		}
+
+		return statement_ptr(stmt, &sqlite3_finalize);
+	}
+
+	bool copy_line(sqlite3* db, std::int64_t from_id, std::int64_t to_id, std::shared_ptr<rvision::core::logger> logger)
+	{
+		static const char* _copies[] =
+		{
+			"INSERT OR REPLACE INTO main.scores (line_id, ts, seq, score) SELECT ?2, ts, seq, score FROM src.scores WHERE line_id = ?1;",
+			"INSERT INTO main.score_blocks (line_id, ts_from, ts_to, rows, data) SELECT ?2, ts_from, ts_to, rows, data FROM src.score_blocks WHERE line_id = ?1 ORDER BY ts_from, block_id;",
+			"INSERT OR REPLACE INTO main.rollups (line_id, level, bucket, first_ts, first_score, last_ts, last_score, min_score, max_score, sum_score, samples) "
+				"SELECT ?2, level, bucket, first_ts, first_score, last_ts, last_score, min_score, max_score, sum_score, samples FROM src.rollups WHERE line_id = ?1;"
+		};
+
+		for (auto sql : _copies)
+		{
+			auto stmt = prepare(db, sql, logger);
+			if (!stmt)
+			{
+				return false;
+			}
+
+			sqlite3_bind_int64(stmt.get(), 1, from_id);
+			sqlite3_bind_int64(stmt.get(), 2, to_id);
+
+			if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+			{
+				logger->error("reshard::copy_line => sql: {} error: {}", sql, sqlite3_errmsg(db));
+
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//copies the lines of one source file that hash to the target shard, one transaction per source
+	bool copy_shard(sqlite3* db, const std::string& source, std::uint32_t shard, std::uint32_t shards, std::uint32_t& lines, std::shared_ptr<rvision::core::logger> logger)
+	{
+		if (!execute(db, "ATTACH DATABASE '" + boost::replace_all_copy(source, "'", "''") + "' AS src;", logger))
+		{
+			return false;
+		}
+
+		auto stmt = prepare(db, "PRAGMA src.user_version;", logger);
+
+		auto _version = stmt && sqlite3_step(stmt.get()) == SQLITE_ROW ? sqlite3_column_int(stmt.get(), 0) : 0;
+
+		if (_version < rvision::lines_db::schema_version)
+		{
+			logger->error("reshard::copy_shard => {} has an old layout, start rvision on it once to migrate", source);
+
+			execute(db, "DETACH DATABASE src;", logger);
+
+			return false;
+		}
+
+		std::vector<std::pair<std::int64_t, std::string>> _lines;
+
+		stmt = prepare(db, "SELECT line_id, name FROM src.lines;", logger);
+
+		auto result = stmt ? sqlite3_step(stmt.get()) : SQLITE_ERROR;
+
+		for (; result == SQLITE_ROW; result = sqlite3_step(stmt.get()))
+		{
+			auto _text = sqlite3_column_text(stmt.get(), 1);
+
+			if (!_text)
+			{
+				logger->warn("reshard::copy_shard => line_id: {} in {} has no name, skipped", sqlite3_column_int64(stmt.get(), 0), source);
+
+				continue;
+			}
+
+			std::string _name(reinterpret_cast<const char*>(_text), static_cast<std::size_t>(sqlite3_column_bytes(stmt.get(), 1)));
+
+			if (rvision::lines_shards::shard_of(_name, shards) == shard)
+			{
+				_lines.emplace_back(sqlite3_column_int64(stmt.get(), 0), std::move(_name));
+			}
+		}
+
+		stmt.reset();
+
+		if (result != SQLITE_DONE)
+		{
+			logger->error("reshard::copy_shard => lines of {} are not read: {}", source, sqlite3_errmsg(db));
+
+			execute(db, "DETACH DATABASE src;", logger);
+
+			return false;
+		}
+
+		bool _ok = execute(db, "BEGIN IMMEDIATE;", logger);
+
+		for (const auto& [id, name] : _lines)
+		{
+			if (!_ok)
+			{
+				break;
+			}
+
+			stmt = prepare(db, "INSERT OR IGNORE INTO main.lines (name) VALUES (?1);", logger);
+
+			if (stmt)
+			{
+				sqlite3_bind_text(stmt.get(), 1, name.c_str(), static_cast<int>(name.size()), SQLITE_STATIC);
+			}
+
+			_ok = stmt && sqlite3_step(stmt.get()) == SQLITE_DONE;
+
+			if (!_ok)
+			{
+				logger->error("reshard::copy_shard => line: {} is not added: {}", name, sqlite3_errmsg(db));
+
+				break;
+			}
+
+			stmt = prepare(db, "SELECT line_id FROM main.lines WHERE name = ?1;", logger);
+
+			if (stmt)
+			{
+				sqlite3_bind_text(stmt.get(), 1, name.c_str(), static_cast<int>(name.size()), SQLITE_STATIC);
+			}
+
+			_ok = stmt && sqlite3_step(stmt.get()) == SQLITE_ROW;
+
+			auto _to_id = _ok ? sqlite3_column_int64(stmt.get(), 0) : 0;
+
+			stmt.reset();
+
+			_ok = _ok && copy_line(db, id, _to_id, logger);
+
+			if (_ok)
+			{
+				logger->info("reshard::copy_shard => line: {} -> {}", name, shard_file(shard, shards));
+			}
+		}
+
+		_ok = _ok && execute(db, "COMMIT;", logger);
+
+		if (!_ok)
+		{
+			execute(db, "ROLLBACK;", logger);
+		}
+
+		execute(db, "DETACH DATABASE src;", logger);
+
+		lines += _ok ? static_cast<std::uint32_t>(_lines.size()) : 0;
+
+		return _ok;
+	}
+
+	int reshard(const std::string& folder, std::uint32_t from, std::uint32_t to, const std::string& output, std::shared_ptr<rvision::core::logger> logger)
+	{
+		for (std::uint32_t s = 0; s < from; ++s)
+		{
+			if (!std::filesystem::exists(folder + shard_file(s, from)))
+			{
+				logger->error("reshard => {} not found", folder + shard_file(s, from));
+
+				return -1;
+			}
+		}
+
+		for (std::uint32_t t = 0; t < to; ++t)
+		{
+			if (std::filesystem::exists(output + shard_file(t, to)))
+			{
+				logger->error("reshard => {} already exists", output + shard_file(t, to));
+
+				return -1;
+			}
+		}
+
+		std::filesystem::create_directories(output);
+
+		std::uint32_t _lines = 0;
+
+		for (std::uint32_t t = 0; t < to; ++t)
+		{
+			//lines_db lays out the schema of the new file
+			{
+				rvision::lines_db_config _config;
+				_config._file = shard_file(t, to);
+				_config._readers = 1;
+				_config._async_threads = 1;
+				_config._maintenance_interval = std::chrono::milliseconds(0);
+
+				rvision::lines_db _db(output, logger, _config);
+			}
+
+			sqlite3* _raw = nullptr;
+			auto result = sqlite3_open_v2((output + shard_file(t, to)).c_str(), &_raw, SQLITE_OPEN_READWRITE, nullptr);
+
+			//a failed open still hands back a handle to close
+			connection_ptr _db(_raw, &sqlite3_close_v2);
+
+			if (result != SQLITE_OK)
+			{
+				logger->error("reshard => {} is not opened: {}", output + shard_file(t, to), _raw ? sqlite3_errmsg(_raw) : sqlite3_errstr(result));
+
+				return -1;
+			}
+
+			for (std::uint32_t s = 0; s < from; ++s)
+			{
+				if (!copy_shard(_db.get(), folder + shard_file(s, from), t, to, _lines, logger))
+				{
+					return -1;
+				}
+			}
+		}
+
+		logger->info("reshard => {} lines moved from {} to {} shards into {}", _lines, from, to, output);
+
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 5)
+	{
+		std::cerr << "usage: rvision_reshard <data folder> <shards now> <shards wanted> <output folder>" << std::endl;
+
+		return -1;
+	}
+
+	auto _logger = rvision::core::create_logger("info", "console", "reshard", "");
+
+	auto _folder = std::filesystem::path(argv[1]).generic_string() + "/";
+	auto _output = std::filesystem::path(argv[4]).generic_string() + "/";
+
+	std::uint32_t _from = 0;
+	std::uint32_t _to = 0;
+
+	std::string_view _from_arg(argv[2]);
+	std::string_view _to_arg(argv[3]);
+
+	std::from_chars(_from_arg.data(), _from_arg.data() + _from_arg.size(), _from);
+	std::from_chars(_to_arg.data(), _to_arg.data() + _to_arg.size(), _to);
+
+	if (_from == 0 || _to == 0)
+	{
+		std::cerr << "shard counts have to be positive" << std::endl;
+
+		return -1;
+	}
+
+	try
+	{
+		return detail::reshard(_folder, _from, _to, _output, _logger);
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << ex.what() << std::endl;
+
+		return -1;
+	}
+}
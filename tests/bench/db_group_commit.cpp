@@ -0,0 +1,156 @@
+#include <sqlite3.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace detail
+{
+	static const std::uint32_t _lines_count = 1000;
+	static const std::uint32_t _commit_rows = 256;
+
+	using clock_t = std::chrono::steady_clock;
+
+	struct bench_db
+	{
+		sqlite3* db = nullptr;
+		std::vector<sqlite3_stmt*> statements;
+	};
+
+	bench_db open_db(const std::filesystem::path& path)
+	{
+		std::filesystem::remove(path);
+
+		bench_db _db;
+		sqlite3_open_v2(path.generic_string().c_str(), &_db.db, SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, nullptr);
+
+		sqlite3_exec(_db.db, "BEGIN;", nullptr, nullptr, nullptr);
+
+		for (std::uint32_t l = 0; l < _lines_count; ++l)
+		{
+			std::string _line("line_");
+			_line += std::to_string(l);
+
+			std::string _sql("CREATE TABLE ");
+			_sql += _line;
+			_sql += " (id int AUTO_INCREMENT, score REAL, PRIMARY KEY (id));";
+
+			sqlite3_exec(_db.db, _sql.c_str(), nullptr, nullptr, nullptr);
+
+			_sql = "INSERT INTO ";
+			_sql += _line;
+			_sql += " (score) VALUES (?1);";
+
+			sqlite3_stmt* stmt = nullptr;
+			sqlite3_prepare_v3(_db.db, _sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+
+			_db.statements.emplace_back(stmt);
+		}
+
+		sqlite3_exec(_db.db, "COMMIT;", nullptr, nullptr, nullptr);
+
+		return _db;
+	}
+
+	void close_db(bench_db& db)
+	{
+		for (auto stmt : db.statements)
+		{
+			sqlite3_finalize(stmt);
+		}
+
+		sqlite3_close_v2(db.db);
+	}
+
+	void insert(bench_db& db, std::uint32_t line, double score)
+	{
+		auto stmt = db.statements[line];
+
+		sqlite3_bind_double(stmt, 1, score);
+		sqlite3_step(stmt);
+		sqlite3_reset(stmt);
+	}
+
+	//one poll of every line, each insert is its own implicit transaction
+	double autocommit(bench_db& db, std::uint32_t polls)
+	{
+		auto _start = clock_t::now();
+
+		for (std::uint32_t p = 0; p < polls; ++p)
+		{
+			for (std::uint32_t l = 0; l < _lines_count; ++l)
+			{
+				insert(db, l, static_cast<double>(p));
+			}
+		}
+
+		return std::chrono::duration<double>(clock_t::now() - _start).count();
+	}
+
+	//same polls, committed in groups of _commit_rows as lines_db::write does
+	double group_commit(bench_db& db, std::uint32_t polls)
+	{
+		auto _start = clock_t::now();
+
+		std::uint32_t _pending = 0;
+
+		for (std::uint32_t p = 0; p < polls; ++p)
+		{
+			for (std::uint32_t l = 0; l < _lines_count; ++l)
+			{
+				if (_pending == 0)
+				{
+					sqlite3_exec(db.db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+				}
+
+				insert(db, l, static_cast<double>(p));
+
+				if (++_pending == _commit_rows)
+				{
+					sqlite3_exec(db.db, "COMMIT;", nullptr, nullptr, nullptr);
+					_pending = 0;
+				}
+			}
+		}
+
+		if (_pending != 0)
+		{
+			sqlite3_exec(db.db, "COMMIT;", nullptr, nullptr, nullptr);
+		}
+
+		return std::chrono::duration<double>(clock_t::now() - _start).count();
+	}
+
+	void report(const std::string& name, std::uint32_t polls, double elapsed)
+	{
+		const double _rows = static_cast<double>(_lines_count) * polls;
+
+		std::cout << name << ": " << _lines_count << " lines x " << polls << " polls in " << elapsed << " s, "
+			<< static_cast<std::uint64_t>(_rows / elapsed) << " rows/s" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto _path = std::filesystem::temp_directory_path();
+	_path /= "rvision_bench_group_commit.db";
+
+	{
+		auto db = detail::open_db(_path);
+		detail::report("autocommit", 2, detail::autocommit(db, 2));
+		detail::close_db(db);
+	}
+
+	{
+		auto db = detail::open_db(_path);
+		detail::report("group commit", 20, detail::group_commit(db, 20));
+		detail::close_db(db);
+	}
+
+	std::filesystem::remove(_path);
+
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include <sqlite3.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace detail
+{
+	static const std::uint32_t _lines_count = 100;
+	static const std::uint32_t _rows_per_line = 1000;
+
+	using clock_t = std::chrono::steady_clock;
+
+	sqlite3* open_db(const std::filesystem::path& path)
+	{
+		std::filesystem::remove(path);
+
+		sqlite3* db = nullptr;
+		sqlite3_open_v2(path.generic_string().c_str(), &db, SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, nullptr);
+
+		for (std::uint32_t l = 0; l < _lines_count; ++l)
+		{
+			std::string _sql("CREATE TABLE line_");
+			_sql += std::to_string(l);
+			_sql += " (id int AUTO_INCREMENT, score REAL, PRIMARY KEY (id));";
+
+			sqlite3_exec(db, _sql.c_str(), nullptr, nullptr, nullptr);
+		}
+
+		return db;
+	}
+
+	std::string line_name(std::uint32_t l)
+	{
+		std::string _line("line_");
+		_line += std::to_string(l);
+
+		return _line;
+	}
+
+	//every insert is built by concatenation and parsed by sqlite3_exec
+	double exec_inserts(sqlite3* db)
+	{
+		auto _start = clock_t::now();
+
+		sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+
+		for (std::uint32_t r = 0; r < _rows_per_line; ++r)
+		{
+			for (std::uint32_t l = 0; l < _lines_count; ++l)
+			{
+				std::string _sql("INSERT INTO ");
+				_sql += line_name(l);
+				_sql += " (score) values (";
+				_sql += std::to_string(static_cast<double>(r));
+				_sql += ");";
+
+				sqlite3_exec(db, _sql.c_str(), nullptr, nullptr, nullptr);
+			}
+		}
+
+		sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+		return std::chrono::duration<double>(clock_t::now() - _start).count();
+	}
+
+	//one statement per line is prepared once and rebound for every insert
+	double prepared_inserts(sqlite3* db)
+	{
+		std::vector<sqlite3_stmt*> _statements(_lines_count, nullptr);
+
+		auto _start = clock_t::now();
+
+		sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+
+		for (std::uint32_t r = 0; r < _rows_per_line; ++r)
+		{
+			for (std::uint32_t l = 0; l < _lines_count; ++l)
+			{
+				auto& stmt = _statements[l];
+				if (!stmt)
+				{
+					std::string _sql("INSERT INTO ");
+					_sql += line_name(l);
+					_sql += " (score) VALUES (?1);";
+
+					sqlite3_prepare_v3(db, _sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+				}
+
+				sqlite3_bind_double(stmt, 1, static_cast<double>(r));
+				sqlite3_step(stmt);
+				sqlite3_reset(stmt);
+			}
+		}
+
+		sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+		auto _elapsed = std::chrono::duration<double>(clock_t::now() - _start).count();
+
+		for (auto stmt : _statements)
+		{
+			sqlite3_finalize(stmt);
+		}
+
+		return _elapsed;
+	}
+
+	void report(const std::string& name, double elapsed)
+	{
+		const double _rows = static_cast<double>(_lines_count) * _rows_per_line;
+
+		std::cout << name << ": " << _rows << " rows in " << elapsed << " s, " << static_cast<std::uint64_t>(_rows / elapsed) << " rows/s" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto _path = std::filesystem::temp_directory_path();
+	_path /= "rvision_bench_statements.db";
+
+	{
+		auto db = detail::open_db(_path);
+		detail::report("sqlite3_exec", detail::exec_inserts(db));
+		sqlite3_close_v2(db);
+	}
+
+	{
+		auto db = detail::open_db(_path);
+		detail::report("prepared", detail::prepared_inserts(db));
+		sqlite3_close_v2(db);
+	}
+
+	std::filesystem::remove(_path);
+
+	return 0;
+}
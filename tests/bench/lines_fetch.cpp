@@ -0,0 +1,116 @@
+#include <lines/db/lines_db.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace detail
+{
+	static const std::uint32_t _lines_count = 200;
+	static const std::uint32_t _polls = 1000;
+	static const std::uint32_t _rounds = 50;
+
+	using clock_t = std::chrono::steady_clock;
+
+	template<typename F>
+	double measure(F&& f)
+	{
+		auto _start = clock_t::now();
+
+		for (std::uint32_t r = 0; r < _rounds; ++r)
+		{
+			f();
+		}
+
+		return std::chrono::duration<double, std::micro>(clock_t::now() - _start).count() / _rounds;
+	}
+}
+
+//multi-line reads of lines_provider::fetch/fetch_last: one line after another vs batched or fanned out
+int main(int argc, char* argv[])
+{
+	auto _logger = spdlog::stdout_color_mt("bench");
+	_logger->set_level(spdlog::level::err);
+
+	auto _path = std::filesystem::temp_directory_path() / "rvision_bench_fetch";
+
+	std::filesystem::remove_all(_path);
+	std::filesystem::create_directories(_path);
+
+	rvision::lines_db_config _config;
+	_config._journal = "wal";
+	_config._queue_limit = detail::_lines_count * detail::_polls;
+
+	rvision::lines_db _db(_path.generic_string() + "/", _logger, _config);
+
+	std::vector<std::string> _lines;
+
+	for (std::uint32_t l = 0; l < detail::_lines_count; ++l)
+	{
+		_lines.emplace_back("line_" + std::to_string(l));
+		_db.add_line(_lines.back());
+	}
+
+	std::future<rvision::core::errc> _committed;
+
+	for (std::uint32_t p = 0; p < detail::_polls; ++p)
+	{
+		for (const auto& l : _lines)
+		{
+			_committed = _db.update_line_async(l, rvision::score_sample{std::int64_t(p) * 1000, static_cast<double>(p % 17)});
+		}
+	}
+
+	_committed.get();
+
+	auto _last_loop = detail::measure([&]()
+	{
+		for (const auto& l : _lines)
+		{
+			rvision::score_sample _sample;
+			_db.last_score(l, _sample);
+		}
+	});
+
+	auto _last_batch = detail::measure([&]()
+	{
+		rvision::score_samples_t _samples;
+		_db.last_scores(_lines, _samples);
+	});
+
+	auto _fetch_loop = detail::measure([&]()
+	{
+		for (const auto& l : _lines)
+		{
+			std::vector<std::double_t> _score;
+			_db.fetch_score(l, _score);
+		}
+	});
+
+	auto _fetch_async = detail::measure([&]()
+	{
+		std::vector<std::future<rvision::async_result<std::vector<std::double_t>>>> _pending;
+		_pending.reserve(_lines.size());
+
+		for (const auto& l : _lines)
+		{
+			_pending.emplace_back(_db.fetch_score_async(l));
+		}
+
+		for (auto& f : _pending)
+		{
+			f.get();
+		}
+	});
+
+	std::cout << detail::_lines_count << " lines, last score: one by one " << static_cast<std::uint64_t>(_last_loop) << " us, one batch "
+		<< static_cast<std::uint64_t>(_last_batch) << " us" << std::endl;
+	std::cout << detail::_lines_count << " lines x " << detail::_polls << " samples, fetch: one by one " << static_cast<std::uint64_t>(_fetch_loop) << " us, async fan-out "
+		<< static_cast<std::uint64_t>(_fetch_async) << " us" << std::endl;
+
+	std::filesystem::remove_all(_path);
+
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include <lines/poller/lines_parser.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace detail
+{
+	static const std::uint32_t _rounds = 20000;
+
+	using clock_t = std::chrono::steady_clock;
+
+	//the body write_json of the web_server sends for the given lines
+	std::string make_body(const std::vector<std::string>& sports)
+	{
+		boost::property_tree::ptree _ptree;
+
+		for (std::size_t i = 0; i < sports.size(); ++i)
+		{
+			auto _line = sports[i];
+			std::transform(_line.begin(), _line.end(), _line.begin(), [](unsigned char c)
+			{
+				 return std::toupper(c);
+			});
+
+			_ptree.add("lines." + _line, 1804289383.0 + static_cast<std::double_t>(i) * 0.25);
+		}
+
+		std::ostringstream _stream;
+		boost::property_tree::write_json(_stream, _ptree);
+
+		return _stream.str();
+	}
+
+	template<typename F>
+	double measure(F&& f)
+	{
+		std::double_t _sum = 0.0;
+
+		auto _start = clock_t::now();
+
+		for (std::uint32_t r = 0; r < _rounds; ++r)
+		{
+			_sum += f();
+		}
+
+		auto _us = std::chrono::duration<double, std::micro>(clock_t::now() - _start).count() / _rounds;
+
+		//keeps the loop from being optimized out
+		if (_sum == 0.0)
+		{
+			std::cout << "";
+		}
+
+		return _us;
+	}
+}
+
+//poll responce parsing: JSONConfiguration and property_tree documents vs the single pass lines_parser
+int main(int argc, char* argv[])
+{
+	for (std::size_t _count : {1, 10, 100})
+	{
+		std::vector<std::string> _sports;
+
+		for (std::size_t i = 0; i < _count; ++i)
+		{
+			_sports.push_back("line_" + std::to_string(i));
+		}
+
+		auto _body = detail::make_body(_sports);
+
+		auto _json_configuration = detail::measure([&]()
+		{
+			std::istringstream _stream(_body);
+			Poco::Util::JSONConfiguration _data(_stream);
+
+			std::double_t _sum = 0.0;
+
+			for (const auto& s : _sports)
+			{
+				auto _line = s;
+				std::transform(_line.begin(), _line.end(), _line.begin(), [](unsigned char c)
+				{
+					 return std::toupper(c);
+				});
+
+				_sum += _data.getDouble("lines." + _line, 0.0);
+			}
+
+			return _sum;
+		});
+
+		auto _property_tree = detail::measure([&]()
+		{
+			std::istringstream _stream(_body);
+			boost::property_tree::ptree _data;
+			boost::property_tree::read_json(_stream, _data);
+
+			std::double_t _sum = 0.0;
+
+			for (const auto& s : _sports)
+			{
+				auto _line = s;
+				std::transform(_line.begin(), _line.end(), _line.begin(), [](unsigned char c)
+				{
+					 return std::toupper(c);
+				});
+
+				_sum += _data.get<std::double_t>("lines." + _line, 0.0);
+			}
+
+			return _sum;
+		});
+
+		rvision::lines_parser _parser(_sports);
+
+		auto _lines_parser = detail::measure([&]()
+		{
+			_parser.parse(_body);
+
+			std::double_t _sum = 0.0;
+
+			for (std::size_t i = 0; i < _parser.size(); ++i)
+			{
+				_sum += _parser.value(i);
+			}
+
+			return _sum;
+		});
+
+		std::cout << _count << " lines, " << _body.size() << " bytes: JSONConfiguration " << _json_configuration << " us, property_tree " << _property_tree
+			<< " us, lines_parser " << _lines_parser << " us" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+#include <lines/db/lines_db.hpp>
+#include <lines/db/lines_log.hpp>
+#include <lines/db/lines_shards.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace detail
+{
+	static const std::uint32_t _lines_count = 100;
+	static const std::uint32_t _polls = 2000;
+	static const std::uint32_t _reads = 20;
+
+	using clock_t = std::chrono::steady_clock;
+
+	std::string line_name(std::uint32_t line)
+	{
+		return "line_" + std::to_string(line);
+	}
+
+	//appends are timed until the storage is closed, so queued sqlite rows are committed inside the measurement
+	double append(const std::function<std::unique_ptr<rvision::lines_storage>()>& open)
+	{
+		auto _start = clock_t::now();
+		{
+			auto _storage = open();
+
+			for (std::uint32_t l = 0; l < _lines_count; ++l)
+			{
+				_storage->add_line(line_name(l));
+			}
+
+			for (std::uint32_t p = 0; p < _polls; ++p)
+			{
+				for (std::uint32_t l = 0; l < _lines_count; ++l)
+				{
+					_storage->update_line(line_name(l), rvision::score_sample{std::int64_t(p) * 1000, static_cast<double>(p % 17)});
+				}
+			}
+		}
+
+		return std::chrono::duration<double>(clock_t::now() - _start).count();
+	}
+
+	//full-history range read of every line
+	double read(rvision::lines_storage& storage, std::uint64_t& samples)
+	{
+		std::vector<rvision::score_sample> _samples;
+		_samples.reserve(_polls);
+
+		auto _start = clock_t::now();
+
+		for (std::uint32_t r = 0; r < _reads; ++r)
+		{
+			for (std::uint32_t l = 0; l < _lines_count; ++l)
+			{
+				_samples.clear();
+
+				storage.fetch_score(line_name(l), 0, std::numeric_limits<std::int64_t>::max(), _samples);
+
+				samples += _samples.size();
+			}
+		}
+
+		return std::chrono::duration<double>(clock_t::now() - _start).count();
+	}
+
+	void report(const std::string& name, double append, double read, std::uint64_t samples)
+	{
+		const double _rows = static_cast<double>(_lines_count) * _polls;
+
+		std::cout << name << ": append " << static_cast<std::uint64_t>(_rows / append) << " rows/s, range read "
+			<< static_cast<std::uint64_t>(samples / read) << " samples/s" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto _logger = spdlog::stdout_color_mt("bench");
+	_logger->set_level(spdlog::level::err);
+
+	auto _path = std::filesystem::temp_directory_path() / "rvision_bench_storage";
+
+	{
+		std::filesystem::remove_all(_path);
+		std::filesystem::create_directories(_path);
+
+		rvision::lines_db_config _config;
+		_config._journal = "wal";
+		_config._queue_limit = detail::_lines_count * detail::_polls;
+
+		auto _folder = _path.generic_string() + "/";
+		auto _open = [&]() { return std::make_unique<rvision::lines_db>(_folder, _logger, _config); };
+
+		auto _append = detail::append(_open);
+
+		std::uint64_t _samples = 0;
+		auto _storage = _open();
+		auto _read = detail::read(*_storage, _samples);
+
+		detail::report("sqlite (wal)", _append, _read, _samples);
+	}
+
+	{
+		std::filesystem::remove_all(_path);
+		std::filesystem::create_directories(_path);
+
+		rvision::lines_db_config _config;
+		_config._journal = "wal";
+		_config._shards = 4;
+		_config._queue_limit = detail::_lines_count * detail::_polls;
+
+		auto _folder = _path.generic_string() + "/";
+		auto _open = [&]() { return std::make_unique<rvision::lines_shards>(_folder, _logger, _config); };
+
+		auto _append = detail::append(_open);
+
+		std::uint64_t _samples = 0;
+		auto _storage = _open();
+		auto _read = detail::read(*_storage, _samples);
+
+		detail::report("sqlite (wal, 4 shards)", _append, _read, _samples);
+	}
+
+	{
+		std::filesystem::remove_all(_path);
+		std::filesystem::create_directories(_path);
+
+		auto _folder = _path.generic_string() + "/";
+		auto _open = [&]() { return std::make_unique<rvision::lines_log>(_folder, _logger); };
+
+		auto _append = detail::append(_open);
+
+		std::uint64_t _samples = 0;
+		auto _storage = _open();
+		auto _read = detail::read(*_storage, _samples);
+
+		detail::report("mmap log", _append, _read, _samples);
+	}
+
+	std::filesystem::remove_all(_path);
+
+	return 0;
+}
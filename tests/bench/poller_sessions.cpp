@@ -0,0 +1,109 @@
+#include <lines/poller/session_pool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace detail
+{
+	static const std::uint32_t _polls = 2000;
+	static const std::string _body("{\"lines\":{\"SOCCER\":\"1.25\"}}");
+
+	using clock_t = std::chrono::steady_clock;
+
+	//stands in for the upstream lines api
+	class mock_handler : public Poco::Net::HTTPRequestHandler
+	{
+	public:
+		void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override
+		{
+			response.setKeepAlive(request.getKeepAlive());
+			response.setContentType("application/json");
+			response.setContentLength(_body.size());
+			response.send() << _body;
+		}
+	};
+
+	class mock_factory : public Poco::Net::HTTPRequestHandlerFactory
+	{
+	public:
+		Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest&) override
+		{
+			return new mock_handler();
+		}
+	};
+
+	static void request(Poco::Net::HTTPClientSession& session, const Poco::URI& uri)
+	{
+		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, uri.getPath(), Poco::Net::HTTPMessage::HTTP_1_1);
+
+		session.sendRequest(request);
+
+		Poco::Net::HTTPResponse response;
+		std::string body;
+
+		Poco::StreamCopier::copyToString(session.receiveResponse(response), body);
+	}
+
+	template<typename F>
+	void report(const std::string& name, F&& poll)
+	{
+		std::vector<double> _latency;
+		_latency.reserve(_polls);
+
+		for (std::uint32_t p = 0; p < _polls; ++p)
+		{
+			auto _start = clock_t::now();
+
+			poll();
+
+			_latency.push_back(std::chrono::duration<double, std::micro>(clock_t::now() - _start).count());
+		}
+
+		std::sort(_latency.begin(), _latency.end());
+
+		std::cout << name << ": p50 " << _latency[_latency.size() / 2] << " us, p99 " << _latency[_latency.size() * 99 / 100] << " us" << std::endl;
+	}
+}
+
+//poll latency against a local mock upstream: a new HTTPClientSession per poll vs the keep-alive session_pool
+int main(int argc, char* argv[])
+{
+	auto _logger = spdlog::stdout_color_mt("bench");
+	_logger->set_level(spdlog::level::err);
+
+	Poco::Net::ServerSocket _socket(0);
+	Poco::Net::HTTPServerParams::Ptr _parameters = new Poco::Net::HTTPServerParams();
+	_parameters->setKeepAlive(true);
+
+	Poco::Net::HTTPServer _server(new detail::mock_factory(), _socket, _parameters);
+	_server.start();
+
+	Poco::URI _uri("http://127.0.0.1:" + std::to_string(_socket.address().port()) + "/api/v1/lines/soccer");
+
+	detail::report("session per poll", [&_uri]()
+	{
+		Poco::Net::HTTPClientSession _session(_uri.getHost(), _uri.getPort());
+
+		_session.setKeepAlive(true);
+		_session.setTimeout(Poco::Timespan(60, 0));
+
+		detail::request(_session, _uri);
+	});
+
+	rvision::session_pool _sessions(_logger, 1, std::chrono::seconds(60));
+
+	detail::report("session pool", [&_uri, &_sessions]()
+	{
+		auto _lease = _sessions.acquire(_uri);
+
+		detail::request(_lease.session(), _uri);
+	});
+
+	_server.stop();
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include <lines/db/score_codec.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace detail
+{
+	static const std::size_t _block_rows = 1024;
+	static const std::uint32_t _rounds = 2000;
+
+	using clock_t = std::chrono::steady_clock;
+
+	//a line polled every second, the score changes on roughly every change_every-th poll
+	std::vector<rvision::score_sample> make_line(std::uint32_t change_every, std::uint32_t seed)
+	{
+		std::mt19937 _rng(seed);
+		std::uniform_int_distribution<std::int64_t> _jitter(-5, 5);
+		std::uniform_real_distribution<double> _score(1.0, 10.0);
+
+		std::vector<rvision::score_sample> _samples;
+		_samples.reserve(_block_rows);
+
+		std::int64_t _ts = 1700000000000;
+		double _value = 2.5;
+
+		for (std::size_t i = 0; i < _block_rows; ++i)
+		{
+			_ts += 1000 + _jitter(_rng);
+
+			if (change_every != 0 && _rng() % change_every == 0)
+			{
+				_value = static_cast<double>(static_cast<std::int64_t>(_score(_rng) * 100)) / 100;
+			}
+
+			_samples.push_back({_ts, _value});
+		}
+
+		return _samples;
+	}
+
+	void run(const std::string& name, const std::vector<rvision::score_sample>& samples)
+	{
+		std::vector<std::uint8_t> _block;
+		std::vector<rvision::score_sample> _decoded;
+
+		_block.reserve(samples.size() * sizeof(rvision::score_sample));
+		_decoded.reserve(samples.size());
+
+		auto _start = clock_t::now();
+
+		for (std::uint32_t r = 0; r < _rounds; ++r)
+		{
+			_block.clear();
+			rvision::score_codec::encode(samples.data(), samples.size(), _block);
+		}
+
+		auto _encode = std::chrono::duration<double>(clock_t::now() - _start).count();
+
+		_start = clock_t::now();
+
+		for (std::uint32_t r = 0; r < _rounds; ++r)
+		{
+			_decoded.clear();
+			rvision::score_codec::decode(_block.data(), _block.size(), _decoded);
+		}
+
+		auto _decode = std::chrono::duration<double>(clock_t::now() - _start).count();
+
+		const double _total = static_cast<double>(samples.size()) * _rounds;
+
+		//a raw scores row carries at least the 8 byte ts and the 8 byte score
+		std::cout << name << ": " << samples.size() << " samples -> " << _block.size() << " bytes ("
+			<< static_cast<double>(samples.size() * sizeof(rvision::score_sample)) / _block.size() << "x vs raw), encode "
+			<< static_cast<std::uint64_t>(_total / _encode) << " samples/s, decode "
+			<< static_cast<std::uint64_t>(_total / _decode) << " samples/s" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	detail::run("steady", detail::make_line(0, 1));
+	detail::run("slow (1/100)", detail::make_line(100, 2));
+	detail::run("moderate (1/10)", detail::make_line(10, 3));
+	detail::run("volatile (1/1)", detail::make_line(1, 4));
+
+	return 0;
+}
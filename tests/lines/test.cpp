@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include <lines/provider/lines_provider.hpp>
+#include <lines/db/score_codec.hpp>
+#include <lines/db/lines_log.hpp>
+#include <lines/provider/lines_ingest.hpp>
 
 namespace rvision::rpc
 {
@@ -66,6 +69,2104 @@ TEST_F( LinesTest, AddTest )
 	_lines_provider->add("baseball", polling);
 }
 
+TEST( LinesDbTest, MigrateTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_migrate_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	{
+		sqlite3* conn = nullptr;
+		ASSERT_EQ(sqlite3_open((path / "rvision.db").generic_string().c_str(), &conn), SQLITE_OK);
+		EXPECT_EQ(sqlite3_exec(conn, "CREATE TABLE soccer (id int AUTO_INCREMENT, score REAL, PRIMARY KEY (id));"
+			"INSERT INTO soccer (score) VALUES (1.0), (2.0), (3.0);"
+			"CREATE TABLE hockey (ts INTEGER, score REAL);"
+			"INSERT INTO hockey (ts, score) VALUES (10, 1.0), (20, 2.0), (20, 3.0);"
+			"CREATE TABLE broken (value REAL);", nullptr, nullptr, nullptr), SQLITE_OK);
+		sqlite3_close(conn);
+	}
+
+	auto now = rvision::score_now();
+
+	{
+		rvision::lines_db db(path.generic_string(), spdlog::get("console"));
+
+		//rows without a time column keep their order and end at the migration time
+		std::vector<rvision::score_sample> soccer;
+		ASSERT_EQ(db.fetch_score("soccer", 0, std::numeric_limits<std::int64_t>::max(), soccer), rvision::core::errc::success);
+		ASSERT_EQ(soccer.size(), 3u);
+		EXPECT_EQ(soccer[0].score, 1.0);
+		EXPECT_EQ(soccer[2].score, 3.0);
+		EXPECT_LT(soccer[0].ts, soccer[2].ts);
+		EXPECT_GE(soccer[2].ts, now);
+
+		//samples sharing a millisecond are all kept
+		std::vector<rvision::score_sample> hockey;
+		ASSERT_EQ(db.fetch_score("hockey", 0, 100, hockey), rvision::core::errc::success);
+		ASSERT_EQ(hockey.size(), 3u);
+		EXPECT_EQ(hockey[1].ts, 20);
+		EXPECT_EQ(hockey[2].ts, 20);
+		EXPECT_EQ(hockey[2].score, 3.0);
+
+		EXPECT_EQ(db.update_line("hockey", rvision::score_sample{20, 4.0}), rvision::core::errc::success);
+	}
+
+	{
+		//the queued score is committed on stop, next to the ones of the same millisecond
+		rvision::lines_db db(path.generic_string(), spdlog::get("console"));
+
+		std::vector<rvision::score_sample> hockey;
+		ASSERT_EQ(db.fetch_score("hockey", 0, 100, hockey), rvision::core::errc::success);
+		ASSERT_EQ(hockey.size(), 4u);
+		EXPECT_EQ(hockey.back().score, 4.0);
+	}
+
+	//the table that could not be copied keeps the file unstamped, it is retried on the next start
+	sqlite3* conn = nullptr;
+	ASSERT_EQ(sqlite3_open((path / "rvision.db").generic_string().c_str(), &conn), SQLITE_OK);
+
+	sqlite3_stmt* stmt = nullptr;
+	sqlite3_prepare_v2(conn, "PRAGMA user_version;", -1, &stmt, nullptr);
+	ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+	EXPECT_EQ(sqlite3_column_int(stmt, 0), 0);
+	sqlite3_finalize(stmt);
+
+	sqlite3_prepare_v2(conn, "SELECT COUNT(*) FROM sqlite_master WHERE name IN ('soccer', 'hockey', 'broken');", -1, &stmt, nullptr);
+	ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+	EXPECT_EQ(sqlite3_column_int(stmt, 0), 1);
+	sqlite3_finalize(stmt);
+
+	sqlite3_close(conn);
+}
+
+TEST( ScoreWindowTest, RingTest )
+{
+	rvision::score_window window(4);
+
+	for (std::int64_t ts = 1; ts <= 6; ++ts)
+	{
+		window.push({ts, static_cast<std::double_t>(ts) / 10});
+	}
+
+	rvision::score_sample last;
+	ASSERT_TRUE(window.last(last));
+	EXPECT_EQ(last.ts, 6);
+	EXPECT_EQ(window.size(), 4);
+	EXPECT_EQ(window.oldest(), 3);
+
+	std::vector<rvision::score_sample> samples;
+	EXPECT_EQ(window.fetch(4, 5, samples), 2);
+	EXPECT_EQ(samples.front().ts, 4);
+	EXPECT_EQ(samples.back().ts, 5);
+
+	std::vector<std::double_t> scores;
+	EXPECT_EQ(window.fetch(scores, 2), 2);
+	EXPECT_EQ(scores.front(), 0.5);
+	EXPECT_EQ(scores.back(), 0.6);
+
+	//a late sample is left out, the window answers only for the ts after it
+	EXPECT_FALSE(window.push({4, 0.45}));
+	EXPECT_EQ(window.oldest(), 5);
+
+	samples.clear();
+	EXPECT_EQ(window.fetch(0, 10, samples), 2);
+	EXPECT_EQ(samples.front().ts, 5);
+
+	scores.clear();
+	EXPECT_EQ(window.fetch(scores), 2);
+	EXPECT_EQ(scores.front(), 0.5);
+
+	EXPECT_TRUE(window.push({6, 0.65}));
+	ASSERT_TRUE(window.last(last));
+	EXPECT_EQ(last.score, 0.65);
+}
+
+TEST( ScoreCodecTest, RoundtripTest )
+{
+	std::vector<rvision::score_sample> samples;
+
+	std::int64_t ts = 1700000000000;
+	for (std::int64_t i = 0; i < 1000; ++i)
+	{
+		//steady period with jitter, repeated and changing scores
+		ts += 1000 + (i % 11 == 0 ? 3 : 0) + (i % 97 == 0 ? 86400000 : 0);
+		samples.push_back({ts, i % 5 == 0 ? 0.1 * i : 2.5});
+	}
+
+	std::vector<std::uint8_t> block;
+	rvision::score_codec::encode(samples.data(), samples.size(), block);
+
+	std::vector<rvision::score_sample> decoded;
+	ASSERT_EQ(rvision::score_codec::decode(block.data(), block.size(), decoded), rvision::core::errc::success);
+	ASSERT_EQ(decoded.size(), samples.size());
+
+	for (std::size_t i = 0; i < samples.size(); ++i)
+	{
+		EXPECT_EQ(decoded[i].ts, samples[i].ts);
+		EXPECT_EQ(decoded[i].score, samples[i].score);
+	}
+
+	EXPECT_LT(block.size(), samples.size() * sizeof(rvision::score_sample) / 10);
+
+	block.pop_back();
+	decoded.clear();
+	EXPECT_EQ(rvision::score_codec::decode(block.data(), block.size(), decoded), rvision::core::errc::fail);
+
+	//a count the block can't hold is rejected before anything is reserved
+	std::fill_n(block.begin(), 4, 0xff);
+	std::vector<rvision::score_sample> corrupt;
+	EXPECT_EQ(rvision::score_codec::decode(block.data(), block.size(), corrupt), rvision::core::errc::fail);
+	EXPECT_EQ(corrupt.capacity(), 0u);
+
+	//two samples, the second opens a window of 31 leading and 64 meaningful bits that can't fit a 64-bit score
+	std::vector<std::uint8_t> wide = {0, 0, 0, 2};
+	wide.resize(20, 0);
+	wide.insert(wide.end(), {0x7f, 0xf8, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff});
+
+	corrupt.clear();
+	EXPECT_EQ(rvision::score_codec::decode(wide.data(), wide.size(), corrupt), rvision::core::errc::fail);
+}
+
+TEST( LinesDbTest, SharedTsBlockTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_shared_ts_block_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._block_rows = 4;
+
+	{
+		rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+		ASSERT_EQ(db.add_line("soccer"), rvision::core::errc::success);
+
+		//every block starts at the same ts, none of them replaces another
+		for (std::int64_t i = 0; i < 16; ++i)
+		{
+			ASSERT_EQ(db.update_line("soccer", rvision::score_sample{5, static_cast<std::double_t>(i)}), rvision::core::errc::success);
+		}
+	}
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+	std::vector<rvision::score_sample> samples;
+	ASSERT_EQ(db.fetch_score("soccer", 0, 10, samples), rvision::core::errc::success);
+	ASSERT_EQ(samples.size(), 16u);
+
+	for (std::size_t i = 0; i < samples.size(); ++i)
+	{
+		EXPECT_EQ(samples[i].score, static_cast<std::double_t>(i));
+	}
+}
+
+TEST( LinesLogTest, SegmentTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_log_test/";
+	std::filesystem::remove_all(path);
+
+	rvision::lines_log_config config;
+	config._segment_records = 100;
+	config._retain_segments = 3;
+	config._index_stride = 8;
+
+	{
+		rvision::lines_log log(path.generic_string(), spdlog::get("console"), config);
+
+		ASSERT_EQ(log.add_line("soccer"), rvision::core::errc::success);
+
+		for (std::int64_t ts = 0; ts < 450; ++ts)
+		{
+			ASSERT_EQ(log.update_line("soccer", rvision::score_sample{ts, 0.5 * ts}), rvision::core::errc::success);
+		}
+
+		EXPECT_EQ(log.update_line("soccer", rvision::score_sample{10, 1.0}), rvision::core::errc::invalid_argument);
+
+		//a run of equal ts longer than an index stride
+		ASSERT_EQ(log.add_line("hockey"), rvision::core::errc::success);
+
+		for (std::int64_t i = 0; i < 30; ++i)
+		{
+			ASSERT_EQ(log.update_line("hockey", rvision::score_sample{i < 5 ? i : 7, 1.0}), rvision::core::errc::success);
+		}
+	}
+
+	//a stray file with a segment extension is skipped on start
+	std::ofstream(path / "lines_log" / "soccer" / "backup.seg") << "backup";
+
+	rvision::lines_log log(path.generic_string(), spdlog::get("console"), config);
+
+	std::vector<rvision::score_sample> hockey;
+	ASSERT_EQ(log.fetch_score("hockey", 7, 7, hockey), rvision::core::errc::success);
+	EXPECT_EQ(hockey.size(), 25u);
+
+	//retention keeps the last three segments: [200, 450)
+	std::vector<rvision::score_sample> samples;
+	ASSERT_EQ(log.fetch_score("soccer", 0, 1000, samples), rvision::core::errc::success);
+	ASSERT_EQ(samples.size(), 250);
+	EXPECT_EQ(samples.front().ts, 200);
+
+	samples.clear();
+	log.fetch_score("soccer", 295, 305, samples);
+	ASSERT_EQ(samples.size(), 11);
+	EXPECT_EQ(samples.front().score, 147.5);
+
+	rvision::score_sample last;
+	ASSERT_EQ(log.last_score("soccer", last), rvision::core::errc::success);
+	EXPECT_EQ(last.ts, 449);
+
+	std::vector<rvision::score_sample> pages;
+	rvision::score_page page;
+	page.next = 0;
+
+	do
+	{
+		ASSERT_EQ(log.fetch_page("soccer", page.next, page.skip, 1000, 64, [&pages](std::span<const rvision::score_sample> samples)
+		{
+			pages.insert(pages.end(), samples.begin(), samples.end());
+
+			return true;
+		}, page), rvision::core::errc::success);
+
+		EXPECT_LE(page.count, 64);
+	}
+	while (page.more);
+
+	ASSERT_EQ(pages.size(), 250);
+	EXPECT_EQ(pages.back().ts, 449);
+
+	//the sink runs outside the line lock, an append to the same line does not wait for it
+	page = {};
+
+	ASSERT_EQ(log.fetch_page("soccer", 0, 0, 1000, 64, [&log](std::span<const rvision::score_sample>)
+	{
+		auto appended = std::async(std::launch::async, [&log]() { return log.update_line("soccer", rvision::score_sample{450, 1.0}); });
+
+		EXPECT_EQ(appended.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+
+		return false;
+	}, page), rvision::core::errc::success);
+
+	EXPECT_FALSE(page.more);
+	ASSERT_EQ(log.last_score("soccer", last), rvision::core::errc::success);
+	EXPECT_EQ(last.ts, 450);
+
+	EXPECT_EQ(log.rem_line("soccer"), rvision::core::errc::success);
+}
+
+TEST( LinesDbTest, RetentionTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_retention_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._block_rows = 0;
+	config._rollups.clear();
+	config._retention._rows = 300;
+	config._line_retention["baseball"] = rvision::retention_policy{std::chrono::milliseconds(60000), 0};
+	config._maintenance_interval = std::chrono::milliseconds(50);
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+	ASSERT_EQ(db.add_line("soccer"), rvision::core::errc::success);
+	ASSERT_EQ(db.add_line("baseball"), rvision::core::errc::success);
+
+	auto now = rvision::score_now();
+
+	for (std::int64_t i = 0; i < 1000; ++i)
+	{
+		ASSERT_EQ(db.update_line("soccer", rvision::score_sample{i, 1.0}), rvision::core::errc::success);
+		ASSERT_EQ(db.update_line("baseball", rvision::score_sample{now - 120000 + i * 100, 1.0}), rvision::core::errc::success);
+	}
+
+	std::vector<rvision::score_sample> soccer;
+	std::vector<rvision::score_sample> baseball;
+
+	for (int i = 0; i < 100 && (soccer.size() != 300 || baseball.size() > 400); ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		soccer.clear();
+		baseball.clear();
+
+		db.fetch_score("soccer", 0, std::numeric_limits<std::int64_t>::max(), soccer);
+		db.fetch_score("baseball", 0, std::numeric_limits<std::int64_t>::max(), baseball);
+	}
+
+	ASSERT_EQ(soccer.size(), 300);
+	EXPECT_EQ(soccer.front().ts, 700);
+
+	//the per-line age policy replaces the rows limit
+	ASSERT_FALSE(baseball.empty());
+	EXPECT_LE(baseball.size(), 400);
+	EXPECT_GE(baseball.front().ts, now - 60000);
+}
+
+TEST( LinesDbTest, BackfillRetentionTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_backfill_retention_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._block_rows = 10;
+	config._rollups.clear();
+	config._maintenance_interval = std::chrono::milliseconds(0);
+
+	std::vector<rvision::score_sample> scores;
+
+	{
+		rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+		ASSERT_EQ(db.add_line("soccer"), rvision::core::errc::success);
+
+		//four sealed blocks and ten raw rows, then five raw rows older than any block
+		for (std::int64_t i = 1000; i < 1050; ++i)
+		{
+			ASSERT_EQ(db.update_line("soccer", rvision::score_sample{i, 1.0}), rvision::core::errc::success);
+		}
+
+		for (int i = 0; i < 100 && scores.size() != 50; ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+			scores.clear();
+			db.fetch_score("soccer", 0, std::numeric_limits<std::int64_t>::max(), scores);
+		}
+
+		ASSERT_EQ(scores.size(), 50);
+
+		for (std::int64_t i = 0; i < 5; ++i)
+		{
+			ASSERT_EQ(db.update_line("soccer", rvision::score_sample{i, 1.0}), rvision::core::errc::success);
+		}
+
+		for (int i = 0; i < 100 && scores.size() != 55; ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+			scores.clear();
+			db.fetch_score("soccer", 0, std::numeric_limits<std::int64_t>::max(), scores);
+		}
+
+		ASSERT_EQ(scores.size(), 55);
+	}
+
+	config._retention._rows = 12;
+	config._maintenance_interval = std::chrono::milliseconds(50);
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+	//the back-filled rows are the oldest, the newest raw rows and one block cover the limit
+	for (int i = 0; i < 100 && scores.size() != 20; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		scores.clear();
+		db.fetch_score("soccer", 0, std::numeric_limits<std::int64_t>::max(), scores);
+	}
+
+	ASSERT_EQ(scores.size(), 20);
+	EXPECT_EQ(scores.front().ts, 1030);
+	EXPECT_EQ(scores.back().ts, 1049);
+}
+
+TEST( LinesDbTest, FetchNewestTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_fetch_newest_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._block_rows = 40;
+	config._rollups.clear();
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+	ASSERT_EQ(db.add_line("soccer"), rvision::core::errc::success);
+
+	//most of the history is sealed into blocks, the newest portion spans blocks and raw rows
+	for (std::int64_t ts = 0; ts < 249; ++ts)
+	{
+		ASSERT_EQ(db.update_line("soccer", rvision::score_sample{ts, static_cast<std::double_t>(ts)}), rvision::core::errc::success);
+	}
+
+	ASSERT_EQ(db.update_line_async("soccer", rvision::score_sample{249, 249.0}).get(), rvision::core::errc::success);
+
+	std::vector<std::double_t> scores;
+	ASSERT_EQ(db.fetch_score("soccer", scores), rvision::core::errc::success);
+	ASSERT_EQ(scores.size(), rvision::lines_storage::fetch_portion);
+	EXPECT_EQ(scores.front(), 150.0);
+	EXPECT_EQ(scores.back(), 249.0);
+	EXPECT_TRUE(std::is_sorted(scores.begin(), scores.end()));
+}
+
+TEST( LinesDbTest, AsyncTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_async_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._readers = 4;
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+	std::vector<std::string> lines = {"soccer", "baseball", "football", "hockey"};
+	std::vector<std::future<rvision::core::errc>> added;
+
+	for (const auto& l : lines)
+	{
+		added.emplace_back(db.add_line_async(l));
+	}
+
+	for (auto& f : added)
+	{
+		ASSERT_EQ(f.get(), rvision::core::errc::success);
+	}
+
+	//the future of an update completes with its group commit, the score is readable from then on
+	std::vector<std::future<rvision::core::errc>> committed;
+
+	for (std::int64_t ts = 1; ts <= 100; ++ts)
+	{
+		for (const auto& l : lines)
+		{
+			committed.emplace_back(db.update_line_async(l, rvision::score_sample{ts, static_cast<std::double_t>(ts)}));
+		}
+	}
+
+	for (auto& f : committed)
+	{
+		ASSERT_EQ(f.get(), rvision::core::errc::success);
+	}
+
+	std::vector<std::future<rvision::async_result<std::vector<rvision::score_sample>>>> reads;
+
+	for (const auto& l : lines)
+	{
+		reads.emplace_back(db.fetch_score_async(l, 0, 100));
+	}
+
+	for (auto& f : reads)
+	{
+		auto result = f.get();
+
+		ASSERT_EQ(result.errc, rvision::core::errc::success);
+		EXPECT_EQ(result.value.size(), 100);
+	}
+
+	auto last = db.last_score_async("soccer").get();
+
+	ASSERT_EQ(last.errc, rvision::core::errc::success);
+	EXPECT_EQ(last.value.ts, 100);
+
+	EXPECT_EQ(db.update_line_async("unknown", rvision::score_sample{1, 1.0}).get(), rvision::core::errc::not_found);
+}
+
+TEST( LinesDbTest, WalTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_wal_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._journal = "wal";
+	config._readers = 2;
+	config._rollups.clear();
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+	ASSERT_EQ(db.add_line("soccer"), rvision::core::errc::success);
+
+	for (std::int64_t ts = 1; ts <= 10; ++ts)
+	{
+		ASSERT_EQ(db.update_line_async("soccer", rvision::score_sample{ts, static_cast<std::double_t>(ts)}).get(), rvision::core::errc::success);
+	}
+
+	auto count = [](sqlite3* conn)
+	{
+		sqlite3_stmt* stmt = nullptr;
+		sqlite3_prepare_v2(conn, "SELECT COUNT(*) FROM scores;", -1, &stmt, nullptr);
+
+		int rows = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+		sqlite3_finalize(stmt);
+
+		return rows;
+	};
+
+	sqlite3* reader = nullptr;
+	ASSERT_EQ(sqlite3_open((path / "rvision.db").generic_string().c_str(), &reader), SQLITE_OK);
+
+	//an open read transaction stands for a long fetch_score, it pins its snapshot until the end
+	ASSERT_EQ(sqlite3_exec(reader, "BEGIN;", nullptr, nullptr, nullptr), SQLITE_OK);
+	ASSERT_EQ(count(reader), 10);
+
+	//the writer commits next to it
+	auto committed = db.update_line_async("soccer", rvision::score_sample{11, 11.0});
+	ASSERT_EQ(committed.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+	EXPECT_EQ(committed.get(), rvision::core::errc::success);
+
+	std::vector<rvision::score_sample> samples;
+	ASSERT_EQ(db.fetch_score("soccer", 0, 100, samples), rvision::core::errc::success);
+	EXPECT_EQ(samples.size(), 11u);
+
+	EXPECT_EQ(count(reader), 10);
+	ASSERT_EQ(sqlite3_exec(reader, "COMMIT;", nullptr, nullptr, nullptr), SQLITE_OK);
+
+	sqlite3* writer = nullptr;
+	ASSERT_EQ(sqlite3_open((path / "rvision.db").generic_string().c_str(), &writer), SQLITE_OK);
+
+	//and the pooled readers do not wait for an open write transaction
+	ASSERT_EQ(sqlite3_exec(writer, "BEGIN IMMEDIATE; INSERT INTO scores (line_id, ts, seq, score) SELECT line_id, 12, 0, 12.0 FROM lines WHERE name = 'soccer';", nullptr, nullptr, nullptr), SQLITE_OK);
+
+	auto fetched = db.fetch_score_async("soccer", 0, 100);
+	auto ready = fetched.wait_for(std::chrono::seconds(2));
+
+	EXPECT_EQ(sqlite3_exec(writer, "COMMIT;", nullptr, nullptr, nullptr), SQLITE_OK);
+	ASSERT_EQ(ready, std::future_status::ready);
+
+	auto result = fetched.get();
+	ASSERT_EQ(result.errc, rvision::core::errc::success);
+	EXPECT_EQ(result.value.size(), 11u);
+
+	EXPECT_EQ(count(reader), 12);
+
+	sqlite3_close(writer);
+	sqlite3_close(reader);
+}
+
+TEST( ConnectionPoolTest, HandOffTest )
+{
+	using pool_t = rvision::connection_pool<std::uint32_t>;
+
+	auto logger = spdlog::get("console");
+
+	std::uint32_t created = 0;
+	auto pool = std::make_unique<pool_t>(1, [&created]() { return std::make_unique<std::uint32_t>(created++); }, logger);
+
+	auto exhausted = [&pool]()
+	{
+		boost::property_tree::ptree tree;
+		pool->metrics(tree, "pool");
+
+		return tree.get<std::uint64_t>("pool.exhausted");
+	};
+
+	std::mutex order_lock;
+	std::vector<std::uint32_t> order;
+	std::vector<std::jthread> waiters;
+
+	{
+		pool_t::accessor held(logger, *pool, std::chrono::milliseconds(100));
+
+		//nothing is free until the deadline
+		EXPECT_THROW(pool_t::accessor(logger, *pool, std::chrono::milliseconds(20)), pool_t::no_resource);
+
+		//the waiters are parked one by one, the connection goes to them in arrival order
+		for (std::uint32_t i = 0; i < 4; ++i)
+		{
+			auto parked = exhausted();
+
+			waiters.emplace_back([&, i]()
+			{
+				pool_t::accessor accessor(logger, *pool, std::chrono::seconds(5));
+
+				std::lock_guard<std::mutex> lock(order_lock);
+				order.push_back(i);
+			});
+
+			while (exhausted() == parked)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+	}
+
+	waiters.clear();
+
+	EXPECT_EQ(order, std::vector<std::uint32_t>({0, 1, 2, 3}));
+	EXPECT_EQ(created, 1u);
+
+	boost::property_tree::ptree tree;
+	pool->metrics(tree, "pool");
+
+	EXPECT_EQ(tree.get<std::uint64_t>("pool.timeouts"), 1u);
+	EXPECT_EQ(tree.get<std::uint32_t>("pool.in_use"), 0u);
+
+	//the pool is destroyed only after the outstanding accessor gives its connection back
+	std::atomic<bool> released = false;
+	std::atomic<bool> acquired = false;
+
+	std::jthread user([&]()
+	{
+		pool_t::accessor accessor(logger, *pool, std::chrono::milliseconds(100));
+
+		acquired = true;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		released = true;
+	});
+
+	while (!acquired)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	pool.reset();
+
+	EXPECT_TRUE(released);
+}
+
+TEST( LinesDbTest, ReadersTimeoutTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_readers_timeout_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._readers = 1;
+	config._readers_timeout = std::chrono::milliseconds(50);
+	config._rollups.clear();
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+	ASSERT_EQ(db.add_line("soccer"), rvision::core::errc::success);
+	ASSERT_EQ(db.update_line_async("soccer", rvision::score_sample{1, 1.0}).get(), rvision::core::errc::success);
+
+	sqlite3* writer = nullptr;
+	ASSERT_EQ(sqlite3_open((path / "rvision.db").generic_string().c_str(), &writer), SQLITE_OK);
+
+	//an exclusive lock keeps the only reader busy inside its fetch
+	ASSERT_EQ(sqlite3_exec(writer, "BEGIN EXCLUSIVE;", nullptr, nullptr, nullptr), SQLITE_OK);
+
+	auto busy = db.fetch_score_async("soccer", 0, 10);
+
+	for (std::uint32_t in_use = 0; in_use == 0; )
+	{
+		boost::property_tree::ptree tree;
+		db.metrics(tree);
+
+		in_use = tree.get<std::uint32_t>("db.readers.in_use");
+	}
+
+	//the next read gives up after readers_timeout
+	std::vector<rvision::score_sample> samples;
+	EXPECT_EQ(db.fetch_score("soccer", 0, 10, samples), rvision::core::errc::insufficient_resources);
+
+	ASSERT_EQ(sqlite3_exec(writer, "COMMIT;", nullptr, nullptr, nullptr), SQLITE_OK);
+	sqlite3_close(writer);
+
+	auto result = busy.get();
+	ASSERT_EQ(result.errc, rvision::core::errc::success);
+	EXPECT_EQ(result.value.size(), 1u);
+
+	boost::property_tree::ptree tree;
+	db.metrics(tree);
+
+	EXPECT_EQ(tree.get<std::uint64_t>("db.readers.timeouts"), 1u);
+}
+
+TEST( LinesDbTest, FailedCommitTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_failed_commit_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"));
+
+	ASSERT_EQ(db.add_line("soccer"), rvision::core::errc::success);
+
+	{
+		sqlite3* conn = nullptr;
+		ASSERT_EQ(sqlite3_open((path / "rvision.db").generic_string().c_str(), &conn), SQLITE_OK);
+		EXPECT_EQ(sqlite3_exec(conn, "CREATE TRIGGER reject_negative BEFORE INSERT ON scores WHEN NEW.score < 0 BEGIN SELECT RAISE(ABORT, 'negative'); END;", nullptr, nullptr, nullptr), SQLITE_OK);
+		sqlite3_close(conn);
+	}
+
+	EXPECT_EQ(db.update_line_async("soccer", rvision::score_sample{1, 1.0}).get(), rvision::core::errc::success);
+
+	//one bad row fails its whole batch and is not counted as committed
+	auto good = db.update_line_async("soccer", rvision::score_sample{2, 2.0});
+	auto bad = db.update_line_async("soccer", rvision::score_sample{3, -1.0});
+
+	EXPECT_NE(bad.get(), rvision::core::errc::success);
+	EXPECT_NE(good.get(), rvision::core::errc::success);
+
+	boost::property_tree::ptree tree;
+	db.metrics(tree);
+
+	EXPECT_EQ(tree.get<std::uint64_t>("db.committed"), 1u);
+	EXPECT_EQ(tree.get<std::uint64_t>("db.failed"), 2u);
+
+	std::vector<rvision::score_sample> samples;
+	ASSERT_EQ(db.fetch_score("soccer", 0, 10, samples), rvision::core::errc::success);
+	ASSERT_EQ(samples.size(), 1u);
+	EXPECT_EQ(samples.front().ts, 1);
+
+	//the open buckets do not keep the rows of the failed batch
+	rvision::score_rollup result;
+	ASSERT_EQ(db.aggregate("soccer", 0, 3599999, result), rvision::core::errc::success);
+	EXPECT_EQ(result.count, 1u);
+	EXPECT_EQ(result.max, 1.0);
+}
+
+TEST( LinesDbTest, RollupRetryTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_rollup_retry_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._block_rows = 0;
+	config._rollups = {1000};
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+	ASSERT_EQ(db.add_line("soccer"), rvision::core::errc::success);
+
+	sqlite3* conn = nullptr;
+	ASSERT_EQ(sqlite3_open((path / "rvision.db").generic_string().c_str(), &conn), SQLITE_OK);
+	ASSERT_EQ(sqlite3_exec(conn, "CREATE TRIGGER reject_rollups BEFORE INSERT ON rollups BEGIN SELECT RAISE(ABORT, 'rejected'); END;", nullptr, nullptr, nullptr), SQLITE_OK);
+
+	//every sample past bucket 0 closes it and fails its commit, bucket 0 stays open with the first sample only
+	EXPECT_EQ(db.update_line_async("soccer", rvision::score_sample{100, 1.0}).get(), rvision::core::errc::success);
+
+	for (int i = 0; i < 5; ++i)
+	{
+		EXPECT_NE(db.update_line_async("soccer", rvision::score_sample{1100 + i, 2.0}).get(), rvision::core::errc::success);
+	}
+
+	boost::property_tree::ptree tree;
+	db.metrics(tree);
+	EXPECT_EQ(tree.get<std::size_t>("db.rollups.pending"), 0u);
+	EXPECT_EQ(tree.get<std::uint64_t>("db.failed"), 5u);
+
+	rvision::score_rollup result;
+	ASSERT_EQ(db.aggregate("soccer", 0, 1999, result), rvision::core::errc::success);
+	EXPECT_EQ(result.count, 1u);
+	EXPECT_EQ(result.max, 1.0);
+
+	ASSERT_EQ(sqlite3_exec(conn, "DROP TRIGGER reject_rollups;", nullptr, nullptr, nullptr), SQLITE_OK);
+	sqlite3_close(conn);
+
+	EXPECT_EQ(db.update_line_async("soccer", rvision::score_sample{1200, 1.0}).get(), rvision::core::errc::success);
+
+	tree.clear();
+	db.metrics(tree);
+	EXPECT_EQ(tree.get<std::size_t>("db.rollups.pending"), 0u);
+
+	std::vector<rvision::score_rollup> rollups;
+	std::int64_t level = 0;
+	ASSERT_EQ(db.fetch_rollups("soccer", 0, 999, 1000, rollups, level), rvision::core::errc::success);
+	ASSERT_EQ(rollups.size(), 1u);
+	EXPECT_EQ(rollups.front().count, 1u);
+	EXPECT_EQ(rollups.front().max, 1.0);
+
+	ASSERT_EQ(db.aggregate("soccer", 0, 1999, result), rvision::core::errc::success);
+	EXPECT_EQ(result.count, 2u);
+	EXPECT_EQ(result.max, 1.0);
+}
+
+TEST( LinesDbTest, LastScoresTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_db_last_scores_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._block_rows = 0;
+
+	rvision::lines_db db(path.generic_string(), spdlog::get("console"), config);
+
+	std::vector<std::string> lines;
+
+	for (std::int64_t l = 0; l < 200; ++l)
+	{
+		lines.emplace_back("line_" + std::to_string(l));
+
+		ASSERT_EQ(db.add_line(lines.back()), rvision::core::errc::success);
+
+		for (std::int64_t ts = 1; ts <= 10; ++ts)
+		{
+			db.update_line(lines.back(), rvision::score_sample{ts, static_cast<std::double_t>(l * 100 + ts)});
+		}
+	}
+
+	ASSERT_EQ(db.add_line("empty"), rvision::core::errc::success);
+	ASSERT_EQ(db.update_line_async("line_0", rvision::score_sample{11, 11.0}).get(), rvision::core::errc::success);
+
+	lines.emplace_back("empty");
+	lines.emplace_back("unknown");
+
+	rvision::score_samples_t samples;
+
+	ASSERT_EQ(db.last_scores(lines, samples), rvision::core::errc::success);
+	ASSERT_EQ(samples.size(), 200);
+
+	EXPECT_EQ(samples["line_0"].ts, 11);
+	EXPECT_EQ(samples["line_199"].score, 19910.0);
+	EXPECT_FALSE(samples.contains("empty"));
+}
+
+TEST( LinesShardsTest, RoutingTest )
+{
+	auto path = std::filesystem::temp_directory_path() / "lines_shards_test/";
+	std::filesystem::remove_all(path);
+	std::filesystem::create_directories(path);
+
+	rvision::lines_db_config config;
+	config._shards = 3;
+
+	std::vector<std::string> lines = {"soccer", "baseball", "football", "hockey", "tennis", "golf"};
+
+	{
+		rvision::lines_shards db(path.generic_string(), spdlog::get("console"), config);
+
+		for (const auto& l : lines)
+		{
+			ASSERT_EQ(db.add_line(l), rvision::core::errc::success);
+			ASSERT_EQ(db.update_line_async(l, rvision::score_sample{1, 1.0}).get(), rvision::core::errc::success);
+		}
+
+		for (const auto& l : lines)
+		{
+			rvision::score_sample sample;
+
+			ASSERT_EQ(db.last_score(l, sample), rvision::core::errc::success);
+			EXPECT_EQ(sample.ts, 1);
+		}
+	}
+
+	for (std::uint32_t s = 0; s < config._shards; ++s)
+	{
+		EXPECT_TRUE(std::filesystem::exists(path / rvision::lines_shards::shard_file(s)));
+	}
+
+	//lines were placed for three shards, two would route them to the wrong files
+	config._shards = 2;
+
+	EXPECT_THROW(rvision::lines_shards(path.generic_string(), spdlog::get("console"), config), rvision::core::exception);
+
+	//nor may a single rvision.db start next to them
+	EXPECT_THROW(rvision::lines_shards::check_layout(path.generic_string(), 1, spdlog::get("console")), rvision::core::exception);
+
+	config._shards = 4;
+
+	EXPECT_NO_THROW(rvision::lines_shards::check_layout(path.generic_string(), config._shards, spdlog::get("console")));
+}
+
+TEST( LinesSnapshotTest, RoundtripTest )
+{
+	auto path = (std::filesystem::temp_directory_path() / "lines_cache_test.snap").generic_string();
+	std::filesystem::remove(path);
+
+	std::vector<rvision::lines_snapshot_item> items = {{"soccer", 2.5, 1.5, 1000, 900}, {"baseball", -1.0, 0.0, 2000, 0}, {std::string(70000, 'h'), 0.5, 0.5, 10, 10}};
+
+	ASSERT_EQ(rvision::lines_snapshot::save(path, 3000, items), rvision::core::errc::success);
+
+	std::int64_t saved = 0;
+	std::vector<rvision::lines_snapshot_item> loaded;
+
+	ASSERT_EQ(rvision::lines_snapshot::load(path, saved, loaded), rvision::core::errc::success);
+	ASSERT_EQ(loaded.size(), items.size());
+
+	EXPECT_EQ(saved, 3000);
+	EXPECT_EQ(loaded[0].line, "soccer");
+	EXPECT_EQ(loaded[0].last_recv, 2.5);
+	EXPECT_EQ(loaded[0].last_send, 1.5);
+	EXPECT_EQ(loaded[1].recv_ts, 2000);
+	//a name longer than 64k is kept whole
+	EXPECT_EQ(loaded[2].line, items[2].line);
+	EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+	//a flipped byte fails the checksum
+	{
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(20);
+		file.put('x');
+	}
+
+	loaded.clear();
+
+	EXPECT_EQ(rvision::lines_snapshot::load(path, saved, loaded), rvision::core::errc::invalid_argument);
+	EXPECT_TRUE(loaded.empty());
+}
+
+TEST( ScoreRollupTest, MergeTest )
+{
+	rvision::score_rollup whole;
+	rvision::score_rollup left;
+	rvision::score_rollup right;
+
+	for (std::int64_t ts = 0; ts < 120; ++ts)
+	{
+		rvision::score_sample sample{ts * 500, static_cast<std::double_t>((ts * 7) % 13)};
+
+		whole.put(sample);
+		(rvision::rollup_bucket(sample.ts, 60000) == 0 ? left : right).put(sample);
+	}
+
+	left.merge(right);
+
+	EXPECT_EQ(left.count, whole.count);
+	EXPECT_EQ(left.first, whole.first);
+	EXPECT_EQ(left.last, whole.last);
+	EXPECT_EQ(left.min, whole.min);
+	EXPECT_EQ(left.max, whole.max);
+	EXPECT_DOUBLE_EQ(left.avg(), whole.avg());
+
+	EXPECT_EQ(rvision::rollup_bucket(59999, 60000), 0);
+	EXPECT_EQ(rvision::rollup_bucket(-1, 60000), -60000);
+}
+
+TEST( LinesSchedulerTest, PeriodTest )
+{
+	auto logger = spdlog::get("console");
+
+	//outlives the scheduler, its workers may still be counting
+	std::vector<std::atomic<std::uint32_t>> runs(200);
+	std::vector<rvision::lines_scheduler::id_t> ids;
+
+	rvision::lines_scheduler scheduler(logger, 2);
+
+	for (auto& r : runs)
+	{
+		ids.push_back(scheduler.add(std::chrono::milliseconds(20), [&r]()
+		{
+			r.fetch_add(1);
+		}));
+	}
+
+	//counts, not elapsed time, a slow host only takes longer to get there
+	auto ran = [&runs](std::size_t first, std::uint32_t count)
+	{
+		for (int i = 0; i < 1000; ++i)
+		{
+			if (std::all_of(runs.begin() + first, runs.end(), [count](const auto& r) { return r.load() >= count; }))
+			{
+				return true;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		return false;
+	};
+
+	ASSERT_TRUE(ran(0, 5));
+
+	scheduler.rem(ids.front());
+
+	auto removed = runs.front().load();
+
+	//every other line runs twice more while the removed one stays put
+	ASSERT_TRUE(ran(1, runs[1].load() + 2));
+
+	EXPECT_EQ(runs.front().load(), removed);
+
+	boost::property_tree::ptree tree;
+	scheduler.metrics(tree, "poller");
+
+	EXPECT_EQ(tree.get<std::size_t>("poller.lines"), runs.size() - 1);
+	EXPECT_GE(tree.get<std::uint64_t>("poller.runs"), 5u * runs.size());
+}
+
+TEST( LinesSchedulerTest, SetPeriodTest )
+{
+	auto logger = spdlog::get("console");
+
+	rvision::lines_scheduler scheduler(logger, 1, 0.5);
+
+	std::atomic<rvision::lines_scheduler::id_t> id = 0;
+	std::atomic<std::uint32_t> runs = 0;
+	std::atomic<std::uint32_t> control = 0;
+
+	//the control line keeps the 100ms period the other one starts with
+	scheduler.add(std::chrono::milliseconds(100), [&]()
+	{
+		control++;
+	});
+
+	id = scheduler.add(std::chrono::milliseconds(100), [&]()
+	{
+		if (runs++ == 0)
+		{
+			scheduler.set_period(id, std::chrono::milliseconds(2));
+		}
+	});
+
+	for (int i = 0; i < 1000 && runs.load() < 20; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	ASSERT_GE(runs.load(), 20u);
+
+	//20 runs at 2ms take a few deadlines of the control line, at 100ms they would take 20
+	EXPECT_LT(control.load(), 10u);
+}
+
+TEST( LinesSchedulerTest, OverrunTest )
+{
+	auto logger = spdlog::get("console");
+
+	//the first run is held until the timer reported three deadlines while it was in flight
+	auto overrun = [&logger](rvision::overrun_policy policy, std::uint64_t& overlaps, std::uint64_t& missed, std::uint64_t& runs)
+	{
+		rvision::lines_scheduler scheduler(logger, 1, 0.0, policy);
+
+		std::promise<void> release;
+		auto released = release.get_future().share();
+		std::atomic<std::uint32_t> calls = 0;
+
+		auto id = scheduler.add(std::chrono::milliseconds(50), [&calls, released]()
+		{
+			if (calls++ == 0)
+			{
+				released.wait();
+			}
+		});
+
+		boost::property_tree::ptree tree;
+
+		for (int i = 0; i < 1000; ++i)
+		{
+			tree.clear();
+			scheduler.metrics(tree, "poller");
+
+			if (tree.get<std::uint64_t>("poller.overlaps") >= 3)
+			{
+				break;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		release.set_value();
+
+		for (int i = 0; i < 1000 && calls.load() < 2; ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		scheduler.rem(id);
+
+		tree.clear();
+		scheduler.metrics(tree, "poller");
+
+		overlaps = tree.get<std::uint64_t>("poller.overlaps");
+		missed = tree.get<std::uint64_t>("poller.missed");
+		runs = tree.get<std::uint64_t>("poller.runs");
+	};
+
+	std::uint64_t overlaps = 0;
+	std::uint64_t missed = 0;
+	std::uint64_t runs = 0;
+
+	//every deadline that came while in flight is dropped
+	overrun(rvision::overrun_policy::skip, overlaps, missed, runs);
+	EXPECT_GE(overlaps, 3u);
+	EXPECT_EQ(missed, overlaps);
+	EXPECT_GE(runs, 2u);
+
+	//the first one is owed and run once right after the held run, the others are dropped
+	overrun(rvision::overrun_policy::catch_up, overlaps, missed, runs);
+	EXPECT_GE(overlaps, 3u);
+	EXPECT_EQ(missed, overlaps - 1);
+	EXPECT_GE(runs, 2u);
+}
+
+TEST( SessionPoolTest, LeaseTest )
+{
+	auto logger = spdlog::get("console");
+
+	rvision::session_pool sessions(logger, 2, std::chrono::seconds(1));
+
+	Poco::URI uri("http://localhost:1024/api/v1/lines/soccer");
+
+	{
+		auto first = sessions.acquire(uri);
+		auto second = sessions.acquire(uri);
+
+		EXPECT_FALSE(first.reused());
+		EXPECT_FALSE(second.reused());
+
+		second.drop();
+	}
+
+	std::atomic<bool> leased = false;
+	std::jthread waiter;
+
+	{
+		auto first = sessions.acquire(uri);
+		auto second = sessions.acquire(uri);
+
+		EXPECT_TRUE(first.reused());
+		EXPECT_FALSE(second.reused());
+
+		//both sessions of the upstream are out, the third poll waits for one
+		waiter = std::jthread([&]()
+		{
+			auto third = sessions.acquire(uri);
+
+			leased = true;
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		EXPECT_FALSE(leased);
+	}
+
+	waiter.join();
+
+	boost::property_tree::ptree tree;
+	sessions.metrics(tree, "sessions");
+
+	EXPECT_TRUE(leased);
+	EXPECT_EQ(tree.get<std::uint64_t>("sessions.created"), 3u);
+	EXPECT_EQ(tree.get<std::uint64_t>("sessions.sessions"), 2u);
+	EXPECT_EQ(tree.get<std::uint64_t>("sessions.waits"), 1u);
+}
+
+TEST( SessionPoolTest, UpstreamsTest )
+{
+	auto logger = spdlog::get("console");
+
+	rvision::session_pool sessions(logger, 1, std::chrono::milliseconds(500));
+
+	Poco::URI soccer("http://localhost:1024/api/v1/lines/soccer");
+	Poco::URI hockey("http://localhost:1025/api/v1/lines/hockey");
+
+	std::atomic<bool> soccer_leased = false;
+	std::atomic<bool> hockey_leased = false;
+	std::jthread soccer_waiter;
+	std::jthread hockey_waiter;
+
+	{
+		auto hockey_lease = sessions.acquire(hockey);
+
+		{
+			auto soccer_lease = sessions.acquire(soccer);
+
+			//a waiter of each upstream
+			hockey_waiter = std::jthread([&]()
+			{
+				try
+				{
+					auto lease = sessions.acquire(hockey);
+
+					hockey_leased = true;
+				}
+				catch (const rvision::session_pool::no_session&)
+				{
+				}
+			});
+
+			soccer_waiter = std::jthread([&]()
+			{
+				auto lease = sessions.acquire(soccer);
+
+				soccer_leased = true;
+			});
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+
+		//the returned soccer session goes to the soccer waiter, the hockey one keeps waiting up to the timeout
+		soccer_waiter.join();
+
+		EXPECT_TRUE(soccer_leased);
+
+		hockey_waiter.join();
+
+		EXPECT_FALSE(hockey_leased);
+	}
+
+	EXPECT_THROW(
+	{
+		auto first = sessions.acquire(soccer);
+		auto second = sessions.acquire(soccer);
+	}, rvision::session_pool::no_session);
+
+	boost::property_tree::ptree tree;
+	sessions.metrics(tree, "sessions");
+
+	EXPECT_EQ(tree.get<std::uint64_t>("sessions.upstreams"), 2u);
+	EXPECT_EQ(tree.get<std::uint64_t>("sessions.timeouts"), 2u);
+}
+
+//local upstream on a free port, every request goes to the handler of the test
+class UpstreamStub
+{
+	using handler_t = std::function<void(Poco::Net::HTTPServerRequest&, Poco::Net::HTTPServerResponse&)>;
+
+	class Handler : public Poco::Net::HTTPRequestHandler
+	{
+	public:
+		explicit Handler(const handler_t& handler)
+		:_handler(handler)
+		{
+		}
+
+		void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override
+		{
+			_handler(request, response);
+		}
+
+	private:
+		handler_t _handler;
+	};
+
+	class Factory : public Poco::Net::HTTPRequestHandlerFactory
+	{
+	public:
+		explicit Factory(const handler_t& handler)
+		:_handler(handler)
+		{
+		}
+
+		Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest&) override
+		{
+			return new Handler(_handler);
+		}
+
+	private:
+		handler_t _handler;
+	};
+
+public:
+	explicit UpstreamStub(const handler_t& handler)
+	:_socket(0), _server(new Factory(handler), _socket, new Poco::Net::HTTPServerParams)
+	{
+		_server.start();
+	}
+
+	~UpstreamStub()
+	{
+		_server.stopAll(true);
+	}
+
+	std::string host() const
+	{
+		return "http://127.0.0.1:" + std::to_string(_server.port());
+	}
+
+private:
+	Poco::Net::ServerSocket _socket;
+	Poco::Net::HTTPServer _server;
+};
+
+//a fresh folder per test and a provider config without the snapshot thread
+class LinesProviderTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		_logger = spdlog::get("console");
+
+		_path = std::filesystem::temp_directory_path() / (std::string("lines_provider_") + ::testing::UnitTest::GetInstance()->current_test_info()->name());
+
+		std::filesystem::remove_all(_path);
+		std::filesystem::create_directories(_path);
+
+		_config._snapshot = false;
+	}
+
+	std::string db() const
+	{
+		return _path.generic_string() + "/";
+	}
+
+protected:
+	std::shared_ptr<rvision::core::logger> _logger;
+	std::filesystem::path _path;
+	rvision::lines_provider_config _config;
+};
+
+TEST_F( LinesProviderTest, BatchTest )
+{
+	_config._poll_batch = 2;
+
+	std::unordered_map<std::string, std::uint32_t> sports = {{"soccer", 60}, {"football", 60}, {"baseball", 60}, {"hockey", 30}};
+
+	auto pollers = [](const rvision::lines_provider& provider)
+	{
+		boost::property_tree::ptree tree;
+		provider.metrics(tree);
+
+		return tree.get<std::size_t>("lines.poller.lines");
+	};
+
+	rvision::lines_provider provider(sports, "http://localhost:9000", "api/v1/lines", db(), _logger, _config);
+
+	//two groups of the 60s lines, one of the 30s line
+	EXPECT_EQ(pollers(provider), 3u);
+
+	provider.rem("soccer");
+	provider.rem("football");
+	provider.rem("baseball");
+
+	EXPECT_EQ(pollers(provider), 1u);
+}
+
+TEST_F( LinesProviderTest, RegroupTest )
+{
+	std::mutex lock;
+	std::vector<std::pair<std::string, std::string>> requests;
+
+	UpstreamStub upstream([&](Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+
+			requests.emplace_back(request.getURI(), request.get("If-None-Match", ""));
+		}
+
+		response.set("ETag", "\"v1\"");
+		response.setContentType("application/json");
+		response.send() << R"({"lines":{"SOCCER":"1.5","ICE HOCKEY":"2.5"}})";
+	});
+
+	_config._poll_batch = 2;
+	_config._poll_jitter = 0.0;
+	_config._upstream._hedge = false;
+
+	std::unordered_map<std::string, std::uint32_t> sports = {{"soccer", 1}};
+
+	rvision::lines_provider provider(sports, upstream.host(), "api/v1/lines", db(), _logger, _config);
+
+	auto polled = [&](std::size_t count)
+	{
+		for (int i = 0; i < 300; ++i)
+		{
+			{
+				std::unique_lock<std::mutex> guard(lock);
+
+				if (requests.size() >= count)
+				{
+					return true;
+				}
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		return false;
+	};
+
+	ASSERT_TRUE(polled(1));
+
+	std::chrono::seconds period(1);
+	provider.add("ice hockey", period);
+
+	std::size_t joined = 0;
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+
+		joined = requests.size();
+	}
+
+	ASSERT_TRUE(polled(joined + 1));
+
+	std::unique_lock<std::mutex> guard(lock);
+
+	//the joined line is encoded into the request of the same poller, the validator of the old request is not sent
+	EXPECT_EQ(requests[0].second, "");
+	EXPECT_NE(requests[joined].first.find("soccer,ice%20hockey"), std::string::npos);
+	EXPECT_EQ(requests[joined].first.find(' '), std::string::npos);
+	EXPECT_EQ(requests[joined].second, "");
+
+	boost::property_tree::ptree tree;
+	provider.metrics(tree);
+
+	EXPECT_EQ(tree.get<std::size_t>("lines.poller.lines"), 1u);
+}
+
+TEST_F( LinesProviderTest, IngestTest )
+{
+
+	//a zero period is a push line
+	std::unordered_map<std::string, std::uint32_t> sports = {{"soccer", 0}, {"hockey", 60}};
+
+	rvision::lines_provider provider(sports, "http://localhost:9000", "api/v1/lines", db(), _logger, _config);
+
+	boost::property_tree::ptree tree;
+	provider.metrics(tree);
+	EXPECT_EQ(tree.get<std::size_t>("lines.poller.lines"), 1u);
+
+	auto now = rvision::score_now();
+
+	EXPECT_EQ(provider.ingest("soccer", {now, 2.5}), rvision::core::errc::success);
+	EXPECT_EQ(provider.ingest("tennis", {now, 1.0}), rvision::core::errc::not_found);
+
+	//older than the last sample of the line, it is stored but the cache and the window keep 2.5
+	EXPECT_EQ(provider.ingest("soccer", {now - 60000, 1.0}), rvision::core::errc::success);
+
+	provider.flush();
+
+	auto delta = provider.fetch_delta({"soccer"}, false);
+	ASSERT_TRUE(delta.contains("soccer"));
+	EXPECT_DOUBLE_EQ(delta["soccer"], 2.5);
+
+	auto scores = provider.fetch("soccer");
+	ASSERT_FALSE(scores.empty());
+	EXPECT_EQ(scores.back(), 2.5);
+
+	std::vector<rvision::score_sample> samples;
+
+	//the storage commits in the background
+	for (int i = 0; i < 100 && samples.size() != 2; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		samples = provider.fetch("soccer", now - 60000, now);
+	}
+
+	ASSERT_EQ(samples.size(), 2u);
+	EXPECT_EQ(samples.front().ts, now - 60000);
+	EXPECT_EQ(samples.back().ts, now);
+
+	tree.clear();
+	provider.metrics(tree);
+	EXPECT_EQ(tree.get<std::uint64_t>("lines.ingested"), 2u);
+	EXPECT_EQ(tree.get<std::uint64_t>("lines.late"), 1u);
+}
+
+TEST_F( LinesProviderTest, LateTest )
+{
+	_config._window = 6;
+
+	std::unordered_map<std::string, std::uint32_t> sports = {{"soccer", 0}};
+
+	rvision::lines_provider provider(sports, "http://localhost:9000", "api/v1/lines", db(), _logger, _config);
+
+	//the late 1015 falls between the samples of the window
+	for (std::int64_t ts : {1000, 1010, 1020, 1030, 1015})
+	{
+		ASSERT_EQ(provider.ingest("soccer", {ts, static_cast<std::double_t>(ts)}), rvision::core::errc::success);
+	}
+
+	provider.flush();
+
+	std::vector<std::int64_t> expected = {1000, 1010, 1015, 1020, 1030};
+
+	auto range = [&provider]()
+	{
+		std::vector<std::int64_t> ts;
+
+		for (const auto& s : provider.fetch("soccer", 0, std::numeric_limits<std::int64_t>::max()))
+		{
+			ts.push_back(s.ts);
+		}
+
+		return ts;
+	};
+
+	//the storage commits in the background
+	for (int i = 0; i < 100 && range() != expected; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+
+	EXPECT_EQ(range(), expected);
+
+	std::vector<std::int64_t> paged;
+	rvision::score_page page;
+
+	do
+	{
+		ASSERT_EQ(provider.fetch("soccer", page.next, page.skip, std::numeric_limits<std::int64_t>::max(), 2, [&paged](std::span<const rvision::score_sample> page_samples)
+		{
+			for (const auto& s : page_samples)
+			{
+				paged.push_back(s.ts);
+			}
+
+			return true;
+		}, page), rvision::core::errc::success);
+	}
+	while (page.more);
+
+	EXPECT_EQ(paged, expected);
+
+	//the late score is not cut off as a window overlap, the older ones stay
+	EXPECT_EQ(provider.fetch("soccer"), (std::vector<std::double_t>{1000, 1010, 1015, 1020, 1030}));
+
+	auto delta = provider.fetch_delta({"soccer"}, false);
+	EXPECT_DOUBLE_EQ(delta["soccer"], 1030);
+}
+
+TEST_F( LinesProviderTest, LateLogTest )
+{
+	_config._storage = "log";
+
+	std::unordered_map<std::string, std::uint32_t> sports = {{"soccer", 0}};
+
+	rvision::lines_provider provider(sports, "http://localhost:9000", "api/v1/lines", db(), _logger, _config);
+
+	for (std::int64_t ts : {1000, 1010, 1020, 1015})
+	{
+		ASSERT_EQ(provider.ingest("soccer", {ts, static_cast<std::double_t>(ts)}), rvision::core::errc::success);
+	}
+
+	provider.flush();
+
+	//the log is append only, the late sample is refused and counted
+	boost::property_tree::ptree tree;
+	provider.metrics(tree);
+
+	EXPECT_EQ(tree.get<std::uint64_t>("lines.ingested"), 4);
+	EXPECT_EQ(tree.get<std::uint64_t>("lines.late"), 1);
+	EXPECT_EQ(tree.get<std::uint64_t>("lines.unstored"), 1);
+}
+
+TEST( LinesIngestTest, ReadTest )
+{
+	std::vector<std::pair<std::string, rvision::score_sample>> taken;
+
+	//tennis is not a line
+	auto sink = [&taken](const std::string& sport, const rvision::score_sample& sample)
+	{
+		if (sport == "tennis")
+		{
+			return rvision::core::errc::not_found;
+		}
+
+		taken.emplace_back(sport, sample);
+
+		return rvision::core::errc::success;
+	};
+
+	auto before = rvision::score_now();
+
+	//no score, a ts that is not a number and an unknown line are rejected, a missing ts is the time of arrival
+	std::istringstream array(R"( [{"sport": "soccer", "score": 1.5, "ts": 100}, {"sport": "soccer"}, {"sport": "soccer", "score": 2, "ts": "soon"},
+		{"sport": "tennis", "score": 3, "ts": 200}, {"sport": "hockey", "score": 4.5}] )");
+
+	rvision::lines_ingest_result result;
+	ASSERT_EQ(rvision::lines_ingest::read(array, false, sink, result), rvision::core::errc::success);
+
+	EXPECT_EQ(result.accepted, 2u);
+	EXPECT_EQ(result.rejected, 3u);
+	ASSERT_EQ(taken.size(), 2u);
+	EXPECT_EQ(taken[0].first, "soccer");
+	EXPECT_EQ(taken[0].second.ts, 100);
+	EXPECT_EQ(taken[0].second.score, 1.5);
+	EXPECT_EQ(taken[1].first, "hockey");
+	EXPECT_GE(taken[1].second.ts, before);
+	EXPECT_LE(taken[1].second.ts, rvision::score_now());
+
+	//a malformed line is rejected on its own, blank lines are skipped
+	std::istringstream ndjson("{\"sport\": \"soccer\", \"score\": 5, \"ts\": 300}\n\n{\"sport\": \n{\"sport\": \"hockey\", \"score\": 6, \"ts\": 400}\n");
+
+	taken.clear();
+	result = {};
+	ASSERT_EQ(rvision::lines_ingest::read(ndjson, true, sink, result), rvision::core::errc::success);
+
+	EXPECT_EQ(result.accepted, 2u);
+	EXPECT_EQ(result.rejected, 1u);
+	ASSERT_EQ(taken.size(), 2u);
+	EXPECT_EQ(taken[0].second.ts, 300);
+	EXPECT_EQ(taken[1].second.ts, 400);
+
+	//an array sent as ndjson is one malformed line
+	std::istringstream mislabeled(R"([{"sport": "soccer", "score": 1.5},
+{"sport": "soccer", "score": 2.5}])");
+
+	taken.clear();
+	result = {};
+	ASSERT_EQ(rvision::lines_ingest::read(mislabeled, true, sink, result), rvision::core::errc::success);
+	EXPECT_EQ(result.accepted, 0u);
+	EXPECT_EQ(result.rejected, 2u);
+
+	//a malformed array is refused whole
+	std::istringstream broken(R"([{"sport": "soccer", "score": 1.5}, {"sport": )");
+
+	result = {};
+	EXPECT_EQ(rvision::lines_ingest::read(broken, false, sink, result), rvision::core::errc::invalid_argument);
+	EXPECT_EQ(result.accepted, 0u);
+	EXPECT_TRUE(taken.empty());
+}
+
+TEST_F( LinesProviderTest, FetchTest )
+{
+
+	std::unordered_map<std::string, std::uint32_t> sports = {{"soccer", 0}};
+
+	{
+		rvision::lines_provider provider(sports, "http://localhost:9000", "api/v1/lines", db(), _logger, _config);
+
+		for (std::int64_t ts = 0; ts < 120; ++ts)
+		{
+			ASSERT_EQ(provider.ingest("soccer", {ts, static_cast<std::double_t>(ts)}), rvision::core::errc::success);
+		}
+
+		provider.flush();
+	}
+
+	//after a restart the window holds a few scores, the older ones come from the storage
+	rvision::lines_provider provider(sports, "http://localhost:9000", "api/v1/lines", db(), _logger, _config);
+
+	for (std::int64_t ts = 200; ts < 210; ++ts)
+	{
+		ASSERT_EQ(provider.ingest("soccer", {ts, static_cast<std::double_t>(ts)}), rvision::core::errc::success);
+	}
+
+	provider.flush();
+
+	std::vector<std::double_t> expected;
+
+	for (std::int64_t ts = 30; ts < 120; ++ts)
+	{
+		expected.push_back(static_cast<std::double_t>(ts));
+	}
+
+	for (std::int64_t ts = 200; ts < 210; ++ts)
+	{
+		expected.push_back(static_cast<std::double_t>(ts));
+	}
+
+	EXPECT_EQ(provider.fetch("soccer"), expected);
+
+	auto lines = provider.fetch(std::vector<std::string>{"soccer"});
+	EXPECT_EQ(lines["soccer"], expected);
+}
+
+TEST_F( LinesProviderTest, PageTest )
+{
+	_config._window = 6;
+
+	std::unordered_map<std::string, std::uint32_t> sports = {{"soccer", 0}};
+
+	rvision::lines_provider provider(sports, "http://localhost:9000", "api/v1/lines", db(), _logger, _config);
+
+	//three samples per ts, the older ones are only in the db
+	for (std::int64_t i = 0; i < 24; ++i)
+	{
+		ASSERT_EQ(provider.ingest("soccer", {100 + i / 3, static_cast<std::double_t>(i)}), rvision::core::errc::success);
+	}
+
+	provider.flush();
+
+	std::vector<rvision::score_sample> samples;
+
+	for (int i = 0; i < 100 && samples.size() != 24; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		samples.clear();
+
+		//pages of four straddle the runs of equal ts
+		rvision::score_page page;
+
+		do
+		{
+			ASSERT_EQ(provider.fetch("soccer", page.next, page.skip, std::numeric_limits<std::int64_t>::max(), 4, [&samples](std::span<const rvision::score_sample> page_samples)
+			{
+				samples.insert(samples.end(), page_samples.begin(), page_samples.end());
+
+				return true;
+			}, page), rvision::core::errc::success);
+		}
+		while (page.more);
+	}
+
+	ASSERT_EQ(samples.size(), 24u);
+
+	for (std::size_t i = 0; i < samples.size(); ++i)
+	{
+		EXPECT_EQ(samples[i].score, static_cast<std::double_t>(i));
+	}
+
+	//past the last representable ts of a line without a window
+	rvision::score_page page;
+	EXPECT_EQ(provider.fetch("tennis", std::numeric_limits<std::int64_t>::max(), 0, std::numeric_limits<std::int64_t>::max(), 4, [](std::span<const rvision::score_sample>) { return true; }, page), rvision::core::errc::success);
+	EXPECT_EQ(page.count, 0u);
+	EXPECT_FALSE(page.more);
+}
+
+TEST( LinesPipelineTest, OverloadTest )
+{
+	auto logger = spdlog::get("console");
+
+	rvision::lines_pipeline_config config;
+	config._publish_queue = 4;
+	config._publish_overload = rvision::overload_policy::coalesce;
+	config._persist_queue = 4;
+	config._persist_overload = rvision::overload_policy::drop_oldest;
+
+	std::atomic<std::double_t> published = -1.0;
+	std::atomic<bool> stalled = true;
+	std::atomic<std::uint32_t> persisted = 0;
+
+	rvision::lines_pipeline pipeline(logger, config,
+	[&published](const std::string& line, const rvision::score_sample& sample)
+	{
+		published = sample.score;
+	},
+	[&stalled, &persisted](const std::string& line, const rvision::score_sample& sample)
+	{
+		while (stalled)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		++persisted;
+	});
+
+	pipeline.add("soccer");
+
+	EXPECT_EQ(pipeline.push("tennis", {rvision::score_now(), 1.0}), rvision::core::errc::not_found);
+
+	for (std::uint32_t i = 0; i < 100; ++i)
+	{
+		EXPECT_EQ(pipeline.push("soccer", {rvision::score_now(), static_cast<std::double_t>(i)}), rvision::core::errc::success);
+
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	//the last score reaches the cache while the storage is stuck
+	for (std::uint32_t i = 0; i < 1000 && published != 99.0; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	EXPECT_EQ(published.load(), 99.0);
+
+	stalled = false;
+	pipeline.drain();
+
+	boost::property_tree::ptree tree;
+	pipeline.metrics(tree, "pipeline");
+
+	EXPECT_EQ(tree.get<std::size_t>("pipeline.publish.depth"), 0u);
+	EXPECT_GT(tree.get<std::uint64_t>("pipeline.persist.dropped"), 0u);
+	EXPECT_EQ(tree.get<std::uint64_t>("pipeline.persist.pushed"), persisted.load() + tree.get<std::uint64_t>("pipeline.persist.dropped"));
+	EXPECT_EQ(tree.get<std::uint64_t>("pipeline.publish.pushed") + tree.get<std::uint64_t>("pipeline.publish.coalesced"), 100u);
+}
+
+TEST( LinesPipelineTest, CoalesceTest )
+{
+	auto logger = spdlog::get("console");
+
+	rvision::lines_pipeline_config config;
+	config._publish_overload = rvision::overload_policy::coalesce;
+
+	std::mutex lock;
+	std::vector<rvision::score_sample> published;
+	std::atomic<bool> stalled = true;
+
+	rvision::lines_pipeline pipeline(logger, config,
+	[&lock, &published, &stalled](const std::string& line, const rvision::score_sample& sample)
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			published.push_back(sample);
+		}
+
+		while (stalled)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	},
+	[](const std::string& line, const rvision::score_sample& sample) {});
+
+	pipeline.add("soccer");
+
+	ASSERT_EQ(pipeline.push("soccer", {100, 1.0}), rvision::core::errc::success);
+
+	//the first sample holds the publish stage, the next ones wait coalesced
+	auto taken = [&lock, &published]()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		return !published.empty();
+	};
+
+	for (std::uint32_t i = 0; i < 1000 && !taken(); ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	//the late 200 doesn't replace 300, the second 300 pushed later does
+	ASSERT_EQ(pipeline.push("soccer", {300, 3.0}), rvision::core::errc::success);
+	ASSERT_EQ(pipeline.push("soccer", {200, 2.0}), rvision::core::errc::success);
+	ASSERT_EQ(pipeline.push("soccer", {300, 3.5}), rvision::core::errc::success);
+
+	stalled = false;
+	pipeline.drain();
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	ASSERT_EQ(published.size(), 2u);
+	EXPECT_EQ(published[0].ts, 100);
+	EXPECT_EQ(published[1].ts, 300);
+	EXPECT_EQ(published[1].score, 3.5);
+}
+
+TEST( LinesParserTest, ExtractTest )
+{
+	rvision::lines_parser parser({"soccer", "baseball", "hockey"});
+
+	//write_json of the web_server quotes the scores
+	EXPECT_TRUE(parser.parse("{\n    \"lines\": {\n        \"SOCCER\": \"1804289383\",\n        \"BASEBALL\": \"-2.5e-1\"\n    }\n}\n"));
+	EXPECT_TRUE(parser.found(0));
+	EXPECT_DOUBLE_EQ(parser.value(0), 1804289383.0);
+	EXPECT_TRUE(parser.found(1));
+	EXPECT_DOUBLE_EQ(parser.value(1), -0.25);
+	EXPECT_FALSE(parser.found(2));
+
+	EXPECT_TRUE(parser.parse("{\"meta\":{\"lines\":{\"HOCKEY\":9},\"tags\":[1,\"a\\\"b\",{}]},\"lines\":{\"FOOTBALL\":1,\"HOCKEY\":3.5,\"SOCCER\":\"n/a\"},\"ok\":true}"));
+	EXPECT_FALSE(parser.found(0));
+	EXPECT_FALSE(parser.found(1));
+	EXPECT_TRUE(parser.found(2));
+	EXPECT_DOUBLE_EQ(parser.value(2), 3.5);
+
+	EXPECT_FALSE(parser.parse("{\"lines\":{\"SOCCER\":1"));
+	EXPECT_FALSE(parser.parse(""));
+	EXPECT_TRUE(parser.parse("{}"));
+	EXPECT_FALSE(parser.found(0));
+}
+
+TEST( LinesPollerTest, ConditionalTest )
+{
+	auto logger = spdlog::get("console");
+
+	std::mutex lock;
+	std::vector<std::string> validators;
+	std::promise<void> release;
+	auto released = release.get_future().share();
+
+	//200 v1, 304, 200 v2 with the same score, 200 v3 with a new one, then the poll is held
+	UpstreamStub stub([&](Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+	{
+		std::size_t count = 0;
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+
+			validators.emplace_back(request.get("If-None-Match", ""));
+			count = validators.size();
+		}
+
+		if (count == 2)
+		{
+			response.setStatus(Poco::Net::HTTPResponse::HTTPStatus::HTTP_NOT_MODIFIED);
+			response.send();
+
+			return;
+		}
+
+		if (count > 4)
+		{
+			released.wait_for(std::chrono::seconds(10));
+		}
+
+		response.set("ETag", count == 1 ? "\"v1\"" : (count == 3 ? "\"v2\"" : "\"v3\""));
+		response.setContentType("application/json");
+		response.send() << (count < 4 ? R"({"lines":{"SOCCER":"1.5"}})" : R"({"lines":{"SOCCER":"2.5"}})");
+	});
+
+	rvision::lines_scheduler scheduler(logger, 1);
+
+	rvision::upstream_config upstream_config;
+	upstream_config._hedge = false;
+
+	rvision::upstream_client upstream(logger, upstream_config);
+
+	//a fixed 20ms period
+	rvision::lines_poller_config config;
+	config._adaptive = true;
+	config._min_period = std::chrono::milliseconds(20);
+	config._max_period = std::chrono::milliseconds(20);
+
+	std::vector<std::double_t> scores;
+
+	{
+		rvision::lines_poller poller(logger, scheduler, upstream, stub.host() + "/api/v1/lines/soccer", "soccer", std::chrono::seconds(1), config,
+			[&](const std::string& sport, std::double_t score)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+
+			scores.emplace_back(score);
+		});
+
+		for (int i = 0; i < 500; ++i)
+		{
+			{
+				std::unique_lock<std::mutex> guard(lock);
+
+				if (validators.size() > 4)
+				{
+					break;
+				}
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		boost::property_tree::ptree tree;
+		poller.metrics(tree, "lines/");
+
+		release.set_value();
+
+		//the 304 and the equal score are not written
+		EXPECT_EQ(tree.get<std::uint64_t>("lines.soccer.skipped_writes"), 2u);
+	}
+
+	std::unique_lock<std::mutex> guard(lock);
+
+	ASSERT_GT(validators.size(), 4u);
+	EXPECT_EQ(validators[0], "");
+	EXPECT_EQ(validators[1], "\"v1\"");
+	//a 304 keeps the validator of the last 200
+	EXPECT_EQ(validators[2], "\"v1\"");
+	EXPECT_EQ(validators[3], "\"v2\"");
+	EXPECT_EQ(validators[4], "\"v3\"");
+
+	EXPECT_EQ(scores, (std::vector<std::double_t>{1.5, 2.5}));
+}
+
+TEST( UpstreamClientTest, BreakerTest )
+{
+	auto logger = spdlog::get("console");
+
+	rvision::upstream_config config;
+	config._breaker_failures = 3;
+	config._breaker_backoff = std::chrono::milliseconds(100);
+	config._timeout = std::chrono::milliseconds(500);
+
+	rvision::upstream_client upstream(logger, config);
+
+	//nothing listens there, every request fails
+	Poco::URI uri("http://127.0.0.1:1/api/v1/lines/soccer");
+	rvision::upstream_response response;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		EXPECT_EQ(upstream.get(uri, "", "", response), rvision::core::errc::fail);
+	}
+
+	EXPECT_EQ(upstream.get(uri, "", "", response), rvision::core::errc::insufficient_resources);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+	//the probe fails and the circuit opens again for twice as long
+	EXPECT_EQ(upstream.get(uri, "", "", response), rvision::core::errc::fail);
+	EXPECT_EQ(upstream.get(uri, "", "", response), rvision::core::errc::insufficient_resources);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+	EXPECT_EQ(upstream.get(uri, "", "", response), rvision::core::errc::insufficient_resources);
+
+	boost::property_tree::ptree tree;
+	upstream.metrics(tree, "upstream");
+
+	EXPECT_EQ(tree.get<std::uint64_t>(boost::property_tree::ptree::path_type("upstream/hosts/127.0.0.1:1/opened", '/')), 2u);
+}
+
+TEST( UpstreamClientTest, HedgeTest )
+{
+	auto logger = spdlog::get("console");
+
+	std::mutex lock;
+	std::unordered_map<std::string, std::uint32_t> requests;
+	std::promise<void> release;
+	auto released = release.get_future().share();
+
+	//the first request of a race path is slow, its hedge is fast
+	UpstreamStub stub([&](Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+	{
+		std::uint32_t count = 0;
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+
+			count = requests[request.getURI()]++;
+		}
+
+		if (request.getURI() == "/error" && count == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+			response.setStatus(Poco::Net::HTTPResponse::HTTPStatus::HTTP_SERVICE_UNAVAILABLE);
+			response.send() << "unavailable";
+
+			return;
+		}
+
+		if (request.getURI() == "/error" && count == 1)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(300));
+		}
+
+		//held until the end of the test, only an abort frees its session
+		if (request.getURI() == "/abort" && count == 0)
+		{
+			released.wait_for(std::chrono::seconds(10));
+		}
+
+		response.send() << request.getURI();
+	});
+
+	rvision::upstream_config config;
+	config._hedge_min_delay = std::chrono::milliseconds(50);
+	config._timeout = std::chrono::milliseconds(5000);
+
+	rvision::upstream_client upstream(logger, config);
+
+	rvision::upstream_response response;
+
+	//enough latencies for a hedge threshold
+	for (int i = 0; i < 32; ++i)
+	{
+		ASSERT_EQ(upstream.get(Poco::URI(stub.host() + "/warm"), "", "", response), rvision::core::errc::success);
+	}
+
+	//a 503 of the first attempt does not win over the hedge that is still running
+	ASSERT_EQ(upstream.get(Poco::URI(stub.host() + "/error"), "", "", response), rvision::core::errc::success);
+	EXPECT_EQ(response.status, Poco::Net::HTTPResponse::HTTPStatus::HTTP_OK);
+	EXPECT_EQ(response.body, "/error");
+
+	//the hedge wins and aborts the held request
+	ASSERT_EQ(upstream.get(Poco::URI(stub.host() + "/abort"), "", "", response), rvision::core::errc::success);
+	EXPECT_EQ(response.body, "/abort");
+
+	boost::property_tree::ptree tree;
+
+	for (int i = 0; i < 500; ++i)
+	{
+		tree.clear();
+		upstream.metrics(tree, "upstream");
+
+		if (tree.get<std::uint64_t>("upstream.attempts.executed") == 4)
+		{
+			break;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	auto host = stub.host().substr(std::string("http://").size());
+	auto get = [&tree, &host](const std::string& name)
+	{
+		return tree.get<std::uint64_t>(boost::property_tree::ptree::path_type("upstream/hosts/" + host + "/" + name, '/'));
+	};
+
+	EXPECT_EQ(tree.get<std::uint64_t>("upstream.attempts.executed"), 4u);
+	EXPECT_EQ(get("hedges"), 2u);
+	EXPECT_EQ(get("hedge_wins"), 2u);
+	//the 503 counts against the upstream, the aborted loser does not
+	EXPECT_EQ(get("errors"), 1u);
+	EXPECT_EQ(tree.get<std::uint64_t>("upstream.sessions.idle"), tree.get<std::uint64_t>("upstream.sessions.sessions"));
+
+	release.set_value();
+}
+
 int main( int argc, char* argv[] )
 {
 	std::unordered_map<std::string, std::uint32_t> _sports;
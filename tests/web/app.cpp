@@ -1,5 +1,7 @@
 #include "app.hpp"
 
+#include <Poco/StringTokenizer.h>
+
 namespace detail
 {
 	static const std::string _logger_name("web_rvision");
@@ -153,6 +155,11 @@ namespace rvision
 
 			m_http_server->handle("GET", _api , std::bind(&app::http_lines_baseball, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 		}
+		{
+			m_logger->info("app::get => _api: {}?sports=", detail::_http_api);
+
+			m_http_server->handle("GET", detail::_http_api, std::bind(&app::http_lines_batch, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+		}
 		
 		m_http_server->start();
 	}
@@ -172,6 +179,43 @@ namespace rvision
 		return create_response("BASEBALL", request, response, params);
 	}
 
+	rvision::core::errc app::http_lines_batch(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params)
+	{
+		boost::property_tree::ptree _ptree;
+
+		std::srand(std::time(nullptr));
+
+		Poco::StringTokenizer _sports(params.get("sports", ""), ",", Poco::StringTokenizer::TOK_IGNORE_EMPTY | Poco::StringTokenizer::TOK_TRIM);
+		for (const auto& s : _sports)
+		{
+			auto _line = s;
+			std::transform(_line.begin(), _line.end(), _line.begin(), [](unsigned char c)
+			{
+				 return std::toupper(c);
+			});
+
+			//unknown lines are left out of the responce
+			if (std::find(detail::_lines.begin(), detail::_lines.end(), _line) == detail::_lines.end())
+			{
+				continue;
+			}
+
+			std::double_t _score = (std::double_t)std::rand();
+
+			m_logger->info("app::http_lines_batch => line: {}, score: {}", _line, _score);
+
+			_ptree.add("lines." + _line, _score);
+		}
+
+		response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+		response.setContentType("application/json");
+
+		std::ostream& stream = response.send();
+		boost::property_tree::write_json(stream, _ptree);
+
+		return rvision::core::errc::success;
+	}
+
 	rvision::core::errc app::create_response(const std::string& line, const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params)
 	{
 		std::string _lines("lines.");
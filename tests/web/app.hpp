@@ -28,6 +28,7 @@ namespace rvision
 	rvision::core::errc http_lines_soccer(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params);
 	rvision::core::errc http_lines_football(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params);
 	rvision::core::errc http_lines_baseball(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params);
+	rvision::core::errc http_lines_batch(const Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const rvision::http::params& params);
 	
 	private:
 		std::shared_ptr<rvision::core::logger> m_logger;